@@ -27,6 +27,8 @@ project "AppBase"
             "%{LibraryDir.vk_bootstrap}"
         }
 
+        -- GpuCuller's shaders are compiled next to their source with the SDK's glslc, without
+        -- and with Hi-Z occlusion
         filter "system:windows"
             links { "vulkan-1" } -- Vulkan lib for Windows
 
@@ -35,9 +37,21 @@ project "AppBase"
                 "_CRT_SECURE_NO_WARNINGS"
             }
 
+            prebuildcommands
+            {
+                '"%{VULKAN_SDK}/Bin/glslc.exe" "%{prj.location}/src/shader/cull.comp" -o "%{prj.location}/src/shader/cull.spv"',
+                '"%{VULKAN_SDK}/Bin/glslc.exe" -DOCCLUSION "%{prj.location}/src/shader/cull.comp" -o "%{prj.location}/src/shader/cull_occlusion.spv"'
+            }
+
         filter "system:linux"
             links { "vulkan" }  -- Vulkan library for Linux (`libvulkan.so`)
 
+            prebuildcommands
+            {
+                '"%{VULKAN_SDK}/bin/glslc" "%{prj.location}/src/shader/cull.comp" -o "%{prj.location}/src/shader/cull.spv"',
+                '"%{VULKAN_SDK}/bin/glslc" -DOCCLUSION "%{prj.location}/src/shader/cull.comp" -o "%{prj.location}/src/shader/cull_occlusion.spv"'
+            }
+
         filter "configurations:Debug"
             defines { "DEBUG", "_DEBUG" }
             symbols "On"
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+#include "bindless_descriptors.h"
+
+namespace
+{
+	constexpr std::array<vk::DescriptorType, 3> DescriptorTypes = {
+		vk::DescriptorType::eStorageBuffer,
+		vk::DescriptorType::eCombinedImageSampler,
+		vk::DescriptorType::eStorageImage
+	};
+
+	constexpr std::array<const char*, 3> TypeNames = { "storage buffer", "sampled image", "storage image" };
+}
+
+// Sizes the descriptor arrays within the device limits and creates the global set and layout.
+void BindlessDescriptors::init(vk::PhysicalDevice physicalDevice, vk::Device device, const BindlessConfig& config)
+{
+	m_Device = device;
+
+	auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceDescriptorIndexingProperties>();
+	const vk::PhysicalDeviceLimits& limits = properties.get<vk::PhysicalDeviceProperties2>().properties.limits;
+	const auto& indexing = properties.get<vk::PhysicalDeviceDescriptorIndexingProperties>();
+
+	// Combined image samplers count against both the sampled image and the sampler limits
+	std::array<uint32_t, TypeCount> capacities = {
+		std::min({ config.maxStorageBuffers, indexing.maxDescriptorSetUpdateAfterBindStorageBuffers, indexing.maxPerStageDescriptorUpdateAfterBindStorageBuffers }),
+		std::min({ config.maxSampledImages, indexing.maxDescriptorSetUpdateAfterBindSampledImages, indexing.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			indexing.maxDescriptorSetUpdateAfterBindSamplers, indexing.maxPerStageDescriptorUpdateAfterBindSamplers }),
+		std::min({ config.maxStorageImages, indexing.maxDescriptorSetUpdateAfterBindStorageImages, indexing.maxPerStageDescriptorUpdateAfterBindStorageImages })
+	};
+
+	// All arrays are visible to every stage, so together they must fit one stage's budget
+	uint64_t total = uint64_t(capacities[0]) + capacities[1] + capacities[2];
+	if (total > indexing.maxPerStageUpdateAfterBindResources)
+	{
+		for (uint32_t& capacity : capacities)
+			capacity = static_cast<uint32_t>(uint64_t(capacity) * indexing.maxPerStageUpdateAfterBindResources / total);
+	}
+
+	std::array<vk::DescriptorSetLayoutBinding, TypeCount> bindings;
+	std::array<vk::DescriptorBindingFlags, TypeCount> bindingFlags;
+	std::array<vk::DescriptorPoolSize, TypeCount> poolSizes;
+
+	for (uint32_t type = 0; type < TypeCount; type++)
+	{
+		m_Slots[type] = SlotAllocator{ capacities[type] };
+		bindings[type] = vk::DescriptorSetLayoutBinding(type, DescriptorTypes[type], capacities[type], vk::ShaderStageFlagBits::eAll);
+		poolSizes[type] = vk::DescriptorPoolSize(DescriptorTypes[type], capacities[type]);
+
+		// Slots may be empty, and may be written while the set is bound as long as pending
+		// work doesn't index them
+		bindingFlags[type] = vk::DescriptorBindingFlagBits::ePartiallyBound
+			| vk::DescriptorBindingFlagBits::eUpdateAfterBind
+			| vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+	}
+
+	vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo(bindingFlags);
+	vk::DescriptorSetLayoutCreateInfo setLayoutInfo(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool, bindings, &bindingFlagsInfo);
+	m_SetLayout = m_Device.createDescriptorSetLayout(setLayoutInfo);
+
+	vk::DescriptorPoolCreateInfo poolInfo(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind, 1, poolSizes);
+	m_Pool = m_Device.createDescriptorPool(poolInfo);
+	m_Set = m_Device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo(m_Pool, m_SetLayout)).front();
+
+	// Push constants carry the per-draw resource indices
+	vk::PushConstantRange pushConstantRange(vk::ShaderStageFlagBits::eAll, 0, std::min(config.pushConstantSize, limits.maxPushConstantsSize));
+	m_PipelineLayout = m_Device.createPipelineLayout(vk::PipelineLayoutCreateInfo({}, m_SetLayout, pushConstantRange));
+
+	spdlog::info("Bindless descriptors: {} storage buffers, {} sampled images, {} storage images",
+		capacities[0], capacities[1], capacities[2]);
+}
+
+// Destroys the global set, its layouts and its pool. The GPU must no longer be using them.
+void BindlessDescriptors::destroy()
+{
+	if (!m_Device)
+		return;
+
+	m_PendingReleases.flush_all();
+
+	m_Device.destroyPipelineLayout(m_PipelineLayout);
+	m_Device.destroyDescriptorPool(m_Pool);
+	m_Device.destroyDescriptorSetLayout(m_SetLayout);
+	m_Device = nullptr;
+}
+
+// Writes a storage buffer range into a free slot.
+uint32_t BindlessDescriptors::add_storage_buffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
+{
+	vk::DescriptorBufferInfo bufferInfo(buffer, offset, range);
+
+	std::lock_guard lock(m_Mutex);
+	uint32_t index = allocate_slot(BindlessType::StorageBuffer);
+	write(BindlessType::StorageBuffer, index, &bufferInfo, nullptr);
+	return index;
+}
+
+// Writes a sampled image and its sampler into a free slot.
+uint32_t BindlessDescriptors::add_sampled_image(vk::ImageView imageView, vk::Sampler sampler, vk::ImageLayout layout)
+{
+	vk::DescriptorImageInfo imageInfo(sampler, imageView, layout);
+
+	std::lock_guard lock(m_Mutex);
+	uint32_t index = allocate_slot(BindlessType::SampledImage);
+	write(BindlessType::SampledImage, index, nullptr, &imageInfo);
+	return index;
+}
+
+// Writes a storage image, expected in eGeneral, into a free slot.
+uint32_t BindlessDescriptors::add_storage_image(vk::ImageView imageView)
+{
+	vk::DescriptorImageInfo imageInfo({}, imageView, vk::ImageLayout::eGeneral);
+
+	std::lock_guard lock(m_Mutex);
+	uint32_t index = allocate_slot(BindlessType::StorageImage);
+	write(BindlessType::StorageImage, index, nullptr, &imageInfo);
+	return index;
+}
+
+// Defers returning the slot until the last frame indexing it has completed.
+void BindlessDescriptors::release(BindlessType type, uint32_t index, uint64_t lastUsedFrame)
+{
+	std::lock_guard lock(m_Mutex);
+
+	// Runs from collect(), which already holds the lock
+	m_PendingReleases.push(lastUsedFrame, [this, type, index]()
+	{
+		m_Slots[static_cast<uint32_t>(type)].freeList.push_back(index);
+	});
+}
+
+// Moves slots whose frames have completed back to the free lists.
+void BindlessDescriptors::collect(uint64_t completedFrame)
+{
+	std::lock_guard lock(m_Mutex);
+	m_PendingReleases.flush(completedFrame);
+}
+
+// Binds the global descriptor set to set 0.
+void BindlessDescriptors::bind(vk::CommandBuffer commandBuffer, vk::PipelineBindPoint bindPoint) const
+{
+	commandBuffer.bindDescriptorSets(bindPoint, m_PipelineLayout, 0, m_Set, {});
+}
+
+// Hands out a recycled slot, or the next never-used one. Expects m_Mutex to be held.
+uint32_t BindlessDescriptors::allocate_slot(BindlessType type)
+{
+	SlotAllocator& slots = m_Slots[static_cast<uint32_t>(type)];
+
+	if (!slots.freeList.empty())
+	{
+		uint32_t index = slots.freeList.back();
+		slots.freeList.pop_back();
+		return index;
+	}
+
+	if (slots.next >= slots.capacity)
+	{
+		spdlog::error("Bindless {} array is full ({} slots)", TypeNames[static_cast<uint32_t>(type)], slots.capacity);
+		throw std::runtime_error("Bindless descriptor array exhausted.");
+	}
+
+	return slots.next++;
+}
+
+// Updates one array element of the global set.
+void BindlessDescriptors::write(BindlessType type, uint32_t index, const vk::DescriptorBufferInfo* bufferInfo, const vk::DescriptorImageInfo* imageInfo)
+{
+	uint32_t binding = static_cast<uint32_t>(type);
+
+	vk::WriteDescriptorSet descriptorWrite(m_Set, binding, index, 1, DescriptorTypes[binding], imageInfo, bufferInfo, nullptr);
+	m_Device.updateDescriptorSets(descriptorWrite, {});
+}
@@ -0,0 +1,85 @@
+#ifndef BINDLESS_DESCRIPTORS_H
+#define BINDLESS_DESCRIPTORS_H
+
+#include <vector>
+#include <array>
+#include <mutex>
+
+#include <vulkan/vulkan.hpp>
+#include "deletion_queue.h"
+
+// Resource arrays of the global descriptor set. The enum value is the binding index, matching
+// shader/bindless.glsl.
+enum class BindlessType : uint32_t
+{
+	StorageBuffer = 0,
+	SampledImage = 1,		// Combined image samplers
+	StorageImage = 2,
+	Count
+};
+
+// Sizes of the global descriptor arrays. Each is clamped to the device's update-after-bind limits.
+struct BindlessConfig
+{
+	uint32_t maxStorageBuffers = 65536;
+	uint32_t maxSampledImages = 65536;
+	uint32_t maxStorageImages = 8192;
+	uint32_t pushConstantSize = 128;		// Bytes of push constants in the shared pipeline layout
+};
+
+// One global, update-after-bind descriptor set holding every buffer and image, plus the
+// pipeline layout shared by all bindless pipelines. Resources are written once into a free
+// array slot and shaders pick them by index, passed in push constants, so draws never bind
+// descriptor sets. Released slots are recycled once the frames that may still index them
+// have completed.
+class BindlessDescriptors
+{
+public:
+	void init(vk::PhysicalDevice physicalDevice, vk::Device device, const BindlessConfig& config = {});
+	void destroy();
+
+	// Write a resource into a free slot and return its index. Safe to call while the set is
+	// bound by pending command buffers.
+	uint32_t add_storage_buffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+	uint32_t add_sampled_image(vk::ImageView imageView, vk::Sampler sampler, vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+	uint32_t add_storage_image(vk::ImageView imageView);
+
+	// Return a slot to the free list once lastUsedFrame has completed.
+	void release(BindlessType type, uint32_t index, uint64_t lastUsedFrame);
+	// Recycle slots released by frames up to and including completedFrame.
+	void collect(uint64_t completedFrame);
+
+	// Bind the global set to set 0 for the given bind point. Once per command buffer is enough.
+	void bind(vk::CommandBuffer commandBuffer, vk::PipelineBindPoint bindPoint) const;
+
+	vk::DescriptorSetLayout set_layout() const { return m_SetLayout; }
+	vk::DescriptorSet set() const { return m_Set; }
+	vk::PipelineLayout pipeline_layout() const { return m_PipelineLayout; }
+	uint32_t capacity(BindlessType type) const { return m_Slots[static_cast<uint32_t>(type)].capacity; }
+
+private:
+	static constexpr uint32_t TypeCount = static_cast<uint32_t>(BindlessType::Count);
+
+	struct SlotAllocator
+	{
+		uint32_t capacity = 0;
+		uint32_t next = 0;						// Slots at or above next have never been used
+		std::vector<uint32_t> freeList;
+	};
+
+	vk::Device m_Device;
+	vk::DescriptorPool m_Pool;
+	vk::DescriptorSetLayout m_SetLayout;
+	vk::DescriptorSet m_Set;
+	vk::PipelineLayout m_PipelineLayout;
+
+	std::array<SlotAllocator, TypeCount> m_Slots;
+	DeletionQueue m_PendingReleases;
+	std::mutex m_Mutex;
+
+private:
+	uint32_t allocate_slot(BindlessType type);
+	void write(BindlessType type, uint32_t index, const vk::DescriptorBufferInfo* bufferInfo, const vk::DescriptorImageInfo* imageInfo);
+};
+
+#endif
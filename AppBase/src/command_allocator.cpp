@@ -0,0 +1,47 @@
+#include "command_allocator.h"
+
+// Creates the transient command pool. Buffers can only be reset through the pool.
+void CommandAllocator::init(vk::Device device, uint32_t queueFamily)
+{
+	m_Device = device;
+
+	vk::CommandPoolCreateInfo poolInfo(vk::CommandPoolCreateFlagBits::eTransient, queueFamily);
+	m_Pool = m_Device.createCommandPool(poolInfo);
+}
+
+// Destroys the pool along with every command buffer allocated from it.
+void CommandAllocator::destroy()
+{
+	m_Device.destroyCommandPool(m_Pool);
+	m_Pool = nullptr;
+
+	m_Primary = {};
+	m_Secondary = {};
+}
+
+// Resets every command buffer in the pool at once and recycles them. Skipped if nothing
+// was allocated since the last reset.
+void CommandAllocator::reset()
+{
+	if (m_Primary.used == 0 && m_Secondary.used == 0)
+		return;
+
+	m_Device.resetCommandPool(m_Pool);
+	m_Primary.used = 0;
+	m_Secondary.used = 0;
+}
+
+// Hands out the next recycled command buffer of the given level, growing the pool if all
+// of them are in use.
+vk::CommandBuffer CommandAllocator::allocate(vk::CommandBufferLevel level)
+{
+	BufferList& list = level == vk::CommandBufferLevel::ePrimary ? m_Primary : m_Secondary;
+
+	if (list.used == list.buffers.size())
+	{
+		vk::CommandBufferAllocateInfo allocInfo(m_Pool, level, 1);
+		list.buffers.push_back(m_Device.allocateCommandBuffers(allocInfo).front());
+	}
+
+	return list.buffers[list.used++];
+}
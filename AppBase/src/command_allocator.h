@@ -0,0 +1,36 @@
+#ifndef COMMAND_ALLOCATOR_H
+#define COMMAND_ALLOCATOR_H
+
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+// Transient command pool whose buffers are recycled instead of reset or freed one by one.
+// reset() resets the whole pool in a single call and makes every buffer handed out since
+// the previous reset available again; allocate() returns those buffers before allocating
+// new ones. Not thread-safe: use one allocator per recording thread.
+class CommandAllocator
+{
+public:
+	void init(vk::Device device, uint32_t queueFamily);
+	void destroy();
+
+	// Reset the pool. None of its command buffers may still be pending execution.
+	void reset();
+
+	// Return a command buffer in the initial state, ready to begin.
+	vk::CommandBuffer allocate(vk::CommandBufferLevel level = vk::CommandBufferLevel::ePrimary);
+
+private:
+	struct BufferList
+	{
+		std::vector<vk::CommandBuffer> buffers;
+		uint32_t used = 0;		// Buffers handed out since the last reset
+	};
+
+	vk::Device m_Device;
+	vk::CommandPool m_Pool;
+	BufferList m_Primary, m_Secondary;
+};
+
+#endif
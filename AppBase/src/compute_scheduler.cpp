@@ -0,0 +1,120 @@
+#include "compute_scheduler.h"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+// Creates the timeline semaphores and one command allocator per frame in flight.
+void ComputeScheduler::init(vk::Device device, uint32_t queueFamily, vk::Queue queue, uint32_t framesInFlight, bool async, std::mutex& queueMutex)
+{
+	m_Device = device;
+	m_Queue = queue;
+	m_QueueMutex = &queueMutex;
+	m_QueueFamily = queueFamily;
+	m_Async = async;
+
+	vk::SemaphoreTypeCreateInfo timelineInfo(vk::SemaphoreType::eTimeline, 0);
+	vk::SemaphoreCreateInfo semaphoreInfo({}, &timelineInfo);
+	m_ComputeTimeline = m_Device.createSemaphore(semaphoreInfo);
+	m_GraphicsTimeline = m_Device.createSemaphore(semaphoreInfo);
+
+	m_Allocators.resize(framesInFlight);
+	for (CommandAllocator& allocator : m_Allocators)
+		allocator.init(m_Device, m_QueueFamily);
+	m_FrameValues.assign(framesInFlight, 0);
+
+	spdlog::info("Compute scheduler initialized ({} queue family {})", m_Async ? "async" : "graphics", m_QueueFamily);
+}
+
+// Destroys the command allocators and semaphores. The GPU must no longer be using them.
+void ComputeScheduler::destroy()
+{
+	if (!m_Device)
+		return;
+
+	for (CommandAllocator& allocator : m_Allocators)
+		allocator.destroy();
+	m_Allocators.clear();
+
+	m_Device.destroySemaphore(m_GraphicsTimeline);
+	m_Device.destroySemaphore(m_ComputeTimeline);
+	m_Device = nullptr;
+}
+
+// Selects the frame slot's allocator, waiting if compute work it recorded is still running.
+void ComputeScheduler::begin_frame(uint32_t frameIndex)
+{
+	m_FrameIndex = frameIndex;
+
+	// Work the graphics frame waited on has already finished; anything else is waited for here
+	wait(m_FrameValues[frameIndex]);
+	m_Allocators[frameIndex].reset();
+}
+
+// Records the work into a one-time command buffer and submits it on the compute queue.
+uint64_t ComputeScheduler::submit(const RecordFunction& recordFn, uint64_t waitGraphicsValue, vk::PipelineStageFlags2 waitStage)
+{
+	vk::CommandBuffer commandBuffer = m_Allocators[m_FrameIndex].allocate();
+	commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+	recordFn(commandBuffer);
+	commandBuffer.end();
+
+	uint64_t value = ++m_LastSubmitted;
+
+	vk::CommandBufferSubmitInfo commandBufferInfo(commandBuffer);
+	vk::SemaphoreSubmitInfo waitInfo(m_GraphicsTimeline, waitGraphicsValue, waitStage);
+	vk::SemaphoreSubmitInfo signalInfo(m_ComputeTimeline, value, vk::PipelineStageFlagBits2::eAllCommands);
+
+	vk::SubmitInfo2 submitInfo{};
+	if (waitGraphicsValue != 0)
+		submitInfo.setWaitSemaphoreInfos(waitInfo);
+	submitInfo.setCommandBufferInfos(commandBufferInfo);
+	submitInfo.setSignalSemaphoreInfos(signalInfo);
+	{
+		std::lock_guard lock(*m_QueueMutex);
+		m_Queue.submit2(submitInfo);
+	}
+
+	m_FrameValues[m_FrameIndex] = value;
+	return value;
+}
+
+// Accumulates the wait; one wait on the latest value covers all earlier ones.
+void ComputeScheduler::wait_in_graphics(uint64_t computeValue, vk::PipelineStageFlags2 dstStage)
+{
+	m_PendingWaitValue = std::max(m_PendingWaitValue, computeValue);
+	m_PendingWaitStages |= dstStage;
+}
+
+// Appends the accumulated compute wait and the graphics timeline signal, then clears the wait.
+void ComputeScheduler::prepare_graphics_submit(std::vector<vk::SemaphoreSubmitInfo>& waitInfos, std::vector<vk::SemaphoreSubmitInfo>& signalInfos, uint64_t graphicsValue)
+{
+	if (m_PendingWaitValue != 0)
+		waitInfos.emplace_back(m_ComputeTimeline, m_PendingWaitValue, m_PendingWaitStages);
+
+	signalInfos.emplace_back(m_GraphicsTimeline, graphicsValue, vk::PipelineStageFlagBits2::eAllCommands);
+
+	m_PendingWaitValue = 0;
+	m_PendingWaitStages = {};
+}
+
+// Returns true if the compute submission with the given value has finished executing.
+bool ComputeScheduler::is_complete(uint64_t computeValue)
+{
+	return m_Device.getSemaphoreCounterValue(m_ComputeTimeline) >= computeValue;
+}
+
+// Blocks until the compute submission with the given value has finished executing.
+void ComputeScheduler::wait(uint64_t computeValue)
+{
+	if (computeValue == 0)
+		return;
+
+	vk::SemaphoreWaitInfo waitInfo{};
+	waitInfo.setSemaphores(m_ComputeTimeline);
+	waitInfo.setValues(computeValue);
+
+	auto result = m_Device.waitSemaphores(waitInfo, UINT64_MAX);
+	if (result != vk::Result::eSuccess)
+		spdlog::error("Compute timeline wait failed: {}", vk::to_string(result));
+}
@@ -0,0 +1,75 @@
+#ifndef COMPUTE_SCHEDULER_H
+#define COMPUTE_SCHEDULER_H
+
+#include <vector>
+#include <functional>
+#include <mutex>
+
+#include <vulkan/vulkan.hpp>
+#include "command_allocator.h"
+
+// Submits compute work (culling, post-processing, simulation) to a dedicated compute queue
+// so it overlaps rasterization on hardware that executes queues concurrently. Two timeline
+// semaphores order the queues: compute submissions signal the compute timeline, and every
+// graphics frame signals the graphics timeline with its frame number plus one. Either side
+// waits on the other's values on the GPU, without host stalls.
+//
+// Without a separate compute family the queue is the graphics queue and the same calls
+// still work, executing in submission order. Resources used from both queue families must
+// be created with eConcurrent sharing. Call every method from the render thread; only the
+// queue itself is shared, so submits take queueMutex, which guards it against other
+// threads' submits.
+class ComputeScheduler
+{
+public:
+	// Records compute work into a command buffer that is already recording.
+	using RecordFunction = std::function<void(vk::CommandBuffer commandBuffer)>;
+
+	void init(vk::Device device, uint32_t queueFamily, vk::Queue queue, uint32_t framesInFlight, bool async, std::mutex& queueMutex);
+	void destroy();
+
+	// Wait for the frame slot's earlier compute submissions and recycle their command buffers.
+	// The slot's graphics fence must have signaled.
+	void begin_frame(uint32_t frameIndex);
+
+	// Record and submit compute work. It waits for the graphics timeline to reach
+	// waitGraphicsValue (0 for no dependency) before waitStage. Returns the compute timeline
+	// value signaled when the work completes.
+	uint64_t submit(const RecordFunction& recordFn, uint64_t waitGraphicsValue = 0, vk::PipelineStageFlags2 waitStage = vk::PipelineStageFlagBits2::eComputeShader);
+
+	// Make the next graphics submission wait for compute work up to computeValue before dstStage.
+	void wait_in_graphics(uint64_t computeValue, vk::PipelineStageFlags2 dstStage);
+	// Add the pending compute waits and the graphics timeline signal to a graphics submission.
+	void prepare_graphics_submit(std::vector<vk::SemaphoreSubmitInfo>& waitInfos, std::vector<vk::SemaphoreSubmitInfo>& signalInfos, uint64_t graphicsValue);
+
+	bool is_complete(uint64_t computeValue);
+	void wait(uint64_t computeValue);
+
+	// True if work runs on a queue family separate from graphics.
+	bool is_async() const { return m_Async; }
+	uint32_t queue_family() const { return m_QueueFamily; }
+	vk::Semaphore compute_timeline() const { return m_ComputeTimeline; }
+	vk::Semaphore graphics_timeline() const { return m_GraphicsTimeline; }
+
+private:
+	vk::Device m_Device;
+	vk::Queue m_Queue;
+	std::mutex* m_QueueMutex = nullptr;
+	uint32_t m_QueueFamily = 0;
+	bool m_Async = false;
+
+	vk::Semaphore m_ComputeTimeline;
+	vk::Semaphore m_GraphicsTimeline;
+	uint64_t m_LastSubmitted = 0;
+
+	// One command allocator per frame in flight, and the last value submitted from each
+	std::vector<CommandAllocator> m_Allocators;
+	std::vector<uint64_t> m_FrameValues;
+	uint32_t m_FrameIndex = 0;
+
+	// Compute work the next graphics submission must wait for
+	uint64_t m_PendingWaitValue = 0;
+	vk::PipelineStageFlags2 m_PendingWaitStages;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#include "deletion_queue.h"
+
+// Queues a deleter. Frames are pushed in increasing order, so the queue stays sorted.
+void DeletionQueue::push(uint64_t lastUsedFrame, std::function<void()>&& deleter)
+{
+	m_Entries.push_back({ lastUsedFrame, std::move(deleter) });
+}
+
+// Runs deleters whose resources are no longer referenced by in-flight frames.
+void DeletionQueue::flush(uint64_t completedFrame)
+{
+	while (!m_Entries.empty() && m_Entries.front().lastUsedFrame <= completedFrame)
+	{
+		m_Entries.front().deleter();
+		m_Entries.pop_front();
+	}
+}
+
+// Runs every remaining deleter in order.
+void DeletionQueue::flush_all()
+{
+	while (!m_Entries.empty())
+	{
+		m_Entries.front().deleter();
+		m_Entries.pop_front();
+	}
+}
@@ -0,0 +1,34 @@
+#ifndef DELETION_QUEUE_H
+#define DELETION_QUEUE_H
+
+#include <deque>
+#include <functional>
+
+// Defers destruction of GPU resources until the frames that may still reference them have
+// completed. Each deleter is tagged with the last frame number that used the resource and
+// runs once flush() is told that frame has finished on the GPU.
+class DeletionQueue
+{
+public:
+	// Queue a deleter for a resource last used by the given frame.
+	void push(uint64_t lastUsedFrame, std::function<void()>&& deleter);
+
+	// Run deleters for resources last used by frames up to and including completedFrame.
+	void flush(uint64_t completedFrame);
+
+	// Run all remaining deleters. The device must be idle.
+	void flush_all();
+
+	bool empty() const { return m_Entries.empty(); }
+
+private:
+	struct Entry
+	{
+		uint64_t lastUsedFrame;
+		std::function<void()> deleter;
+	};
+
+	std::deque<Entry> m_Entries;	// Ordered by lastUsedFrame
+};
+
+#endif
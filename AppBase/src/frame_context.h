@@ -0,0 +1,37 @@
+#ifndef FRAME_CONTEXT_H
+#define FRAME_CONTEXT_H
+
+#include <vulkan/vulkan.hpp>
+#include "command_allocator.h"
+#include "gpu_allocator.h"
+#include "linear_allocator.h"
+
+// Everything owned by one frame in flight. A context is reused once its fence signals,
+// at which point none of its objects are referenced by the GPU any more.
+struct FrameContext
+{
+	// Synchronization
+	vk::Semaphore imageAvailable;		// Signaled when the acquired swapchain image is ready
+	vk::Semaphore renderFinished;		// Signaled when rendering is done and presentation can occur
+	vk::Fence inFlight;					// Signaled when the GPU has finished the frame's submission
+
+	// Command recording. The allocator's pool is reset once per frame and commandBuffer is
+	// the frame's primary buffer, handed out again after each reset.
+	CommandAllocator commandAllocator;
+	vk::CommandBuffer commandBuffer;
+
+	// Descriptor sets allocated for this frame only, reset when the context is reused
+	vk::DescriptorPool descriptorPool;
+
+	// Uniforms, instance data and dynamic vertices written by the CPU for this frame only.
+	// A slice of the shared frame data buffer, reset when the context is reused
+	LinearAllocator frameAllocator;
+
+	// Headless mode: host-visible copy of the frame's offscreen image, delivered through
+	// on_readback once the context's fence has signaled
+	AllocatedBuffer readbackBuffer;
+	uint64_t readbackFrame = 0;
+	bool readbackPending = false;
+};
+
+#endif
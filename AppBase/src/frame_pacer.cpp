@@ -0,0 +1,71 @@
+#include <thread>
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+#include "frame_pacer.h"
+
+// Stores the pacing configuration and the dispatcher used for vkWaitForPresentKHR.
+void FramePacer::init(vk::Device device, const vk::DispatchLoaderDynamic& dispatch, const FramePacingConfig& config)
+{
+	m_Device = device;
+	m_Dispatch = &dispatch;
+	m_Config = config;
+	m_NextFrameStart = std::chrono::steady_clock::now();
+}
+
+// Waits for older presents to be displayed, then sleeps out the remainder of the target
+// frame time.
+void FramePacer::wait_for_next_frame(vk::SwapchainKHR swapchain)
+{
+	if (m_Config.present_wait && m_LastPresentId >= m_Config.max_queued_presents)
+	{
+		uint64_t waitId = m_LastPresentId - m_Config.max_queued_presents + 1;
+
+		if (waitId >= m_SwapchainFirstPresentId)
+		{
+			try
+			{
+				auto result = m_Device.waitForPresentKHR(swapchain, waitId, m_Config.present_wait_timeout_ns, *m_Dispatch);
+				if (result == vk::Result::eTimeout)
+					spdlog::debug("Present wait for frame {} timed out", waitId);
+			}
+			catch (const vk::OutOfDateKHRError&)
+			{
+				// The swapchain is recreated by the caller once acquire or present reports it
+			}
+		}
+	}
+
+	if (m_Config.target_frame_time_ms <= 0.0)
+		return;
+
+	using namespace std::chrono;
+	auto now = steady_clock::now();
+	auto frameTime = duration_cast<steady_clock::duration>(duration<double, std::milli>(m_Config.target_frame_time_ms));
+
+	// Sleep coarsely, then spin the last millisecond since sleeps routinely overshoot
+	if (m_NextFrameStart > now + 1ms)
+		std::this_thread::sleep_until(m_NextFrameStart - 1ms);
+
+	while (steady_clock::now() < m_NextFrameStart)
+		std::this_thread::yield();
+
+	// Schedule from the previous deadline to avoid drift, but don't try to catch up on
+	// frames that ran long
+	m_NextFrameStart = std::max(m_NextFrameStart, now) + frameTime;
+}
+
+// Hands out monotonically increasing present IDs.
+uint64_t FramePacer::next_present_id()
+{
+	if (!m_Config.present_wait)
+		return 0;
+
+	return ++m_LastPresentId;
+}
+
+// Starts a new present ID range for the new swapchain.
+void FramePacer::on_swapchain_recreated()
+{
+	m_SwapchainFirstPresentId = m_LastPresentId + 1;
+}
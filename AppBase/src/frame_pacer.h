@@ -0,0 +1,47 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <chrono>
+
+#include <vulkan/vulkan.hpp>
+
+struct FramePacingConfig
+{
+	double target_frame_time_ms = 0.0;		// Minimum time between frame starts, 0 for uncapped
+	bool present_wait = false;				// Limit queued presents with VK_KHR_present_id/present_wait
+	uint32_t max_queued_presents = 1;		// Presents allowed between the display and the next frame
+	uint64_t present_wait_timeout_ns = 100'000'000;
+};
+
+// Bounds input-to-photon latency by deciding when the next frame may start. With present
+// wait enabled, a frame only starts once the present max_queued_presents frames ago has
+// reached the display, instead of however deep the driver lets the present queue grow. A
+// target frame time additionally caps the frame rate.
+class FramePacer
+{
+public:
+	void init(vk::Device device, const vk::DispatchLoaderDynamic& dispatch, const FramePacingConfig& config);
+
+	// Block until the next frame may begin.
+	void wait_for_next_frame(vk::SwapchainKHR swapchain);
+
+	// Return the present ID to attach to the next present, or 0 if present wait is disabled.
+	uint64_t next_present_id();
+
+	// Present IDs are per swapchain; presents on a retired swapchain are never waited on.
+	void on_swapchain_recreated();
+
+	void set_target_frame_time(double milliseconds) { m_Config.target_frame_time_ms = milliseconds; }
+	const FramePacingConfig& config() const { return m_Config; }
+
+private:
+	vk::Device m_Device;
+	const vk::DispatchLoaderDynamic* m_Dispatch = nullptr;
+	FramePacingConfig m_Config;
+
+	uint64_t m_LastPresentId = 0;
+	uint64_t m_SwapchainFirstPresentId = 1;		// First present ID used on the current swapchain
+	std::chrono::steady_clock::time_point m_NextFrameStart;
+};
+
+#endif
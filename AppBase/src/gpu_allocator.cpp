@@ -0,0 +1,414 @@
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+#include <spdlog/spdlog.h>
+#include "gpu_allocator.h"
+
+namespace
+{
+	vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+// Queries memory properties and limits required for sub-allocation.
+void GpuAllocator::init(vk::PhysicalDevice physicalDevice, vk::Device device, vk::DeviceSize blockSize, uint32_t deviceGroupSize)
+{
+	m_Device = device;
+	m_BlockSize = blockSize;
+	m_DeviceGroupSize = deviceGroupSize;
+	m_MemoryProperties = physicalDevice.getMemoryProperties();
+	m_Granularity = physicalDevice.getProperties().limits.bufferImageGranularity;
+
+	detect_architecture(physicalDevice);
+}
+
+// Frees every block back to the driver.
+void GpuAllocator::destroy()
+{
+	std::lock_guard lock(m_Mutex);
+
+	for (auto& blocks : m_Blocks)
+	{
+		for (auto& block : blocks)
+		{
+			if (block->allocationCount > 0)
+				spdlog::warn("GPU allocator destroyed with {} live allocation(s) in memory type {}", block->allocationCount, block->memoryTypeIndex);
+
+			if (block->mapped)
+				m_Device.unmapMemory(block->memory);
+			m_Device.freeMemory(block->memory);
+		}
+		blocks.clear();
+	}
+}
+
+// Sub-allocates memory from an existing block, creating a new block if none has room.
+// Requests of at least half a block get a dedicated allocation.
+Allocation GpuAllocator::allocate(const vk::MemoryRequirements& requirements, uint32_t memoryTypeIndex, AllocationKind kind)
+{
+	assert(memoryTypeIndex < m_MemoryProperties.memoryTypeCount && "Invalid memory type index!");
+
+	std::lock_guard lock(m_Mutex);
+
+	// Without a granularity constraint all resources may share blocks
+	if (m_Granularity <= 1)
+		kind = AllocationKind::Linear;
+
+	vk::DeviceSize alignment = std::max<vk::DeviceSize>(requirements.alignment, 1);
+	vk::DeviceSize blockSize = block_size_for(memoryTypeIndex);
+
+	MemoryBlock* target = nullptr;
+	vk::DeviceSize offset = 0;
+
+	if (requirements.size >= blockSize / 2)
+	{
+		target = create_block(memoryTypeIndex, requirements.size, kind, true);
+		erase_free_range(*target, 0, target->size);
+	}
+	else
+	{
+		for (auto& block : m_Blocks[memoryTypeIndex])
+		{
+			if (block->dedicated || block->kind != kind)
+				continue;
+
+			if (suballocate(*block, requirements.size, alignment, offset))
+			{
+				target = block.get();
+				break;
+			}
+		}
+
+		if (!target)
+		{
+			target = create_block(memoryTypeIndex, blockSize, kind, false);
+			suballocate(*target, requirements.size, alignment, offset);
+		}
+	}
+
+	target->allocationCount++;
+
+	Allocation allocation;
+	allocation.memory = target->memory;
+	allocation.offset = offset;
+	allocation.size = requirements.size;
+	allocation.mapped = target->mapped ? static_cast<char*>(target->mapped) + offset : nullptr;
+	allocation.memoryTypeIndex = memoryTypeIndex;
+	allocation.block = target;
+	return allocation;
+}
+
+// Returns a sub-allocation to its block and releases empty blocks.
+void GpuAllocator::free(Allocation& allocation)
+{
+	if (!allocation)
+		return;
+
+	std::lock_guard lock(m_Mutex);
+
+	MemoryBlock* block = allocation.block;
+	insert_free_range(*block, allocation.offset, allocation.size);
+	block->allocationCount--;
+
+	if (block->allocationCount == 0)
+	{
+		// Keep one empty block per memory type around to avoid allocation churn
+		auto& blocks = m_Blocks[block->memoryTypeIndex];
+		size_t emptyBlocks = std::count_if(blocks.begin(), blocks.end(),
+			[](const auto& b) { return !b->dedicated && b->allocationCount == 0; });
+
+		if (block->dedicated || emptyBlocks > 1)
+			destroy_block(block);
+	}
+
+	allocation = {};
+}
+
+// Gathers usage statistics over all blocks.
+AllocatorStats GpuAllocator::get_stats() const
+{
+	std::lock_guard lock(m_Mutex);
+
+	AllocatorStats stats{};
+	for (const auto& blocks : m_Blocks)
+	{
+		for (const auto& block : blocks)
+		{
+			stats.blockCount++;
+			stats.dedicatedBlockCount += block->dedicated ? 1 : 0;
+			stats.allocationCount += block->allocationCount;
+			stats.bytesReserved += block->size;
+
+			for (const auto& [offset, size] : block->freeByOffset)
+			{
+				stats.bytesFree += size;
+				stats.largestFreeRange = std::max(stats.largestFreeRange, size);
+			}
+		}
+	}
+
+	stats.bytesInUse = stats.bytesReserved - stats.bytesFree;
+	return stats;
+}
+
+// Logs a one-line summary of allocator usage.
+void GpuAllocator::log_stats() const
+{
+	AllocatorStats stats = get_stats();
+	constexpr double mib = 1024.0 * 1024.0;
+
+	spdlog::info("GPU memory: {} block(s) ({} dedicated), {} allocation(s), {:.2f} MiB in use / {:.2f} MiB reserved, {:.1f}% fragmented",
+		stats.blockCount,
+		stats.dedicatedBlockCount,
+		stats.allocationCount,
+		stats.bytesInUse / mib,
+		stats.bytesReserved / mib,
+		stats.fragmentation() * 100.0f
+	);
+}
+
+// Allocates a new device memory block, persistently mapping it if host-visible.
+MemoryBlock* GpuAllocator::create_block(uint32_t memoryTypeIndex, vk::DeviceSize size, AllocationKind kind, bool dedicated)
+{
+	vk::MemoryAllocateInfo allocInfo(size, memoryTypeIndex);
+
+	auto block = std::make_unique<MemoryBlock>();
+	block->memory = m_Device.allocateMemory(allocInfo);
+	block->size = size;
+	block->memoryTypeIndex = memoryTypeIndex;
+	block->kind = kind;
+	block->dedicated = dedicated;
+
+	if (m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+		block->mapped = m_Device.mapMemory(block->memory, 0, VK_WHOLE_SIZE);
+
+	insert_free_range(*block, 0, size);
+
+	MemoryBlock* ptr = block.get();
+	m_Blocks[memoryTypeIndex].push_back(std::move(block));
+	return ptr;
+}
+
+// Frees a block's device memory and removes it from its memory type's list.
+void GpuAllocator::destroy_block(MemoryBlock* block)
+{
+	if (block->mapped)
+		m_Device.unmapMemory(block->memory);
+	m_Device.freeMemory(block->memory);
+
+	auto& blocks = m_Blocks[block->memoryTypeIndex];
+	blocks.erase(std::find_if(blocks.begin(), blocks.end(),
+		[block](const auto& b) { return b.get() == block; }));
+}
+
+// Best-fit search of a block's free ranges. Splits the chosen range on success.
+bool GpuAllocator::suballocate(MemoryBlock& block, vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset)
+{
+	for (auto it = block.freeBySize.lower_bound(size); it != block.freeBySize.end(); ++it)
+	{
+		vk::DeviceSize rangeSize = it->first;
+		vk::DeviceSize rangeOffset = it->second;
+		vk::DeviceSize alignedOffset = align_up(rangeOffset, alignment);
+		vk::DeviceSize padding = alignedOffset - rangeOffset;
+
+		if (padding + size > rangeSize)
+			continue;
+
+		erase_free_range(block, rangeOffset, rangeSize);
+
+		// Return the leading padding and trailing remainder to the free list
+		if (padding > 0)
+			insert_free_range(block, rangeOffset, padding);
+		if (rangeSize - padding - size > 0)
+			insert_free_range(block, alignedOffset + size, rangeSize - padding - size);
+
+		offset = alignedOffset;
+		return true;
+	}
+
+	return false;
+}
+
+// Adds a free range, coalescing it with adjacent free ranges.
+void GpuAllocator::insert_free_range(MemoryBlock& block, vk::DeviceSize offset, vk::DeviceSize size)
+{
+	auto next = block.freeByOffset.lower_bound(offset);
+
+	// Merge with the following range
+	if (next != block.freeByOffset.end() && offset + size == next->first)
+	{
+		vk::DeviceSize nextSize = next->second;
+		erase_free_range(block, next->first, nextSize);
+		size += nextSize;
+		next = block.freeByOffset.lower_bound(offset);
+	}
+
+	// Merge with the preceding range
+	if (next != block.freeByOffset.begin())
+	{
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset)
+		{
+			vk::DeviceSize prevOffset = prev->first;
+			vk::DeviceSize prevSize = prev->second;
+			erase_free_range(block, prevOffset, prevSize);
+			offset = prevOffset;
+			size += prevSize;
+		}
+	}
+
+	block.freeByOffset.emplace(offset, size);
+	block.freeBySize.emplace(size, offset);
+}
+
+// Removes a free range from both indices.
+void GpuAllocator::erase_free_range(MemoryBlock& block, vk::DeviceSize offset, vk::DeviceSize size)
+{
+	block.freeByOffset.erase(offset);
+
+	auto [first, last] = block.freeBySize.equal_range(size);
+	for (auto it = first; it != last; ++it)
+	{
+		if (it->second == offset)
+		{
+			block.freeBySize.erase(it);
+			break;
+		}
+	}
+}
+
+// Picks the block size for a memory type, scaled down for small heaps (e.g. a 256 MiB BAR heap).
+vk::DeviceSize GpuAllocator::block_size_for(uint32_t memoryTypeIndex) const
+{
+	uint32_t heapIndex = m_MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	vk::DeviceSize heapSize = m_MemoryProperties.memoryHeaps[heapIndex].size;
+	return std::min(m_BlockSize, heapSize / 8);
+}
+
+// Scores every allowed memory type: each preferred flag present outweighs any number of
+// unwanted ones, and ties go to the lower index, the driver's own ordering.
+uint32_t GpuAllocator::find_memory_type(uint32_t typeBits, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred, vk::MemoryPropertyFlags unwanted) const
+{
+	// Never pick protected or lazily allocated memory unless explicitly required
+	vk::MemoryPropertyFlags excluded = (vk::MemoryPropertyFlagBits::eProtected | vk::MemoryPropertyFlagBits::eLazilyAllocated) & ~required;
+
+	auto flag_count = [](vk::MemoryPropertyFlags flags)
+	{
+		return static_cast<int32_t>(std::popcount(static_cast<VkMemoryPropertyFlags>(flags)));
+	};
+
+	uint32_t bestType = UINT32_MAX;
+	int32_t bestScore = INT32_MIN;
+
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+	{
+		vk::MemoryPropertyFlags flags = m_MemoryProperties.memoryTypes[i].propertyFlags;
+
+		if (!(typeBits & (1u << i)) || (flags & required) != required || (flags & excluded) || !is_usable_type(i))
+			continue;
+
+		int32_t score = flag_count(flags & preferred) * 16 - flag_count(flags & unwanted);
+		if (score > bestScore)
+		{
+			bestScore = score;
+			bestType = i;
+		}
+	}
+
+	return bestType;
+}
+
+// Maps the usage to required, preferred and unwanted flags.
+uint32_t GpuAllocator::find_memory_type(uint32_t typeBits, MemoryUsage usage) const
+{
+	using Flag = vk::MemoryPropertyFlagBits;
+
+	vk::MemoryPropertyFlags required, preferred, unwanted;
+	switch (usage)
+	{
+	case MemoryUsage::GpuOnly:
+		required = Flag::eDeviceLocal;
+		unwanted = Flag::eHostVisible;		// Leave the BAR window to resources the CPU writes
+		break;
+	case MemoryUsage::Static:
+		required = Flag::eDeviceLocal;
+		if (m_Architecture.direct_device_writes())
+			preferred = Flag::eHostVisible | Flag::eHostCoherent;
+		else
+			unwanted = Flag::eHostVisible;
+		break;
+	case MemoryUsage::Dynamic:
+		required = Flag::eHostVisible | Flag::eHostCoherent;
+		preferred = Flag::eDeviceLocal;
+		break;
+	case MemoryUsage::Staging:
+		required = Flag::eHostVisible | Flag::eHostCoherent;
+		unwanted = Flag::eDeviceLocal | Flag::eHostCached;	// Write-combined system memory
+		break;
+	case MemoryUsage::Readback:
+		required = Flag::eHostVisible | Flag::eHostCoherent;
+		preferred = Flag::eHostCached;
+		unwanted = Flag::eDeviceLocal;
+		break;
+	}
+
+	uint32_t memoryType = find_memory_type(typeBits, required, preferred, unwanted);
+
+	// Only the resource's own constraints are left; host access checks fall back to staging
+	if (memoryType == UINT32_MAX && usage != MemoryUsage::Dynamic && usage != MemoryUsage::Staging && usage != MemoryUsage::Readback)
+		memoryType = find_memory_type(typeBits, {}, preferred, unwanted);
+
+	return memoryType;
+}
+
+// Checks for a persistent mapping of coherent memory.
+bool GpuAllocator::is_host_writable(const Allocation& allocation) const
+{
+	return allocation.mapped && (memory_type_flags(allocation.memoryTypeIndex) & vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+// Classifies the device as UMA, resizable BAR or discrete with at most a small BAR window.
+void GpuAllocator::detect_architecture(vk::PhysicalDevice physicalDevice)
+{
+	using Flag = vk::MemoryPropertyFlagBits;
+
+	// The largest device-local heap holds the bulk of video memory
+	vk::DeviceSize deviceLocalHeapSize = 0;
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryHeapCount; i++)
+	{
+		if (m_MemoryProperties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal)
+			deviceLocalHeapSize = std::max(deviceLocalHeapSize, m_MemoryProperties.memoryHeaps[i].size);
+	}
+
+	bool allDeviceLocalHostVisible = true;
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+	{
+		const vk::MemoryType& type = m_MemoryProperties.memoryTypes[i];
+		if (!(type.propertyFlags & Flag::eDeviceLocal))
+			continue;
+
+		if ((type.propertyFlags & Flag::eHostVisible) && is_usable_type(i))
+			m_Architecture.hostVisibleDeviceLocalSize = std::max(m_Architecture.hostVisibleDeviceLocalSize, m_MemoryProperties.memoryHeaps[type.heapIndex].size);
+		else
+			allDeviceLocalHostVisible = false;
+	}
+
+	m_Architecture.unifiedMemory = allDeviceLocalHostVisible || physicalDevice.getProperties().deviceType == vk::PhysicalDeviceType::eIntegratedGpu;
+	m_Architecture.resizableBar = !m_Architecture.unifiedMemory && deviceLocalHeapSize > 0
+		&& m_Architecture.hostVisibleDeviceLocalSize == deviceLocalHeapSize;
+
+	spdlog::info("Memory architecture: {}, {} MiB host-visible device-local memory",
+		m_Architecture.unifiedMemory ? "unified" : m_Architecture.resizableBar ? "discrete with resizable BAR" : "discrete",
+		m_Architecture.hostVisibleDeviceLocalSize / (1024 * 1024));
+}
+
+// Multi-instance heaps only hold one copy per GPU within a device group of several GPUs.
+bool GpuAllocator::is_usable_type(uint32_t memoryTypeIndex) const
+{
+	const vk::MemoryType& type = m_MemoryProperties.memoryTypes[memoryTypeIndex];
+	bool multiInstance = m_DeviceGroupSize > 1 && (m_MemoryProperties.memoryHeaps[type.heapIndex].flags & vk::MemoryHeapFlagBits::eMultiInstance);
+	return !(multiInstance && (type.propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible));
+}
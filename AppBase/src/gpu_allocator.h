@@ -0,0 +1,148 @@
+#ifndef GPU_ALLOCATOR_H
+#define GPU_ALLOCATOR_H
+
+#include <vector>
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <vulkan/vulkan.hpp>
+
+// Resource kind of a sub-allocation. Linear and optimal resources are kept in separate
+// blocks so neighbouring sub-allocations never violate bufferImageGranularity.
+enum class AllocationKind
+{
+	Linear,		// Buffers and linearly tiled images
+	Optimal,	// Optimally tiled images
+};
+
+// How a resource's memory is accessed, used to pick the best memory type for it.
+enum class MemoryUsage
+{
+	GpuOnly,	// Written and read by the GPU only: render targets, GPU-generated data
+	Static,		// Written once by the CPU, then read by the GPU. Mappable when all of device-local
+				// memory is host-visible (UMA or resizable BAR), so uploads can skip the staging copy
+	Dynamic,	// Rewritten by the CPU every frame: host-visible, device-local when available
+	Staging,	// CPU-written transfer source: host-visible, outside device-local memory if possible
+	Readback,	// Written by the GPU and read by the CPU: host-visible, cached if possible
+};
+
+// Memory heap layout of the device, derived from its memory types and heaps.
+struct MemoryArchitecture
+{
+	bool unifiedMemory = false;		// Every device-local type is host-visible (integrated GPUs)
+	bool resizableBar = false;		// The main device-local heap is host-visible, not just a 256 MiB window
+	vk::DeviceSize hostVisibleDeviceLocalSize = 0;
+
+	// Static resources can be written in place instead of through a staging buffer
+	bool direct_device_writes() const { return unifiedMemory || resizableBar; }
+};
+
+// A single vk::DeviceMemory allocation that sub-allocations are carved out of.
+struct MemoryBlock
+{
+	vk::DeviceMemory memory;
+	vk::DeviceSize size = 0;
+	void* mapped = nullptr;
+	uint32_t memoryTypeIndex = 0;
+	AllocationKind kind = AllocationKind::Linear;
+	bool dedicated = false;
+	uint32_t allocationCount = 0;
+
+	// Free ranges indexed by offset (for coalescing) and by size (for best-fit search).
+	std::map<vk::DeviceSize, vk::DeviceSize> freeByOffset;
+	std::multimap<vk::DeviceSize, vk::DeviceSize> freeBySize;
+};
+
+// A sub-allocated range of device memory.
+struct Allocation
+{
+	vk::DeviceMemory memory;
+	vk::DeviceSize offset = 0;
+	vk::DeviceSize size = 0;
+	void* mapped = nullptr;		// Persistent host mapping, null for non host-visible memory
+	uint32_t memoryTypeIndex = 0;
+	MemoryBlock* block = nullptr;
+
+	explicit operator bool() const { return block != nullptr; }
+};
+
+// A buffer bound to a sub-allocation.
+struct AllocatedBuffer
+{
+	vk::Buffer buffer;
+	Allocation allocation;
+};
+
+// Snapshot of allocator usage.
+struct AllocatorStats
+{
+	uint32_t blockCount = 0;
+	uint32_t dedicatedBlockCount = 0;
+	uint32_t allocationCount = 0;
+	vk::DeviceSize bytesReserved = 0;		// Device memory allocated from the driver
+	vk::DeviceSize bytesInUse = 0;			// Bytes handed out to sub-allocations
+	vk::DeviceSize bytesFree = 0;
+	vk::DeviceSize largestFreeRange = 0;
+
+	// Fraction of free memory outside the largest free range (0 = unfragmented).
+	float fragmentation() const
+	{
+		return bytesFree ? 1.0f - static_cast<float>(largestFreeRange) / static_cast<float>(bytesFree) : 0.0f;
+	}
+};
+
+// Block-based device memory allocator. Each memory type owns a list of large blocks that
+// are sub-allocated with a best-fit free list, so resource creation does not hit
+// vkAllocateMemory (or maxMemoryAllocationCount) for every buffer.
+class GpuAllocator
+{
+public:
+	// With a device group of more than one GPU, host-visible memory types in heaps that have
+	// one instance per GPU are never used, since such memory cannot be mapped.
+	void init(vk::PhysicalDevice physicalDevice, vk::Device device, vk::DeviceSize blockSize, uint32_t deviceGroupSize = 1);
+	void destroy();
+
+	// Sub-allocate memory satisfying the given requirements from the given memory type.
+	Allocation allocate(const vk::MemoryRequirements& requirements, uint32_t memoryTypeIndex, AllocationKind kind = AllocationKind::Linear);
+	void free(Allocation& allocation);
+
+	AllocatorStats get_stats() const;
+	void log_stats() const;
+
+	// Pick the memory type allowed by typeBits that has the required flags, the most preferred
+	// flags and the fewest unwanted ones. Returns UINT32_MAX if no type has the required flags.
+	uint32_t find_memory_type(uint32_t typeBits, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred = {}, vk::MemoryPropertyFlags unwanted = {}) const;
+	// Pick the best memory type for a usage, relaxing to any allowed type if needed.
+	uint32_t find_memory_type(uint32_t typeBits, MemoryUsage usage) const;
+
+	vk::MemoryPropertyFlags memory_type_flags(uint32_t memoryTypeIndex) const { return m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags; }
+	// True if the allocation is mapped and coherent, so the CPU can write it without flushes.
+	bool is_host_writable(const Allocation& allocation) const;
+	const MemoryArchitecture& architecture() const { return m_Architecture; }
+
+private:
+	vk::Device m_Device;
+	vk::PhysicalDeviceMemoryProperties m_MemoryProperties;
+	MemoryArchitecture m_Architecture;
+	vk::DeviceSize m_BlockSize = 0;
+	uint32_t m_DeviceGroupSize = 1;
+	vk::DeviceSize m_Granularity = 1;
+
+	std::array<std::vector<std::unique_ptr<MemoryBlock>>, VK_MAX_MEMORY_TYPES> m_Blocks;
+	mutable std::mutex m_Mutex;
+
+private:
+	MemoryBlock* create_block(uint32_t memoryTypeIndex, vk::DeviceSize size, AllocationKind kind, bool dedicated);
+	void destroy_block(MemoryBlock* block);
+	bool suballocate(MemoryBlock& block, vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset);
+	void insert_free_range(MemoryBlock& block, vk::DeviceSize offset, vk::DeviceSize size);
+	void erase_free_range(MemoryBlock& block, vk::DeviceSize offset, vk::DeviceSize size);
+	vk::DeviceSize block_size_for(uint32_t memoryTypeIndex) const;
+	void detect_architecture(vk::PhysicalDevice physicalDevice);
+	// False for host-visible types that cannot be mapped within the device group
+	bool is_usable_type(uint32_t memoryTypeIndex) const;
+};
+
+#endif
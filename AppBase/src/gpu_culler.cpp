@@ -0,0 +1,132 @@
+#include "gpu_culler.h"
+
+#include <array>
+
+#include <spdlog/spdlog.h>
+#include "pipeline_builder.h"
+
+// Creates the descriptor set layout, pipeline layout, pyramid sampler and culling pipelines.
+void GpuCuller::init(vk::Device device, ShaderLibrary& shaderLibrary, PipelineCache* pipelineCache, const std::string& frustumShaderPath,
+	const std::string& occlusionShaderPath, uint32_t workgroupSize)
+{
+	m_Device = device;
+	m_WorkgroupSize = workgroupSize;
+
+	// Objects, draw commands, draw count and the optional depth pyramid
+	std::array<vk::DescriptorSetLayoutBinding, 4> bindings = {
+		vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+		vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+		vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+		vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute)
+	};
+	m_SetLayout = m_Device.createDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo({}, bindings));
+
+	vk::PushConstantRange pushConstantRange(vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullConstants));
+	m_PipelineLayout = m_Device.createPipelineLayout(vk::PipelineLayoutCreateInfo({}, m_SetLayout, pushConstantRange));
+
+	// Nearest sampling keeps the pyramid's farthest-depth texels intact
+	vk::SamplerCreateInfo samplerInfo{};
+	samplerInfo.magFilter = vk::Filter::eNearest;
+	samplerInfo.minFilter = vk::Filter::eNearest;
+	samplerInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+	samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+	samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+	samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	m_PyramidSampler = m_Device.createSampler(samplerInfo);
+
+	SpecializationMap<WorkgroupSizeConstant> constants;
+	constants.set<WorkgroupSizeConstant>(m_WorkgroupSize);
+
+	PipelineBuilder frustumBuilder(PipelineType::Compute, &shaderLibrary);
+	frustumBuilder.add_shader_stage(frustumShaderPath, vk::ShaderStageFlagBits::eCompute, constants)
+		.set_pipeline_layout(m_PipelineLayout);
+	m_FrustumPipeline = frustumBuilder.build(m_Device, pipelineCache);
+
+	if (!occlusionShaderPath.empty())
+	{
+		PipelineBuilder occlusionBuilder(PipelineType::Compute, &shaderLibrary);
+		occlusionBuilder.add_shader_stage(occlusionShaderPath, vk::ShaderStageFlagBits::eCompute, constants)
+			.set_pipeline_layout(m_PipelineLayout);
+		m_OcclusionPipeline = occlusionBuilder.build(m_Device, pipelineCache);
+	}
+
+	spdlog::info("GPU culler initialized (Hi-Z occlusion {})", supports_occlusion() ? "enabled" : "disabled");
+}
+
+// Destroys the pipelines and layouts. The GPU must no longer be using them.
+void GpuCuller::destroy()
+{
+	if (!m_Device)
+		return;
+
+	m_OcclusionPipeline.reset();
+	m_FrustumPipeline.reset();
+	m_Device.destroySampler(m_PyramidSampler);
+	m_Device.destroyPipelineLayout(m_PipelineLayout);
+	m_Device.destroyDescriptorSetLayout(m_SetLayout);
+	m_Device = nullptr;
+}
+
+// Records the count reset, the culling dispatch and the barriers around them.
+void GpuCuller::cull(vk::CommandBuffer commandBuffer, vk::DescriptorPool descriptorPool, const CullParams& params, const IndirectDrawBuffer& drawBuffer)
+{
+	bool occlusion = params.depthPyramid && supports_occlusion();
+
+	vk::DescriptorSetAllocateInfo allocateInfo(descriptorPool, m_SetLayout);
+	vk::DescriptorSet descriptorSet = m_Device.allocateDescriptorSets(allocateInfo).front();
+
+	vk::DescriptorBufferInfo objectsInfo(params.objects, 0, VK_WHOLE_SIZE);
+	vk::DescriptorBufferInfo commandsInfo(drawBuffer.commands.buffer, 0, VK_WHOLE_SIZE);
+	vk::DescriptorBufferInfo countInfo(drawBuffer.count.buffer, 0, VK_WHOLE_SIZE);
+	vk::DescriptorImageInfo pyramidInfo(m_PyramidSampler, params.depthPyramid, vk::ImageLayout::eShaderReadOnlyOptimal);
+
+	std::array<vk::WriteDescriptorSet, 4> writes = {
+		vk::WriteDescriptorSet(descriptorSet, 0, 0, vk::DescriptorType::eStorageBuffer, {}, objectsInfo),
+		vk::WriteDescriptorSet(descriptorSet, 1, 0, vk::DescriptorType::eStorageBuffer, {}, commandsInfo),
+		vk::WriteDescriptorSet(descriptorSet, 2, 0, vk::DescriptorType::eStorageBuffer, {}, countInfo),
+		vk::WriteDescriptorSet(descriptorSet, 3, 0, vk::DescriptorType::eCombinedImageSampler, pyramidInfo)
+	};
+	m_Device.updateDescriptorSets(occlusion ? 4 : 3, writes.data(), 0, nullptr);
+
+	// Earlier indirect draws, possibly from a previous frame, must finish reading the buffers
+	// before they are overwritten
+	vk::MemoryBarrier2 beforeReset(
+		vk::PipelineStageFlagBits2::eDrawIndirect, vk::AccessFlagBits2::eNone,
+		vk::PipelineStageFlagBits2::eTransfer | vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eNone
+	);
+	vk::DependencyInfo beforeResetInfo{};
+	beforeResetInfo.setMemoryBarriers(beforeReset);
+	commandBuffer.pipelineBarrier2(beforeResetInfo);
+
+	commandBuffer.fillBuffer(drawBuffer.count.buffer, 0, sizeof(uint32_t), 0);
+
+	vk::MemoryBarrier2 afterReset(
+		vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferWrite,
+		vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite
+	);
+	vk::DependencyInfo afterResetInfo{};
+	afterResetInfo.setMemoryBarriers(afterReset);
+	commandBuffer.pipelineBarrier2(afterResetInfo);
+
+	CullConstants constants{
+		params.viewProjection,
+		glm::vec2(static_cast<float>(params.depthPyramidExtent.width), static_cast<float>(params.depthPyramidExtent.height)),
+		params.objectCount,
+		drawBuffer.maxDraws
+	};
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, occlusion ? m_OcclusionPipeline.get() : m_FrustumPipeline.get());
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, m_PipelineLayout, 0, descriptorSet, {});
+	commandBuffer.pushConstants(m_PipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(CullConstants), &constants);
+	commandBuffer.dispatch((params.objectCount + m_WorkgroupSize - 1) / m_WorkgroupSize, 1, 1);
+
+	// The compacted commands and count are consumed by drawIndexedIndirectCount
+	vk::MemoryBarrier2 afterCull(
+		vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eShaderStorageWrite,
+		vk::PipelineStageFlagBits2::eDrawIndirect, vk::AccessFlagBits2::eIndirectCommandRead
+	);
+	vk::DependencyInfo afterCullInfo{};
+	afterCullInfo.setMemoryBarriers(afterCull);
+	commandBuffer.pipelineBarrier2(afterCullInfo);
+}
@@ -0,0 +1,79 @@
+#ifndef GPU_CULLER_H
+#define GPU_CULLER_H
+
+#include <string>
+
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include "shader_library.h"
+#include "pipeline_cache.h"
+#include "indirect_draw.h"
+#include "specialization.h"
+
+// Per-object input of the culling pass, matching CullObject in shader/cull.comp (std430).
+struct CullObject
+{
+	glm::vec4 boundingSphere;	// World-space center in xyz, radius in w
+	uint32_t indexCount = 0;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	uint32_t padding = 0;
+};
+
+// Inputs of one culling dispatch.
+struct CullParams
+{
+	glm::mat4 viewProjection{ 1.0f };
+	vk::Buffer objects;					// Storage buffer of objectCount CullObjects
+	uint32_t objectCount = 0;
+
+	// Optional Hi-Z occlusion: a depth pyramid holding the farthest depth of each texel's
+	// footprint per mip, in eShaderReadOnlyOptimal. Null skips the occlusion test.
+	vk::ImageView depthPyramid;
+	vk::Extent2D depthPyramidExtent;
+};
+
+// Compute pass that tests objects against the view frustum (and optionally a Hi-Z depth
+// pyramid) and compacts the visible ones into an IndirectDrawBuffer, so visibility never
+// round-trips through the CPU. Each visible object becomes one indexed draw whose
+// firstInstance is the object's index.
+class GpuCuller
+{
+public:
+	// Builds the culling pipelines from the SPIR-V compiled from shader/cull.comp, without
+	// and with OCCLUSION defined. An empty occlusion path disables Hi-Z culling. The workgroup
+	// size is a specialization constant, so it can be tuned per GPU without recompiling.
+	void init(vk::Device device, ShaderLibrary& shaderLibrary, PipelineCache* pipelineCache, const std::string& frustumShaderPath,
+		const std::string& occlusionShaderPath = {}, uint32_t workgroupSize = 64);
+	void destroy();
+
+	bool supports_occlusion() const { return static_cast<bool>(m_OcclusionPipeline); }
+
+	// Record the culling dispatch outside of rendering. Resets the draw count, culls and
+	// makes the commands visible to the following drawIndexedIndirectCount. The descriptor
+	// set is allocated from descriptorPool, normally the current frame's pool.
+	void cull(vk::CommandBuffer commandBuffer, vk::DescriptorPool descriptorPool, const CullParams& params, const IndirectDrawBuffer& drawBuffer);
+
+private:
+	// Specialization constant 0 in shader/cull.comp
+	using WorkgroupSizeConstant = SpecConstant<0, uint32_t>;
+
+	// Matches CullConstants in shader/cull.comp
+	struct CullConstants
+	{
+		glm::mat4 viewProjection;
+		glm::vec2 pyramidSize;
+		uint32_t objectCount;
+		uint32_t maxDraws;
+	};
+
+	vk::Device m_Device;
+	uint32_t m_WorkgroupSize = 64;
+	vk::DescriptorSetLayout m_SetLayout;
+	vk::PipelineLayout m_PipelineLayout;
+	vk::UniquePipeline m_FrustumPipeline;
+	vk::UniquePipeline m_OcclusionPipeline;
+	vk::Sampler m_PyramidSampler;
+};
+
+#endif
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <numeric>
+
+#include <spdlog/spdlog.h>
+#include "gpu_profiler.h"
+
+namespace
+{
+	// Query 0 and 1 bracket the frame; scope i uses queries 2 + 2i and 3 + 2i
+	constexpr uint32_t FrameQueryCount = 2;
+
+	constexpr vk::QueryPipelineStatisticFlags StatisticFlags =
+		vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices |
+		vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+		vk::QueryPipelineStatisticFlagBits::eClippingPrimitives |
+		vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations |
+		vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations;
+
+	constexpr uint32_t StatisticCount = 5;
+}
+
+// Replaces the oldest sample once the window is full.
+void RollingStat::add(double value)
+{
+	m_Samples[m_Next] = value;
+	m_Next = (m_Next + 1) % WindowSize;
+	m_Count = std::min(m_Count + 1, WindowSize);
+}
+
+// Returns the mean of the samples in the window.
+double RollingStat::average() const
+{
+	if (m_Count == 0)
+		return 0.0;
+
+	return std::accumulate(m_Samples.begin(), m_Samples.begin() + m_Count, 0.0) / m_Count;
+}
+
+// Returns the largest sample in the window.
+double RollingStat::max() const
+{
+	if (m_Count == 0)
+		return 0.0;
+
+	return *std::max_element(m_Samples.begin(), m_Samples.begin() + m_Count);
+}
+
+// Creates timestamp (and pipeline statistics) query pools for every frame in flight. The
+// profiler disables itself if the queue family doesn't support timestamps.
+void GpuProfiler::init(vk::PhysicalDevice physicalDevice, vk::Device device, uint32_t queueFamily, uint32_t framesInFlight, const GpuProfilerConfig& config)
+{
+	m_Device = device;
+	m_Config = config;
+
+	vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+	uint32_t validBits = physicalDevice.getQueueFamilyProperties()[queueFamily].timestampValidBits;
+
+	if (validBits == 0 || properties.limits.timestampPeriod == 0.0f)
+	{
+		spdlog::warn("GPU profiler disabled: queue family {} does not support timestamps", queueFamily);
+		return;
+	}
+
+	m_Enabled = true;
+	m_TimestampPeriod = properties.limits.timestampPeriod;
+	m_TimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	vk::QueryPoolCreateInfo timestampInfo({}, vk::QueryType::eTimestamp, FrameQueryCount + 2 * m_Config.maxScopes);
+	vk::QueryPoolCreateInfo statisticsInfo({}, vk::QueryType::ePipelineStatistics, 1, StatisticFlags);
+
+	m_Frames.resize(framesInFlight);
+	for (auto& frame : m_Frames)
+	{
+		frame.timestamps = m_Device.createQueryPool(timestampInfo);
+		if (m_Config.pipelineStatistics)
+			frame.statistics = m_Device.createQueryPool(statisticsInfo);
+
+		frame.scopes.reserve(m_Config.maxScopes);
+	}
+}
+
+// Destroys the query pools.
+void GpuProfiler::destroy()
+{
+	for (auto& frame : m_Frames)
+	{
+		m_Device.destroyQueryPool(frame.timestamps);
+		if (frame.statistics)
+			m_Device.destroyQueryPool(frame.statistics);
+	}
+
+	m_Frames.clear();
+	m_Enabled = false;
+}
+
+// Flags of the frame-wide statistics query, if one is recorded.
+vk::QueryPipelineStatisticFlags GpuProfiler::active_statistics() const
+{
+	if (!m_Enabled || !m_Config.pipelineStatistics)
+		return {};
+	return StatisticFlags;
+}
+
+// Collects the frame slot's previous results, resets its queries and writes the frame's
+// start timestamp.
+void GpuProfiler::begin_frame(uint32_t frameIndex, vk::CommandBuffer commandBuffer)
+{
+	if (!m_Enabled)
+		return;
+
+	m_FrameIndex = frameIndex;
+	m_Depth = 0;
+
+	FrameQueries& frame = m_Frames[m_FrameIndex];
+	if (frame.pending)
+		read_back(frame);
+
+	frame.scopes.clear();
+
+	commandBuffer.resetQueryPool(frame.timestamps, 0, FrameQueryCount + 2 * m_Config.maxScopes);
+	if (frame.statistics)
+	{
+		commandBuffer.resetQueryPool(frame.statistics, 0, 1);
+		commandBuffer.beginQuery(frame.statistics, 0, {});
+	}
+
+	commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, frame.timestamps, 0);
+}
+
+// Closes scopes left open and writes the frame's end timestamp.
+void GpuProfiler::end_frame(vk::CommandBuffer commandBuffer)
+{
+	if (!m_Enabled)
+		return;
+
+	FrameQueries& frame = m_Frames[m_FrameIndex];
+
+	// Every written query must be closed, or reading back the frame would never complete
+	for (uint32_t i = 0; i < frame.scopes.size(); i++)
+	{
+		if (frame.scopes[i].closed)
+			continue;
+
+		spdlog::warn("GPU profiler scope '{}' was not closed", frame.scopes[i].name);
+		end_scope(commandBuffer, i);
+	}
+
+	commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, frame.timestamps, 1);
+
+	if (frame.statistics)
+		commandBuffer.endQuery(frame.statistics, 0);
+
+	frame.pending = true;
+}
+
+// Writes the scope's start timestamp and returns its index, or UINT32_MAX if the frame's
+// scope budget is exhausted.
+uint32_t GpuProfiler::begin_scope(vk::CommandBuffer commandBuffer, const char* name)
+{
+	if (!m_Enabled)
+		return UINT32_MAX;
+
+	FrameQueries& frame = m_Frames[m_FrameIndex];
+	if (frame.scopes.size() == m_Config.maxScopes)
+		return UINT32_MAX;
+
+	uint32_t scope = static_cast<uint32_t>(frame.scopes.size());
+	frame.scopes.push_back({ name, m_Depth++, false });
+
+	commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, frame.timestamps, FrameQueryCount + 2 * scope);
+	return scope;
+}
+
+// Writes the scope's end timestamp once all preceding work has completed.
+void GpuProfiler::end_scope(vk::CommandBuffer commandBuffer, uint32_t scope)
+{
+	if (!m_Enabled || scope == UINT32_MAX)
+		return;
+
+	FrameQueries& frame = m_Frames[m_FrameIndex];
+	if (frame.scopes[scope].closed)
+		return;
+
+	frame.scopes[scope].closed = true;
+	m_Depth = frame.scopes[scope].depth;
+
+	commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, frame.timestamps, FrameQueryCount + 2 * scope + 1);
+}
+
+// Adds a CPU frame time sample.
+void GpuProfiler::record_cpu_frame(double milliseconds)
+{
+	m_CpuFrameMs.add(milliseconds);
+}
+
+// Logs averages and maxima over the rolling window.
+void GpuProfiler::log_report() const
+{
+	spdlog::info("Frame time: CPU {:.3f} ms avg ({:.3f} max), GPU {:.3f} ms avg ({:.3f} max)",
+		m_CpuFrameMs.average(), m_CpuFrameMs.max(), m_GpuFrameMs.average(), m_GpuFrameMs.max());
+
+	for (const auto& scope : m_LastScopes)
+	{
+		const RollingStat& stat = m_ScopeMs.at(scope.name);
+		spdlog::info("  {:>{}}{}: {:.3f} ms avg ({:.3f} max)", "", scope.depth * 2, scope.name, stat.average(), stat.max());
+	}
+
+	if (m_Config.pipelineStatistics)
+	{
+		spdlog::info("  Pipeline statistics: {} vertices, {} VS invocations, {} primitives, {} FS invocations, {} CS invocations",
+			m_LastStatistics.inputAssemblyVertices, m_LastStatistics.vertexShaderInvocations, m_LastStatistics.clippingPrimitives,
+			m_LastStatistics.fragmentShaderInvocations, m_LastStatistics.computeShaderInvocations);
+	}
+}
+
+// Reads a completed frame's queries without waiting. The frame's fence has signaled, so the
+// results are available; if the driver disagrees the frame is skipped rather than stalled on.
+void GpuProfiler::read_back(FrameQueries& frame)
+{
+	frame.pending = false;
+
+	uint32_t queryCount = FrameQueryCount + 2 * static_cast<uint32_t>(frame.scopes.size());
+	auto timestamps = m_Device.getQueryPoolResults<uint64_t>(
+		frame.timestamps, 0, queryCount, queryCount * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64
+	);
+
+	if (timestamps.result != vk::Result::eSuccess)
+		return;
+
+	auto toMilliseconds = [this](uint64_t begin, uint64_t end)
+	{
+		return static_cast<double>((end - begin) & m_TimestampMask) * m_TimestampPeriod / 1e6;
+	};
+
+	m_LastFrameMs = toMilliseconds(timestamps.value[0], timestamps.value[1]);
+	m_GpuFrameMs.add(m_LastFrameMs);
+
+	m_LastScopes.clear();
+	for (uint32_t i = 0; i < frame.scopes.size(); i++)
+	{
+		const Scope& scope = frame.scopes[i];
+		double milliseconds = toMilliseconds(timestamps.value[FrameQueryCount + 2 * i], timestamps.value[FrameQueryCount + 2 * i + 1]);
+
+		m_LastScopes.push_back({ scope.name, scope.depth, milliseconds });
+		m_ScopeMs[scope.name].add(milliseconds);
+	}
+
+	if (frame.statistics)
+	{
+		auto statistics = m_Device.getQueryPoolResults<uint64_t>(
+			frame.statistics, 0, 1, StatisticCount * sizeof(uint64_t), StatisticCount * sizeof(uint64_t), vk::QueryResultFlagBits::e64
+		);
+
+		// Results are written in flag bit order
+		if (statistics.result == vk::Result::eSuccess)
+		{
+			m_LastStatistics.inputAssemblyVertices = statistics.value[0];
+			m_LastStatistics.vertexShaderInvocations = statistics.value[1];
+			m_LastStatistics.clippingPrimitives = statistics.value[2];
+			m_LastStatistics.fragmentShaderInvocations = statistics.value[3];
+			m_LastStatistics.computeShaderInvocations = statistics.value[4];
+		}
+	}
+
+	m_FramesProfiled++;
+	if (m_Config.reportInterval > 0 && m_FramesProfiled % m_Config.reportInterval == 0)
+		log_report();
+}
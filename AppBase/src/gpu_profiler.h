@@ -0,0 +1,145 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <map>
+
+#include <vulkan/vulkan.hpp>
+
+// Fixed window of recent samples with average and maximum.
+class RollingStat
+{
+public:
+	static constexpr uint32_t WindowSize = 120;
+
+	void add(double value);
+	double average() const;
+	double max() const;
+	uint32_t count() const { return m_Count; }
+
+private:
+	std::array<double, WindowSize> m_Samples{};
+	uint32_t m_Count = 0, m_Next = 0;
+};
+
+// GPU time of one named scope in a completed frame.
+struct GpuScopeTiming
+{
+	std::string name;
+	uint32_t depth = 0;			// Nesting level, 0 for top-level scopes
+	double milliseconds = 0.0;
+};
+
+// Pipeline statistics accumulated over a whole frame.
+struct GpuPipelineStatistics
+{
+	uint64_t inputAssemblyVertices = 0;
+	uint64_t vertexShaderInvocations = 0;
+	uint64_t clippingPrimitives = 0;
+	uint64_t fragmentShaderInvocations = 0;
+	uint64_t computeShaderInvocations = 0;
+};
+
+struct GpuProfilerConfig
+{
+	uint32_t maxScopes = 64;			// Scopes per frame; further scopes are ignored
+	bool pipelineStatistics = false;	// Requires the pipelineStatisticsQuery and inheritedQueries features
+	uint32_t reportInterval = 0;		// Frames between logged reports, 0 disables reports
+};
+
+// Per-frame GPU timestamp (and optionally pipeline statistics) profiler. Each frame in
+// flight has its own query pools; results are read back when the frame's context is reused,
+// after its fence has signaled, so reading never stalls.
+//
+// Scopes are recorded on the frame's primary command buffer from the rendering thread only.
+class GpuProfiler
+{
+public:
+	void init(vk::PhysicalDevice physicalDevice, vk::Device device, uint32_t queueFamily, uint32_t framesInFlight, const GpuProfilerConfig& config);
+	void destroy();
+
+	// Read back the frame's previous results and reset its queries. Call at the start of the
+	// frame's command buffer, after its fence has signaled.
+	void begin_frame(uint32_t frameIndex, vk::CommandBuffer commandBuffer);
+	// Close the frame's timing. Call before ending the frame's command buffer.
+	void end_frame(vk::CommandBuffer commandBuffer);
+
+	// Open and close a named scope. Scopes may nest. The name must stay valid until the
+	// frame is read back, e.g. a string literal.
+	uint32_t begin_scope(vk::CommandBuffer commandBuffer, const char* name);
+	void end_scope(vk::CommandBuffer commandBuffer, uint32_t scope);
+
+	// Add the CPU time of one frame to the rolling report.
+	void record_cpu_frame(double milliseconds);
+
+	// Results of the most recently completed frame.
+	const std::vector<GpuScopeTiming>& last_scopes() const { return m_LastScopes; }
+	double last_gpu_frame_ms() const { return m_LastFrameMs; }
+	const GpuPipelineStatistics& last_statistics() const { return m_LastStatistics; }
+
+	// Log rolling CPU/GPU frame times and per-scope GPU times.
+	void log_report() const;
+
+	bool enabled() const { return m_Enabled; }
+	// Statistics counted over the whole frame. Secondary command buffers executed while the
+	// query is active must inherit them.
+	vk::QueryPipelineStatisticFlags active_statistics() const;
+
+private:
+	struct Scope
+	{
+		const char* name;
+		uint32_t depth;
+		bool closed;
+	};
+
+	struct FrameQueries
+	{
+		vk::QueryPool timestamps;
+		vk::QueryPool statistics;
+		std::vector<Scope> scopes;
+		bool pending = false;		// Queries were recorded and not yet read back
+	};
+
+	vk::Device m_Device;
+	GpuProfilerConfig m_Config;
+	bool m_Enabled = false;
+	double m_TimestampPeriod = 1.0;		// Nanoseconds per timestamp tick
+	uint64_t m_TimestampMask = ~0ull;
+
+	std::vector<FrameQueries> m_Frames;
+	uint32_t m_FrameIndex = 0;
+	uint32_t m_Depth = 0;
+	uint64_t m_FramesProfiled = 0;
+
+	std::vector<GpuScopeTiming> m_LastScopes;
+	double m_LastFrameMs = 0.0;
+	GpuPipelineStatistics m_LastStatistics;
+
+	RollingStat m_CpuFrameMs, m_GpuFrameMs;
+	std::map<std::string, RollingStat> m_ScopeMs;
+
+private:
+	void read_back(FrameQueries& frame);
+};
+
+// Records a GPU scope for the lifetime of the object.
+class GpuProfileScope
+{
+public:
+	GpuProfileScope(GpuProfiler& profiler, vk::CommandBuffer commandBuffer, const char* name)
+		: m_Profiler(profiler), m_CommandBuffer(commandBuffer), m_Scope(profiler.begin_scope(commandBuffer, name)) {}
+	~GpuProfileScope() { m_Profiler.end_scope(m_CommandBuffer, m_Scope); }
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+	GpuProfiler& m_Profiler;
+	vk::CommandBuffer m_CommandBuffer;
+	uint32_t m_Scope;
+};
+
+#endif
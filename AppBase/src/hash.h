@@ -0,0 +1,22 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <cstddef>
+
+// 64-bit FNV-1a hash over a byte range. Pass a previous result as seed to chain ranges.
+inline uint64_t fnv1a_64(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = seed;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef INDIRECT_DRAW_H
+#define INDIRECT_DRAW_H
+
+#include <vulkan/vulkan.hpp>
+#include "gpu_allocator.h"
+
+// Device-local draw commands consumed by drawIndexedIndirectCount. The command array and
+// the draw count live in storage buffers so they can be filled by uploads or written by
+// compute shaders on the GPU.
+struct IndirectDrawBuffer
+{
+	AllocatedBuffer commands;	// maxDraws tightly packed vk::DrawIndexedIndirectCommand
+	AllocatedBuffer count;		// A single uint32_t draw count
+	uint32_t maxDraws = 0;
+
+	static constexpr uint32_t Stride = sizeof(vk::DrawIndexedIndirectCommand);
+};
+
+#endif
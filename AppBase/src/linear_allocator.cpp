@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+#include "linear_allocator.h"
+
+// Binds the allocator to a mapped range of a buffer.
+void LinearAllocator::init(vk::Buffer buffer, void* mapped, vk::DeviceSize baseOffset, vk::DeviceSize size, vk::DeviceSize minAlignment)
+{
+	m_Buffer = buffer;
+	m_Mapped = static_cast<uint8_t*>(mapped) + baseOffset;
+	m_BaseOffset = baseOffset;
+	m_Size = size;
+	m_MinAlignment = std::max<vk::DeviceSize>(minAlignment, 1);
+	m_Head.store(0, std::memory_order_relaxed);
+	m_HighWater = 0;
+}
+
+// Bumps the head past an aligned slice. Alignments are powers of two in practice, but any
+// value is handled. The base offset is aligned by the owner, so relative alignment suffices.
+LinearAllocation LinearAllocator::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+	alignment = std::max(alignment, m_MinAlignment);
+
+	vk::DeviceSize head = m_Head.load(std::memory_order_relaxed);
+	vk::DeviceSize offset;
+
+	do
+	{
+		offset = (head + alignment - 1) / alignment * alignment;
+		if (offset + size > m_Size)
+		{
+			spdlog::error("Linear allocator out of memory: {} bytes requested, {} of {} used", size, head, m_Size);
+			throw std::runtime_error("Linear allocator out of memory.");
+		}
+	} while (!m_Head.compare_exchange_weak(head, offset + size, std::memory_order_relaxed));
+
+	LinearAllocation allocation;
+	allocation.buffer = m_Buffer;
+	allocation.offset = m_BaseOffset + offset;
+	allocation.size = size;
+	allocation.mapped = m_Mapped + offset;
+	return allocation;
+}
+
+// Rewinds the head to the start of the range.
+void LinearAllocator::reset()
+{
+	vk::DeviceSize used = m_Head.exchange(0, std::memory_order_relaxed);
+
+	if (used > m_HighWater)
+	{
+		m_HighWater = used;
+		spdlog::debug("Linear allocator peak usage {} of {} bytes", used, m_Size);
+	}
+}
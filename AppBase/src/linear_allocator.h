@@ -0,0 +1,80 @@
+#ifndef LINEAR_ALLOCATOR_H
+#define LINEAR_ALLOCATOR_H
+
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <type_traits>
+
+#include <vulkan/vulkan.hpp>
+
+// A slice handed out by LinearAllocator. Valid until the allocator is reset.
+struct LinearAllocation
+{
+	vk::Buffer buffer;
+	vk::DeviceSize offset = 0;		// Offset into buffer, for binding or descriptor writes
+	vk::DeviceSize size = 0;
+	void* mapped = nullptr;			// Host pointer to the slice
+
+	template<typename T>
+	T* as() const { return static_cast<T*>(mapped); }
+
+	vk::DescriptorBufferInfo descriptor_info() const { return vk::DescriptorBufferInfo(buffer, offset, size); }
+};
+
+// Bump allocator over a persistently mapped, host-coherent range of a buffer. Allocation is
+// a single atomic add, so worker threads recording in parallel can allocate concurrently.
+// Everything is released at once by reset(), once the GPU is done with the range.
+class LinearAllocator
+{
+public:
+	LinearAllocator() = default;
+	// Movable for storage in std::vector, before any allocation is made
+	LinearAllocator(LinearAllocator&& other) noexcept
+		: m_Buffer(other.m_Buffer), m_Mapped(other.m_Mapped), m_BaseOffset(other.m_BaseOffset), m_Size(other.m_Size),
+		m_MinAlignment(other.m_MinAlignment), m_Head(other.m_Head.load(std::memory_order_relaxed)), m_HighWater(other.m_HighWater) {}
+
+	// Sub-allocate from [baseOffset, baseOffset + size) of buffer, mapped at mapped + baseOffset.
+	// Every allocation is aligned to at least minAlignment.
+	void init(vk::Buffer buffer, void* mapped, vk::DeviceSize baseOffset, vk::DeviceSize size, vk::DeviceSize minAlignment);
+
+	// Reserve size bytes aligned to max(alignment, minAlignment). Throws when the range is exhausted.
+	LinearAllocation allocate(vk::DeviceSize size, vk::DeviceSize alignment = 0);
+
+	// Allocate and copy a value or array into the range.
+	template<typename T>
+	LinearAllocation push(const T& value, vk::DeviceSize alignment = 0)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Pushed data must be trivially copyable");
+		LinearAllocation allocation = allocate(sizeof(T), alignment);
+		std::memcpy(allocation.mapped, &value, sizeof(T));
+		return allocation;
+	}
+
+	template<typename T>
+	LinearAllocation push(const std::vector<T>& values, vk::DeviceSize alignment = 0)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Pushed data must be trivially copyable");
+		LinearAllocation allocation = allocate(sizeof(T) * values.size(), alignment);
+		std::memcpy(allocation.mapped, values.data(), sizeof(T) * values.size());
+		return allocation;
+	}
+
+	// Release every allocation. The GPU must no longer read the range.
+	void reset();
+
+	vk::DeviceSize used() const { return m_Head.load(std::memory_order_relaxed); }
+	vk::DeviceSize capacity() const { return m_Size; }
+
+private:
+	vk::Buffer m_Buffer;
+	uint8_t* m_Mapped = nullptr;		// Start of this allocator's range
+	vk::DeviceSize m_BaseOffset = 0;
+	vk::DeviceSize m_Size = 0;
+	vk::DeviceSize m_MinAlignment = 1;
+
+	std::atomic<vk::DeviceSize> m_Head = 0;		// Relative to m_BaseOffset
+	vk::DeviceSize m_HighWater = 0;				// Peak usage, logged on growth
+};
+
+#endif
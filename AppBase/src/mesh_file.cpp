@@ -0,0 +1,283 @@
+#include "mesh_file.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	constexpr uint64_t BlockAlignment = 16;
+
+	uint64_t align_block(uint64_t offset)
+	{
+		return (offset + BlockAlignment - 1) & ~(BlockAlignment - 1);
+	}
+
+	// Appends chunks of at most chunkSize bytes covering [0, size) of a block.
+	void add_chunks(std::vector<MeshFileChunk>& chunks, MeshChunkType type, uint64_t blockOffset, uint64_t size, uint64_t chunkSize)
+	{
+		for (uint64_t offset = 0; offset < size; offset += chunkSize)
+		{
+			MeshFileChunk chunk{};
+			chunk.type = type;
+			chunk.fileOffset = blockOffset + offset;
+			chunk.dstOffset = offset;
+			chunk.size = std::min(chunkSize, size - offset);
+			chunks.push_back(chunk);
+		}
+	}
+
+	// Writes a block at its offset, zero-padding from the current position.
+	void write_block(std::ofstream& file, uint64_t offset, const void* data, uint64_t size)
+	{
+		static const char padding[BlockAlignment] = {};
+		uint64_t position = static_cast<uint64_t>(file.tellp());
+		file.write(padding, static_cast<std::streamsize>(offset - position));
+		file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+	}
+}
+
+// Lays out the tables and blocks, then writes them in file order.
+void write_mesh_file(const std::string& path, const MeshData& mesh, std::span<const VertexAttribute> attributes,
+	const std::vector<MeshFileLod>& lods, const std::vector<MeshFileMeshlet>& meshlets, uint64_t chunkSize)
+{
+	assert(chunkSize % BlockAlignment == 0 && "Chunk size must keep chunks aligned!");
+
+	std::vector<MeshFileAttribute> fileAttributes;
+	for (const VertexAttribute& attribute : attributes)
+		fileAttributes.push_back({ static_cast<uint32_t>(attribute.format), attribute.offset, attribute.locations, attribute.locationStride });
+
+	std::vector<MeshFileLod> fileLods = lods;
+	if (fileLods.empty())
+		fileLods.push_back({ 0, mesh.indexCount, 0.0f, 0 });
+
+	MeshFileHeader header{};
+	header.vertexStride = mesh.vertexStride;
+	header.vertexCount = mesh.vertexCount;
+	header.indexType = static_cast<uint32_t>(mesh.indexType);
+	header.indexCount = mesh.indexCount;
+	header.attributeCount = static_cast<uint32_t>(fileAttributes.size());
+	header.lodCount = static_cast<uint32_t>(fileLods.size());
+	header.meshletCount = static_cast<uint32_t>(meshlets.size());
+
+	// Chunk count is known up front, so every offset can be computed before writing
+	uint64_t chunkCount = (mesh.vertices.size() + chunkSize - 1) / chunkSize + (mesh.indices.size() + chunkSize - 1) / chunkSize;
+	header.chunkCount = static_cast<uint32_t>(chunkCount);
+
+	header.attributeOffset = align_block(sizeof(MeshFileHeader));
+	header.lodOffset = align_block(header.attributeOffset + fileAttributes.size() * sizeof(MeshFileAttribute));
+	header.meshletOffset = align_block(header.lodOffset + fileLods.size() * sizeof(MeshFileLod));
+	header.chunkOffset = align_block(header.meshletOffset + meshlets.size() * sizeof(MeshFileMeshlet));
+	header.vertexDataOffset = align_block(header.chunkOffset + chunkCount * sizeof(MeshFileChunk));
+	header.indexDataOffset = align_block(header.vertexDataOffset + mesh.vertices.size());
+
+	std::vector<MeshFileChunk> chunks;
+	add_chunks(chunks, MeshChunkType::Vertices, header.vertexDataOffset, mesh.vertices.size(), chunkSize);
+	add_chunks(chunks, MeshChunkType::Indices, header.indexDataOffset, mesh.indices.size(), chunkSize);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		spdlog::error("Failed to create mesh file {}", path);
+		throw std::runtime_error("Failed to create mesh file");
+	}
+
+	write_block(file, 0, &header, sizeof(header));
+	write_block(file, header.attributeOffset, fileAttributes.data(), fileAttributes.size() * sizeof(MeshFileAttribute));
+	write_block(file, header.lodOffset, fileLods.data(), fileLods.size() * sizeof(MeshFileLod));
+	write_block(file, header.meshletOffset, meshlets.data(), meshlets.size() * sizeof(MeshFileMeshlet));
+	write_block(file, header.chunkOffset, chunks.data(), chunks.size() * sizeof(MeshFileChunk));
+	write_block(file, header.vertexDataOffset, mesh.vertices.data(), mesh.vertices.size());
+	write_block(file, header.indexDataOffset, mesh.indices.data(), mesh.indices.size());
+
+	if (!file)
+	{
+		spdlog::error("Failed to write mesh file {}", path);
+		throw std::runtime_error("Failed to write mesh file");
+	}
+}
+
+// Unmaps the file.
+MeshFile::~MeshFile()
+{
+	close();
+}
+
+// Maps the whole file read-only and validates it. Sequential access is hinted so the OS
+// reads ahead while chunks are being copied out.
+void MeshFile::open(const std::string& path)
+{
+	close();
+	m_Path = path;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	m_File = file == INVALID_HANDLE_VALUE ? nullptr : file;
+	LARGE_INTEGER size{};
+	if (!m_File || !GetFileSizeEx(m_File, &size))
+	{
+		close();
+		spdlog::error("Failed to open mesh file {}", path);
+		throw std::runtime_error("Failed to open mesh file");
+	}
+
+	m_Size = static_cast<uint64_t>(size.QuadPart);
+	m_Mapping = m_Size ? CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	m_Data = m_Mapping ? static_cast<const uint8_t*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+	m_File = ::open(path.c_str(), O_RDONLY);
+	struct stat status{};
+	if (m_File < 0 || fstat(m_File, &status) != 0)
+	{
+		close();
+		spdlog::error("Failed to open mesh file {}", path);
+		throw std::runtime_error("Failed to open mesh file");
+	}
+
+	m_Size = static_cast<uint64_t>(status.st_size);
+	void* mapped = m_Size ? mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_File, 0) : MAP_FAILED;
+	if (mapped != MAP_FAILED)
+	{
+		madvise(mapped, m_Size, MADV_SEQUENTIAL);
+		madvise(mapped, m_Size, MADV_WILLNEED);
+		m_Data = static_cast<const uint8_t*>(mapped);
+	}
+#endif
+
+	if (!m_Data)
+	{
+		close();
+		spdlog::error("Failed to map mesh file {}", path);
+		throw std::runtime_error("Failed to map mesh file");
+	}
+
+	std::string problem = validate();
+	if (!problem.empty())
+	{
+		close();
+		spdlog::error("Invalid mesh file {}: {}", path, problem);
+		throw std::runtime_error("Invalid mesh file");
+	}
+}
+
+// Unmaps and closes the file. Views returned by the accessors become invalid.
+void MeshFile::close()
+{
+#ifdef _WIN32
+	if (m_Data)
+		UnmapViewOfFile(m_Data);
+	if (m_Mapping)
+		CloseHandle(m_Mapping);
+	if (m_File)
+		CloseHandle(m_File);
+	m_Mapping = nullptr;
+	m_File = nullptr;
+#else
+	if (m_Data)
+		munmap(const_cast<uint8_t*>(m_Data), m_Size);
+	if (m_File >= 0)
+		::close(m_File);
+	m_File = -1;
+#endif
+
+	m_Data = nullptr;
+	m_Size = 0;
+}
+
+// Compares the stored attributes with the given ones field by field.
+bool MeshFile::matches_layout(std::span<const VertexAttribute> attributes, uint32_t stride) const
+{
+	std::span<const MeshFileAttribute> fileAttributes = this->attributes();
+	if (header().vertexStride != stride || fileAttributes.size() != attributes.size())
+		return false;
+
+	for (size_t i = 0; i < attributes.size(); i++)
+	{
+		const MeshFileAttribute& stored = fileAttributes[i];
+		const VertexAttribute& expected = attributes[i];
+		if (stored.format != static_cast<uint32_t>(expected.format) || stored.offset != expected.offset ||
+			stored.locations != expected.locations || stored.locationStride != expected.locationStride)
+			return false;
+	}
+
+	return true;
+}
+
+// Checks the header and that every table, block and chunk lies inside the file. Chunks must
+// stay inside their block, and LODs and meshlets inside the index block.
+std::string MeshFile::validate() const
+{
+	if (m_Size < sizeof(MeshFileHeader))
+		return "file is smaller than its header";
+
+	const MeshFileHeader& h = header();
+	if (h.magic != MeshFileMagic)
+		return "bad magic";
+	if (h.version != MeshFileVersion)
+		return "unsupported version " + std::to_string(h.version);
+	if (h.indexType != VK_INDEX_TYPE_UINT16 && h.indexType != VK_INDEX_TYPE_UINT32)
+		return "unsupported index type";
+
+	// Empty blocks would be uploaded into zero-sized buffers, which Vulkan does not allow
+	if (h.vertexCount == 0 || h.vertexStride == 0)
+		return "mesh has no vertices";
+	if (h.indexCount == 0)
+		return "mesh has no indices";
+
+	// Sizes are computed in 64 bits from 32-bit counts, so they cannot overflow
+	auto inside = [&](uint64_t offset, uint64_t size) { return offset <= m_Size && size <= m_Size - offset; };
+	auto aligned = [](uint64_t offset) { return offset % BlockAlignment == 0; };
+
+	if (!aligned(h.attributeOffset) || !inside(h.attributeOffset, uint64_t(h.attributeCount) * sizeof(MeshFileAttribute)))
+		return "attribute table out of bounds";
+	if (!aligned(h.lodOffset) || !inside(h.lodOffset, uint64_t(h.lodCount) * sizeof(MeshFileLod)))
+		return "LOD table out of bounds";
+	if (!aligned(h.meshletOffset) || !inside(h.meshletOffset, uint64_t(h.meshletCount) * sizeof(MeshFileMeshlet)))
+		return "meshlet table out of bounds";
+	if (!aligned(h.chunkOffset) || !inside(h.chunkOffset, uint64_t(h.chunkCount) * sizeof(MeshFileChunk)))
+		return "chunk table out of bounds";
+	if (!inside(h.vertexDataOffset, vertex_data_size()))
+		return "vertex block out of bounds";
+	if (!inside(h.indexDataOffset, index_data_size()))
+		return "index block out of bounds";
+
+	for (const MeshFileChunk& chunk : chunks())
+	{
+		bool vertices = chunk.type == MeshChunkType::Vertices;
+		if (!vertices && chunk.type != MeshChunkType::Indices)
+			return "unknown chunk type";
+
+		uint64_t blockOffset = vertices ? h.vertexDataOffset : h.indexDataOffset;
+		uint64_t blockSize = vertices ? vertex_data_size() : index_data_size();
+		if (chunk.dstOffset > blockSize || chunk.size > blockSize - chunk.dstOffset || chunk.fileOffset != blockOffset + chunk.dstOffset)
+			return "chunk outside its block";
+	}
+
+	for (const MeshFileLod& lod : lods())
+	{
+		if (uint64_t(lod.firstIndex) + lod.indexCount > h.indexCount)
+			return "LOD outside the index block";
+	}
+
+	for (const MeshFileMeshlet& meshlet : meshlets())
+	{
+		if (uint64_t(meshlet.firstIndex) + meshlet.indexCount > h.indexCount)
+			return "meshlet outside the index block";
+	}
+
+	return {};
+}
@@ -0,0 +1,171 @@
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+
+#include <string>
+#include <vector>
+#include <span>
+#include <cstdint>
+
+#include <vulkan/vulkan.hpp>
+#include "vertex.h"
+#include "mesh_optimizer.h"
+
+// Binary mesh file
+// Geometry laid out exactly as it is uploaded, so loading is a memory map followed by copies
+// straight from the mapping into GPU-visible memory. Every block starts on a 16-byte boundary:
+//
+//   MeshFileHeader
+//   MeshFileAttribute[attributeCount]	vertex layout, checked against a VertexFormat on load
+//   MeshFileLod[lodCount]				index ranges, finest level first
+//   MeshFileMeshlet[meshletCount]		index ranges with bounding spheres for culling
+//   MeshFileChunk[chunkCount]			upload units covering the vertex and index blocks
+//   vertex block						vertexCount * vertexStride bytes
+//   index block						indexCount 16- or 32-bit indices
+constexpr uint32_t MeshFileMagic = 0x48534D56;		// "VMSH"
+constexpr uint32_t MeshFileVersion = 1;
+constexpr uint64_t MeshFileDefaultChunkSize = 1ull * 1024 * 1024;
+
+struct MeshFileHeader
+{
+	uint32_t magic = MeshFileMagic;
+	uint32_t version = MeshFileVersion;
+	uint32_t vertexStride = 0;
+	uint32_t vertexCount = 0;
+	uint32_t indexType = VK_INDEX_TYPE_UINT32;		// VkIndexType
+	uint32_t indexCount = 0;
+	uint32_t attributeCount = 0;
+	uint32_t lodCount = 0;
+	uint32_t meshletCount = 0;
+	uint32_t chunkCount = 0;
+	uint64_t attributeOffset = 0;
+	uint64_t lodOffset = 0;
+	uint64_t meshletOffset = 0;
+	uint64_t chunkOffset = 0;
+	uint64_t vertexDataOffset = 0;
+	uint64_t indexDataOffset = 0;
+};
+
+// A VertexAttribute as stored in the file.
+struct MeshFileAttribute
+{
+	uint32_t format = 0;			// VkFormat
+	uint32_t offset = 0;
+	uint32_t locations = 1;
+	uint32_t locationStride = 0;
+};
+
+// One level of detail: a range of the index block drawn instead of the full mesh.
+struct MeshFileLod
+{
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	float error = 0.0f;				// Object-space simplification error
+	uint32_t reserved = 0;
+};
+
+// A small cluster of triangles, culled on its own.
+struct MeshFileMeshlet
+{
+	float boundingSphere[4] = {};	// Object-space center and radius
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	uint32_t reserved[2] = {};
+};
+
+enum class MeshChunkType : uint32_t
+{
+	Vertices = 0,
+	Indices = 1,
+};
+
+// A contiguous range of the vertex or index block, uploaded with one staging copy.
+struct MeshFileChunk
+{
+	MeshChunkType type = MeshChunkType::Vertices;
+	uint32_t reserved = 0;
+	uint64_t fileOffset = 0;
+	uint64_t dstOffset = 0;			// Offset in the vertex or index buffer
+	uint64_t size = 0;
+};
+
+static_assert(sizeof(MeshFileHeader) == 88 && sizeof(MeshFileAttribute) == 16 && sizeof(MeshFileLod) == 16 &&
+	sizeof(MeshFileMeshlet) == 32 && sizeof(MeshFileChunk) == 32, "Mesh file structures must match the on-disk layout");
+
+// Write an optimized mesh to a mesh file. Without LODs, a single level covers the whole index
+// block. The vertex and index blocks are split into chunks of at most chunkSize bytes.
+void write_mesh_file(const std::string& path, const MeshData& mesh, std::span<const VertexAttribute> attributes,
+	const std::vector<MeshFileLod>& lods = {}, const std::vector<MeshFileMeshlet>& meshlets = {}, uint64_t chunkSize = MeshFileDefaultChunkSize);
+
+// Typed overload recording the attributes of a VertexFormat.
+template<VertexFormatType Vertex>
+void write_mesh_file(const std::string& path, const MeshData& mesh,
+	const std::vector<MeshFileLod>& lods = {}, const std::vector<MeshFileMeshlet>& meshlets = {}, uint64_t chunkSize = MeshFileDefaultChunkSize)
+{
+	constexpr auto attributes = Vertex::attributes();
+	write_mesh_file(path, mesh, attributes, lods, meshlets, chunkSize);
+}
+
+// Read-only memory mapping of a mesh file. open() validates the header and every table
+// against the file size, so accessors never read out of bounds. Views returned by the
+// accessors are valid until close().
+class MeshFile
+{
+public:
+	MeshFile() = default;
+	~MeshFile();
+
+	MeshFile(const MeshFile&) = delete;
+	MeshFile& operator=(const MeshFile&) = delete;
+
+	void open(const std::string& path);
+	void close();
+	bool is_open() const { return m_Data != nullptr; }
+
+	const MeshFileHeader& header() const { return *reinterpret_cast<const MeshFileHeader*>(m_Data); }
+	vk::IndexType index_type() const { return static_cast<vk::IndexType>(header().indexType); }
+	uint64_t vertex_data_size() const { return static_cast<uint64_t>(header().vertexCount) * header().vertexStride; }
+	uint64_t index_data_size() const { return static_cast<uint64_t>(header().indexCount) * index_size(); }
+
+	std::span<const MeshFileAttribute> attributes() const { return table<MeshFileAttribute>(header().attributeOffset, header().attributeCount); }
+	std::span<const MeshFileLod> lods() const { return table<MeshFileLod>(header().lodOffset, header().lodCount); }
+	std::span<const MeshFileMeshlet> meshlets() const { return table<MeshFileMeshlet>(header().meshletOffset, header().meshletCount); }
+	std::span<const MeshFileChunk> chunks() const { return table<MeshFileChunk>(header().chunkOffset, header().chunkCount); }
+
+	// Mapped bytes of a chunk, to be copied directly into a staging or device buffer
+	const void* chunk_data(const MeshFileChunk& chunk) const { return m_Data + chunk.fileOffset; }
+
+	// True if the file's vertices are laid out as the given attributes with the given stride.
+	bool matches_layout(std::span<const VertexAttribute> attributes, uint32_t stride) const;
+
+	template<VertexFormatType Vertex>
+	bool matches_layout() const
+	{
+		constexpr auto attributes = Vertex::attributes();
+		return matches_layout(attributes, sizeof(Vertex));
+	}
+
+private:
+	const uint8_t* m_Data = nullptr;
+	uint64_t m_Size = 0;
+	std::string m_Path;
+
+#ifdef _WIN32
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+#else
+	int m_File = -1;
+#endif
+
+private:
+	template<typename T>
+	std::span<const T> table(uint64_t offset, uint32_t count) const
+	{
+		return std::span<const T>(reinterpret_cast<const T*>(m_Data + offset), count);
+	}
+
+	uint32_t index_size() const { return header().indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4; }
+	// Returns a description of the first problem found, or an empty string
+	std::string validate() const;
+};
+
+#endif
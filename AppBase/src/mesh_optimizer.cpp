@@ -0,0 +1,485 @@
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+
+#include <spdlog/spdlog.h>
+#include "mesh_optimizer.h"
+#include "hash.h"
+
+namespace
+{
+	constexpr uint32_t Unused = ~0u;
+
+	// Cache size the Forsyth scores are tuned for; larger than real caches on purpose
+	constexpr uint32_t ForsythCacheSize = 32;
+	// FIFO cache size used to find cluster boundaries in the overdraw pass
+	constexpr uint32_t ClusterCacheSize = 16;
+
+	// Forsyth vertex score: recently used vertices and vertices with few remaining triangles
+	// score highest, so the triangles finishing them are emitted next.
+	float forsyth_vertex_score(int32_t cachePosition, uint32_t liveTriangles)
+	{
+		if (liveTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// The last triangle's vertices get a fixed score so the next triangle isn't biased
+			// towards one of its edges
+			if (cachePosition < 3)
+				score = 0.75f;
+			else
+				score = std::pow(1.0f - static_cast<float>(cachePosition - 3) / (ForsythCacheSize - 3), 1.5f);
+		}
+
+		return score + 2.0f / std::sqrt(static_cast<float>(liveTriangles));
+	}
+
+	// FIFO post-transform cache simulated with per-vertex timestamps.
+	struct CacheSimulator
+	{
+		std::vector<uint32_t> timestamps;
+		uint32_t timestamp;
+		uint32_t cacheSize;
+
+		CacheSimulator(size_t vertexCount, uint32_t size)
+			: timestamps(vertexCount, 0), timestamp(size + 1), cacheSize(size) {}
+
+		// Returns the number of vertices of the triangle that missed the cache.
+		uint32_t triangle(const uint32_t* triangleIndices)
+		{
+			uint32_t misses = 0;
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				uint32_t vertex = triangleIndices[k];
+				if (timestamp - timestamps[vertex] >= cacheSize)
+				{
+					timestamps[vertex] = timestamp++;
+					misses++;
+				}
+			}
+			return misses;
+		}
+
+		// Evicts every vertex.
+		void flush() { timestamp += cacheSize + 1; }
+	};
+
+	glm::vec3 read_position(const uint8_t* vertices, size_t vertexStride, uint32_t positionOffset, uint32_t vertex)
+	{
+		glm::vec3 position;
+		std::memcpy(&position, vertices + vertex * vertexStride + positionOffset, sizeof(position));
+		return position;
+	}
+}
+
+// Maps bytewise-identical vertices onto one compacted index.
+uint32_t generate_vertex_remap(std::vector<uint32_t>& remap, const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride)
+{
+	const uint8_t* vertexData = static_cast<const uint8_t*>(vertices);
+	remap.assign(vertexCount, Unused);
+
+	// Unique vertices seen so far, bucketed by content hash
+	std::unordered_multimap<uint64_t, uint32_t> uniqueVertices;
+	uniqueVertices.reserve(vertexCount);
+	uint32_t uniqueCount = 0;
+
+	auto visit = [&](uint32_t vertex)
+	{
+		assert(vertex < vertexCount && "Index out of range!");
+
+		if (remap[vertex] != Unused)
+			return;
+
+		const uint8_t* data = vertexData + vertex * vertexStride;
+		uint64_t hash = fnv1a_64(data, vertexStride);
+
+		auto [begin, end] = uniqueVertices.equal_range(hash);
+		for (auto it = begin; it != end; ++it)
+		{
+			if (std::memcmp(vertexData + it->second * vertexStride, data, vertexStride) == 0)
+			{
+				remap[vertex] = remap[it->second];
+				return;
+			}
+		}
+
+		remap[vertex] = uniqueCount++;
+		uniqueVertices.emplace(hash, vertex);
+	};
+
+	if (indices)
+	{
+		for (size_t i = 0; i < indexCount; i++)
+			visit(indices[i]);
+	}
+	else
+	{
+		for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+			visit(vertex);
+	}
+
+	return uniqueCount;
+}
+
+// Greedily emits the best-scoring triangle adjacent to the simulated cache, falling back to
+// the first unemitted triangle in input order when the cache has no live triangles left.
+void optimize_vertex_cache(uint32_t* dst, const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	uint32_t triangleCount = static_cast<uint32_t>(indexCount / 3);
+	if (triangleCount == 0)
+		return;
+
+	// Live triangles of every vertex, in compressed rows; emitted triangles are swapped out
+	std::vector<uint32_t> liveTriangles(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		liveTriangles[indices[i]]++;
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		for (uint32_t k = 0; k < 3; k++)
+			adjacency[fillOffsets[indices[triangle * 3 + k]]++] = triangle;
+	}
+
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		vertexScores[vertex] = forsyth_vertex_score(-1, liveTriangles[vertex]);
+
+	auto triangle_score = [&](uint32_t triangle)
+	{
+		const uint32_t* triangleIndices = indices + triangle * 3;
+		return vertexScores[triangleIndices[0]] + vertexScores[triangleIndices[1]] + vertexScores[triangleIndices[2]];
+	};
+
+	uint32_t bestTriangle = 0;
+	float bestScore = triangle_score(0);
+	for (uint32_t triangle = 1; triangle < triangleCount; triangle++)
+	{
+		float score = triangle_score(triangle);
+		if (score > bestScore)
+		{
+			bestScore = score;
+			bestTriangle = triangle;
+		}
+	}
+
+	std::vector<int32_t> cachePositions(vertexCount, -1);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> cache, newCache;
+	cache.reserve(ForsythCacheSize + 3);
+	newCache.reserve(ForsythCacheSize + 3);
+
+	uint32_t inputCursor = 0;
+	size_t written = 0;
+
+	while (bestTriangle != Unused)
+	{
+		emitted[bestTriangle] = true;
+		const uint32_t* triangleIndices = indices + bestTriangle * 3;
+
+		// The triangle's vertices move to the front of the cache
+		newCache.clear();
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			uint32_t vertex = triangleIndices[k];
+			dst[written++] = vertex;
+
+			uint32_t* begin = adjacency.data() + adjacencyOffsets[vertex];
+			uint32_t* end = begin + liveTriangles[vertex];
+			uint32_t* it = std::find(begin, end, bestTriangle);
+			if (it != end)
+			{
+				*it = *(end - 1);
+				liveTriangles[vertex]--;
+			}
+
+			if (std::find(newCache.begin(), newCache.end(), vertex) == newCache.end())
+				newCache.push_back(vertex);
+		}
+
+		for (uint32_t vertex : cache)
+		{
+			if (std::find(newCache.begin(), newCache.end(), vertex) == newCache.end())
+				newCache.push_back(vertex);
+		}
+
+		// Rescore cached vertices; those pushed past the end lose their cache bonus
+		for (uint32_t i = 0; i < newCache.size(); i++)
+		{
+			uint32_t vertex = newCache[i];
+			cachePositions[vertex] = i < ForsythCacheSize ? static_cast<int32_t>(i) : -1;
+			vertexScores[vertex] = forsyth_vertex_score(cachePositions[vertex], liveTriangles[vertex]);
+		}
+
+		// Only triangles touching the cache changed score
+		bestTriangle = Unused;
+		bestScore = -1.0f;
+		for (uint32_t vertex : newCache)
+		{
+			for (uint32_t a = 0; a < liveTriangles[vertex]; a++)
+			{
+				uint32_t triangle = adjacency[adjacencyOffsets[vertex] + a];
+				float score = triangle_score(triangle);
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = triangle;
+				}
+			}
+		}
+
+		if (newCache.size() > ForsythCacheSize)
+			newCache.resize(ForsythCacheSize);
+		std::swap(cache, newCache);
+
+		if (bestTriangle == Unused)
+		{
+			while (inputCursor < triangleCount && emitted[inputCursor])
+				inputCursor++;
+
+			if (inputCursor < triangleCount)
+				bestTriangle = inputCursor;
+		}
+	}
+}
+
+// Splits the triangles into clusters at cache flushes and wherever a cluster's cache
+// efficiency is within threshold of the mesh's, then emits the clusters sorted by how far
+// they face away from the mesh centroid.
+void optimize_overdraw(uint32_t* dst, const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride, uint32_t positionOffset, float threshold)
+{
+	const uint8_t* vertexData = static_cast<const uint8_t*>(vertices);
+	uint32_t triangleCount = static_cast<uint32_t>(indexCount / 3);
+	if (triangleCount == 0)
+		return;
+
+	// Hard boundaries: triangles missing all three vertices start over with a cold cache anyway
+	std::vector<uint32_t> hardBoundaries;
+	CacheSimulator cache(vertexCount, ClusterCacheSize);
+	uint32_t meshMisses = 0;
+
+	for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		uint32_t misses = cache.triangle(indices + triangle * 3);
+		meshMisses += misses;
+
+		if (triangle == 0 || misses == 3)
+			hardBoundaries.push_back(triangle);
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	float meshAcmr = static_cast<float>(meshMisses) / triangleCount;
+
+	// Soft boundaries: split further wherever the cluster so far is efficient enough
+	std::vector<uint32_t> clusters;
+	for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+	{
+		uint32_t start = hardBoundaries[h], end = hardBoundaries[h + 1];
+		uint32_t clusterStart = start, clusterMisses = 0;
+
+		clusters.push_back(start);
+		cache.flush();
+
+		for (uint32_t triangle = start; triangle < end; triangle++)
+		{
+			clusterMisses += cache.triangle(indices + triangle * 3);
+			float clusterAcmr = static_cast<float>(clusterMisses) / (triangle - clusterStart + 1);
+
+			if (triangle + 1 < end && clusterAcmr * threshold <= meshAcmr)
+			{
+				clusterStart = triangle + 1;
+				clusterMisses = 0;
+				clusters.push_back(clusterStart);
+				cache.flush();
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	glm::vec3 meshCentroid(0.0f);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		meshCentroid += read_position(vertexData, vertexStride, positionOffset, indices[i]);
+	meshCentroid /= static_cast<float>(triangleCount * 3);
+
+	// Outward-facing clusters far from the centroid are likely occluders and are drawn first
+	size_t clusterCount = clusters.size() - 1;
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		float area = 0.0f;
+
+		for (uint32_t triangle = clusters[c]; triangle < clusters[c + 1]; triangle++)
+		{
+			glm::vec3 p0 = read_position(vertexData, vertexStride, positionOffset, indices[triangle * 3 + 0]);
+			glm::vec3 p1 = read_position(vertexData, vertexStride, positionOffset, indices[triangle * 3 + 1]);
+			glm::vec3 p2 = read_position(vertexData, vertexStride, positionOffset, indices[triangle * 3 + 2]);
+
+			glm::vec3 weightedNormal = glm::cross(p1 - p0, p2 - p0);
+			float triangleArea = glm::length(weightedNormal);
+
+			centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normal += weightedNormal;
+			area += triangleArea;
+		}
+
+		centroid = area > 0.0f ? centroid / area : centroid;
+		float normalLength = glm::length(normal);
+		sortKeys[c] = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+	}
+
+	std::vector<uint32_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	size_t written = 0;
+	for (uint32_t c : order)
+	{
+		size_t first = clusters[c] * 3ull, last = clusters[c + 1] * 3ull;
+		std::copy(indices + first, indices + last, dst + written);
+		written += last - first;
+	}
+}
+
+// Copies vertices in order of first reference and rewrites the indices to match.
+uint32_t optimize_vertex_fetch(void* dstVertices, uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride)
+{
+	uint8_t* dst = static_cast<uint8_t*>(dstVertices);
+	const uint8_t* src = static_cast<const uint8_t*>(vertices);
+
+	std::vector<uint32_t> remap(vertexCount, Unused);
+	uint32_t nextVertex = 0;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		uint32_t vertex = indices[i];
+		if (remap[vertex] == Unused)
+		{
+			remap[vertex] = nextVertex;
+			std::memcpy(dst + nextVertex * vertexStride, src + vertex * vertexStride, vertexStride);
+			nextVertex++;
+		}
+
+		indices[i] = remap[vertex];
+	}
+
+	return nextVertex;
+}
+
+// Counts vertex transforms of a FIFO cache over the triangle list.
+VertexCacheStats analyze_vertex_cache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStats stats;
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return stats;
+
+	CacheSimulator cache(vertexCount, cacheSize);
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+		stats.vertexTransforms += cache.triangle(indices + triangle * 3);
+
+	stats.acmr = static_cast<float>(stats.vertexTransforms) / triangleCount;
+	return stats;
+}
+
+// Runs every optimization stage and packs the indices.
+MeshData optimize_mesh(const void* vertices, size_t vertexCount, size_t vertexStride, const uint32_t* indices, size_t indexCount, const MeshOptimizeOptions& options)
+{
+	MeshData mesh;
+	mesh.vertexStride = static_cast<uint32_t>(vertexStride);
+
+	// Unindexed input is a plain triangle list over the vertices
+	std::vector<uint32_t> sourceIndices;
+	if (indices && indexCount > 0)
+	{
+		sourceIndices.assign(indices, indices + indexCount);
+	}
+	else
+	{
+		sourceIndices.resize(vertexCount);
+		std::iota(sourceIndices.begin(), sourceIndices.end(), 0u);
+	}
+
+	if (sourceIndices.size() % 3 != 0)
+	{
+		spdlog::warn("Mesh index count {} is not a multiple of 3, dropping the incomplete triangle", sourceIndices.size());
+		sourceIndices.resize(sourceIndices.size() - sourceIndices.size() % 3);
+	}
+
+	size_t count = sourceIndices.size();
+	if (count == 0)
+		return mesh;
+
+	VertexCacheStats before = analyze_vertex_cache(sourceIndices.data(), count, vertexCount);
+
+	// Merge identical vertices
+	std::vector<uint32_t> remap;
+	uint32_t uniqueCount = generate_vertex_remap(remap, sourceIndices.data(), count, vertices, vertexCount, vertexStride);
+
+	std::vector<uint8_t> uniqueVertices(uniqueCount * vertexStride);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		if (remap[vertex] != Unused)
+			std::memcpy(uniqueVertices.data() + remap[vertex] * vertexStride, static_cast<const uint8_t*>(vertices) + vertex * vertexStride, vertexStride);
+	}
+
+	std::vector<uint32_t> remappedIndices(count);
+	for (size_t i = 0; i < count; i++)
+		remappedIndices[i] = remap[sourceIndices[i]];
+
+	// Triangle order: vertex cache first, then clusters of it for overdraw
+	std::vector<uint32_t> optimizedIndices(count);
+	optimize_vertex_cache(optimizedIndices.data(), remappedIndices.data(), count, uniqueCount);
+
+	bool overdraw = options.optimizeOverdraw;
+	if (overdraw && options.positionOffset + sizeof(glm::vec3) > vertexStride)
+	{
+		spdlog::warn("Mesh position at offset {} does not fit a {}-byte vertex, skipping overdraw optimization", options.positionOffset, vertexStride);
+		overdraw = false;
+	}
+
+	if (overdraw)
+	{
+		optimize_overdraw(remappedIndices.data(), optimizedIndices.data(), count, uniqueVertices.data(), uniqueCount, vertexStride, options.positionOffset, options.overdrawThreshold);
+		std::swap(remappedIndices, optimizedIndices);
+	}
+
+	VertexCacheStats after = analyze_vertex_cache(optimizedIndices.data(), count, uniqueCount);
+
+	// Vertex order follows the final triangle order
+	mesh.vertices.resize(uniqueCount * vertexStride);
+	mesh.vertexCount = optimize_vertex_fetch(mesh.vertices.data(), optimizedIndices.data(), count, uniqueVertices.data(), uniqueCount, vertexStride);
+	mesh.indexCount = static_cast<uint32_t>(count);
+
+	// 0xFFFF stays reserved as the primitive restart index
+	if (mesh.vertexCount < 0xFFFF)
+	{
+		mesh.indexType = vk::IndexType::eUint16;
+		mesh.indices.resize(count * sizeof(uint16_t));
+
+		uint16_t* packed = reinterpret_cast<uint16_t*>(mesh.indices.data());
+		for (size_t i = 0; i < count; i++)
+			packed[i] = static_cast<uint16_t>(optimizedIndices[i]);
+	}
+	else
+	{
+		mesh.indexType = vk::IndexType::eUint32;
+		mesh.indices.resize(count * sizeof(uint32_t));
+		std::memcpy(mesh.indices.data(), optimizedIndices.data(), mesh.indices.size());
+	}
+
+	spdlog::info("Optimized mesh: {} -> {} vertices, ACMR {:.3f} -> {:.3f}, {}-bit indices",
+		vertexCount, mesh.vertexCount, before.acmr, after.acmr, mesh.indexType == vk::IndexType::eUint16 ? 16 : 32);
+
+	return mesh;
+}
@@ -0,0 +1,86 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+#include <cstdint>
+
+#include <vulkan/vulkan.hpp>
+#include "vertex.h"
+
+// Options for optimize_mesh.
+struct MeshOptimizeOptions
+{
+	bool optimizeOverdraw = true;		// Requires a float3 position at positionOffset
+	uint32_t positionOffset = 0;
+	float overdrawThreshold = 1.05f;	// Vertex cache efficiency the overdraw pass may give up (1.05 = 5%)
+};
+
+// Triangle list ready for upload: deduplicated vertices in fetch order and indices in the
+// smallest index type that addresses them.
+struct MeshData
+{
+	std::vector<uint8_t> vertices;
+	uint32_t vertexStride = 0;
+	uint32_t vertexCount = 0;
+
+	std::vector<uint8_t> indices;		// uint16_t or uint32_t values, depending on indexType
+	uint32_t indexCount = 0;
+	vk::IndexType indexType = vk::IndexType::eUint32;
+};
+
+// Average cache miss ratio (transformed vertices per triangle) of a FIFO post-transform cache.
+struct VertexCacheStats
+{
+	uint32_t vertexTransforms = 0;
+	float acmr = 0.0f;		// 0.5 is ideal for large regular meshes, 3.0 is no reuse at all
+};
+
+// Build an optimized mesh from a triangle list: duplicate vertices are merged, triangles are
+// reordered for the post-transform vertex cache and then in clusters for overdraw, vertices
+// are reordered in first-use order for fetch locality, and 16-bit indices are chosen when
+// the vertex count allows it. Without indices, every three vertices form a triangle.
+MeshData optimize_mesh(
+	const void* vertices, size_t vertexCount, size_t vertexStride,
+	const uint32_t* indices, size_t indexCount,
+	const MeshOptimizeOptions& options = {}
+);
+
+// Typed overload. For VertexFormat types the first attribute is taken as the position, and
+// overdraw optimization is skipped unless that attribute is a float3.
+template<typename Vertex>
+MeshData optimize_mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices = {}, MeshOptimizeOptions options = {})
+{
+	if constexpr (VertexFormatType<Vertex>)
+	{
+		constexpr VertexAttribute position = Vertex::attributes()[0];
+		options.positionOffset = position.offset;
+		options.optimizeOverdraw = options.optimizeOverdraw && position.format == vk::Format::eR32G32B32Sfloat;
+	}
+
+	return optimize_mesh(vertices.data(), vertices.size(), sizeof(Vertex), indices.data(), indices.size(), options);
+}
+
+// Individual stages, usable on their own. Index arrays hold indexCount values; dst and
+// indices may alias except where noted.
+
+// Build a table mapping every vertex to the first bytewise-identical one, compacted to
+// [0, uniqueCount). Vertices not referenced by indices map to ~0u. Returns uniqueCount.
+uint32_t generate_vertex_remap(std::vector<uint32_t>& remap, const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride);
+
+// Reorder triangles for the post-transform vertex cache (Forsyth's linear-speed algorithm).
+// dst must not alias indices.
+void optimize_vertex_cache(uint32_t* dst, const uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+// Reorder vertex-cache-optimized triangles in clusters so outward-facing clusters are drawn
+// first, after Sander et al. Clusters are split wherever their cache efficiency stays within
+// threshold of the whole mesh's. dst must not alias indices.
+void optimize_overdraw(uint32_t* dst, const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride, uint32_t positionOffset, float threshold);
+
+// Reorder vertices in order of first use and rewrite indices in place. Returns the number of
+// referenced vertices written to dstVertices.
+uint32_t optimize_vertex_fetch(void* dstVertices, uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride);
+
+// Simulate a FIFO post-transform cache of cacheSize vertices.
+VertexCacheStats analyze_vertex_cache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+#endif
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cassert>
+#include <memory>
+
+#include "parallel_recorder.h"
+
+// Creates one transient command pool per worker thread per frame in flight.
+void ParallelRecorder::init(vk::Device device, uint32_t queueFamily, uint32_t framesInFlight, ThreadPool& threadPool)
+{
+	m_Device = device;
+	m_ThreadPool = &threadPool;
+	m_ThreadSlots = threadPool.thread_count() + 1;
+	m_Allocators.resize(framesInFlight * m_ThreadSlots);
+
+	for (auto& allocator : m_Allocators)
+		allocator.init(m_Device, queueFamily);
+}
+
+// Destroys all per-thread command pools. The device must be idle.
+void ParallelRecorder::destroy()
+{
+	for (auto& allocator : m_Allocators)
+		allocator.destroy();
+
+	m_Allocators.clear();
+}
+
+// Resets the frame's pools that were used the last time this frame was recorded.
+void ParallelRecorder::begin_frame(uint32_t frameIndex)
+{
+	m_FrameIndex = frameIndex;
+
+	for (uint32_t i = 0; i < m_ThreadSlots; i++)
+		m_Allocators[m_FrameIndex * m_ThreadSlots + i].reset();
+}
+
+// Records the item range in parallel and executes the resulting secondaries from the primary.
+// Tasks are claimed from a shared counter by the calling thread and by helpers queued on the
+// pool; the caller waits for every claimed task to finish, never for a helper to start.
+void ParallelRecorder::record(
+	vk::CommandBuffer primary,
+	const vk::CommandBufferInheritanceInfo& inheritance,
+	uint32_t itemCount,
+	uint32_t itemsPerTask,
+	const RecordFunction& recordFn
+)
+{
+	assert(itemsPerTask > 0 && "itemsPerTask must be non-zero!");
+
+	if (itemCount == 0)
+		return;
+
+	uint32_t taskCount = (itemCount + itemsPerTask - 1) / itemsPerTask;
+	std::vector<vk::CommandBuffer> secondaries(taskCount);
+
+	vk::CommandBufferBeginInfo beginInfo(
+		vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+		&inheritance
+	);
+
+	// Helpers may start after record() has returned, so the counters they touch are shared.
+	// Everything else is only used for a claimed task, while record() is still waiting.
+	auto state = std::make_shared<RecordState>();
+	uint32_t frameIndex = m_FrameIndex;
+
+	auto runTasks = [this, state, frameIndex, taskCount, itemCount, itemsPerTask, &secondaries, &beginInfo, &recordFn]()
+	{
+		for (uint32_t task = state->nextTask++; task < taskCount; task = state->nextTask++)
+		{
+			try
+			{
+				// Only the executing thread touches its pool for this frame
+				uint32_t slot = m_ThreadPool->current_worker();
+				CommandAllocator& allocator = m_Allocators[frameIndex * m_ThreadSlots + slot];
+				vk::CommandBuffer commandBuffer = allocator.allocate(vk::CommandBufferLevel::eSecondary);
+
+				uint32_t first = task * itemsPerTask;
+				uint32_t last = std::min(first + itemsPerTask, itemCount);
+
+				commandBuffer.begin(beginInfo);
+				recordFn(commandBuffer, first, last);
+				commandBuffer.end();
+
+				secondaries[task] = commandBuffer;
+			}
+			catch (...)
+			{
+				std::lock_guard lock(state->mutex);
+				if (!state->exception)
+					state->exception = std::current_exception();
+			}
+
+			std::lock_guard lock(state->mutex);
+			if (++state->completed == taskCount)
+				state->done.notify_one();
+		}
+	};
+
+	uint32_t helperCount = std::min(m_ThreadPool->thread_count(), taskCount - 1);
+	for (uint32_t i = 0; i < helperCount; i++)
+		m_ThreadPool->submit(runTasks);
+
+	runTasks();
+
+	// An exception raised while recording is rethrown once no task references this frame's locals
+	{
+		std::unique_lock lock(state->mutex);
+		state->done.wait(lock, [&]() { return state->completed == taskCount; });
+	}
+
+	if (state->exception)
+		std::rethrow_exception(state->exception);
+
+	primary.executeCommands(secondaries);
+}
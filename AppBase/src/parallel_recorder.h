@@ -0,0 +1,66 @@
+#ifndef PARALLEL_RECORDER_H
+#define PARALLEL_RECORDER_H
+
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include <vulkan/vulkan.hpp>
+#include "thread_pool.h"
+#include "command_allocator.h"
+
+// Records secondary command buffers in parallel on a ThreadPool and stitches them into a
+// primary command buffer. Each worker thread records from its own command pool per frame in
+// flight, so recording never contends on a pool and pools are reset without synchronization
+// once their frame's fence has signaled.
+//
+// The calling thread records tasks too, from its own slot, and pool workers help as they
+// become free. Recording therefore always progresses, even while the pool is busy with other
+// jobs, and record() may be called from a pool worker.
+class ParallelRecorder
+{
+public:
+	// Records items [first, last) into a secondary command buffer that is already recording.
+	using RecordFunction = std::function<void(vk::CommandBuffer commandBuffer, uint32_t first, uint32_t last)>;
+
+	void init(vk::Device device, uint32_t queueFamily, uint32_t framesInFlight, ThreadPool& threadPool);
+	void destroy();
+
+	// Select the frame's pools and recycle their command buffers. The frame's fence must have
+	// signaled.
+	void begin_frame(uint32_t frameIndex);
+
+	// Split itemCount items into tasks of itemsPerTask, record each task's secondary command
+	// buffer on the calling thread and the pool, and execute all of them, in item order, from
+	// the primary.
+	void record(
+		vk::CommandBuffer primary,
+		const vk::CommandBufferInheritanceInfo& inheritance,
+		uint32_t itemCount,
+		uint32_t itemsPerTask,
+		const RecordFunction& recordFn
+	);
+
+private:
+	// Progress of one record() call
+	struct RecordState
+	{
+		std::atomic<uint32_t> nextTask = 0;
+		uint32_t completed = 0;			// Guarded by mutex, like exception
+		std::exception_ptr exception;
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+
+	vk::Device m_Device;
+	ThreadPool* m_ThreadPool = nullptr;
+	uint32_t m_ThreadSlots = 0;		// Pool workers plus one slot for the calling thread
+	uint32_t m_FrameIndex = 0;
+
+	std::vector<CommandAllocator> m_Allocators;		// Indexed by frame * m_ThreadSlots + thread
+};
+
+#endif
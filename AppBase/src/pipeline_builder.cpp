@@ -1,12 +1,14 @@
+#include <algorithm>
 #include <cassert>
-#include <fstream>
+#include <chrono>
 
 #include <spdlog/spdlog.h>
 #include "pipeline_builder.h"
+#include "hash.h"
 
-// Constructor: initializes device, physical device, and queries device properties/features.
-PipelineBuilder::PipelineBuilder(PipelineType pipelineType)
-	: m_PipelineType(pipelineType)
+// Constructor: stores the pipeline type and optional shared shader library.
+PipelineBuilder::PipelineBuilder(PipelineType pipelineType, ShaderLibrary* shaderLibrary)
+	: m_PipelineType(pipelineType), m_ShaderLibrary(shaderLibrary)
 {
 	
 }
@@ -16,33 +18,29 @@ PipelineBuilder::~PipelineBuilder()
 
 }
 
-// Add a shader stage from a SPIR-V file.
-PipelineBuilder& PipelineBuilder::add_shader_stage(const std::string& shaderPath, vk::ShaderStageFlagBits shaderStage)
+// Add a shader stage from a SPIR-V file. The file is read through the shader library when
+// one is set, so repeated stages share one load and one module, whatever their specialization.
+PipelineBuilder& PipelineBuilder::add_shader_stage(const std::string& shaderPath, vk::ShaderStageFlagBits shaderStage,
+	const SpecializationData& specialization, const std::string& entryPoint)
 {
-	std::ifstream file(shaderPath, std::ifstream::ate | std::ifstream::binary);
-	if (!file.is_open())
+	if (m_ShaderLibrary)
 	{
-		spdlog::error("Failed to open file " + shaderPath);
-		exit(EXIT_FAILURE);
+		std::shared_ptr<const ShaderEntry> entry = m_ShaderLibrary->load(shaderPath);
+		m_ShaderInfo.push_back({ entry->code, entry->module, shaderStage, specialization, entryPoint, shaderPath });
+		return *this;
 	}
 
-	size_t fileSize = file.tellg();
-	std::vector<char> shaderCode(fileSize);
-	file.seekg(0);
-	file.read(shaderCode.data(), fileSize);
-	file.close();
-
-	ShaderInfo shader = { .shaderCode = std::move(shaderCode), .shaderStage = shaderStage};
-	m_ShaderInfo.push_back(shader);
+	std::shared_ptr<const std::vector<char>> shaderCode = ShaderLibrary::read_spirv(shaderPath);
+	m_ShaderInfo.push_back({ std::move(shaderCode), nullptr, shaderStage, specialization, entryPoint, shaderPath });
 
 	return *this;
 }
 
 // Add a shader stage from an existing shader module.
-PipelineBuilder& PipelineBuilder::add_shader_stage(vk::ShaderModule shaderModule, vk::ShaderStageFlagBits shaderStage)
+PipelineBuilder& PipelineBuilder::add_shader_stage(vk::ShaderModule shaderModule, vk::ShaderStageFlagBits shaderStage,
+	const SpecializationData& specialization, const std::string& entryPoint)
 {
-	ShaderModule shader = { .shaderModule = shaderModule, .shaderStage = shaderStage };
-	m_ShaderModules.push_back(shader);
+	m_ShaderInfo.push_back({ nullptr, shaderModule, shaderStage, specialization, entryPoint, {} });
 	return *this;
 }
 
@@ -241,6 +239,26 @@ PipelineBuilder& PipelineBuilder::set_render_pass(vk::RenderPass& renderPass, ui
 {
 	m_RenderPass = renderPass;
 	m_SubpassIndex = subpassIndex;
+	m_DynamicRendering = false;
+	return *this;
+}
+
+// Set attachment formats for dynamic rendering. Clears any render pass.
+PipelineBuilder& PipelineBuilder::set_rendering_formats(const std::vector<vk::Format>& colorFormats, vk::Format depthFormat, vk::Format stencilFormat)
+{
+	m_RenderPass = nullptr;
+	m_SubpassIndex = 0;
+	m_DynamicRendering = true;
+	m_ColorFormats = colorFormats;
+	m_DepthFormat = depthFormat;
+	m_StencilFormat = stencilFormat;
+	return *this;
+}
+
+// Set the multiview mask used with dynamic rendering.
+PipelineBuilder& PipelineBuilder::set_view_mask(uint32_t viewMask)
+{
+	m_ViewMask = viewMask;
 	return *this;
 }
 
@@ -343,28 +361,95 @@ PipelineBuilder& PipelineBuilder::add_push_constant_range(vk::PushConstantRange
 	return *this;
 }
 
-// Build and return the Vulkan graphics pipeline.
-vk::UniquePipeline PipelineBuilder::build(vk::Device device)
+// Use a caller-owned pipeline layout for every build.
+PipelineBuilder& PipelineBuilder::set_pipeline_layout(vk::PipelineLayout pipelineLayout)
 {
-	std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
+	m_PipelineLayout = pipelineLayout;
+	return *this;
+}
+
+namespace
+{
+	constexpr vk::GraphicsPipelineLibraryFlagsEXT AllLibraryParts =
+		vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface |
+		vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders |
+		vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader |
+		vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface;
 
-	for (auto shaderInfo : m_ShaderInfo)
+	// Fragment shaders belong to the fragment shader section, every other stage to pre-rasterization.
+	bool stage_in_parts(vk::ShaderStageFlagBits stage, vk::GraphicsPipelineLibraryFlagsEXT parts)
 	{
-		vk::ShaderModuleCreateInfo stageModuleInfo(
-			{},
-			shaderInfo.shaderCode.size(),
-			reinterpret_cast<const uint32_t*>(shaderInfo.shaderCode.data())
-		);
-		vk::ShaderModule module = device.createShaderModule(stageModuleInfo);
-		m_ShaderModules.push_back({module, shaderInfo.shaderStage});
+		if (stage == vk::ShaderStageFlagBits::eFragment)
+			return static_cast<bool>(parts & vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader);
+		return static_cast<bool>(parts & vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders);
 	}
+}
+
+// Build and return the Vulkan graphics pipeline.
+vk::UniquePipeline PipelineBuilder::build(vk::Device device, PipelineCache* pipelineCache) const
+{
+	return create_pipeline(device, pipelineCache, AllLibraryParts, {}, {});
+}
+
+// Build one section of a graphics pipeline as a library.
+vk::UniquePipeline PipelineBuilder::build_library(vk::Device device, vk::GraphicsPipelineLibraryFlagBitsEXT part, PipelineCache* pipelineCache) const
+{
+	assert(m_PipelineType == PipelineType::Graphics && "Only graphics pipelines can be built from libraries!");
 
-	for (const auto& shaderModule : m_ShaderModules)
+	vk::PipelineCreateFlags flags = vk::PipelineCreateFlagBits::eLibraryKHR | vk::PipelineCreateFlagBits::eRetainLinkTimeOptimizationInfoEXT;
+	return create_pipeline(device, pipelineCache, part, flags, {});
+}
+
+// Link libraries into an executable pipeline, with link-time optimization if requested.
+vk::UniquePipeline PipelineBuilder::link_libraries(vk::Device device, const std::vector<vk::Pipeline>& libraries, bool optimize, PipelineCache* pipelineCache) const
+{
+	assert(m_PipelineType == PipelineType::Graphics && "Only graphics pipelines can be built from libraries!");
+
+	vk::PipelineCreateFlags flags{};
+	if (optimize)
+		flags |= vk::PipelineCreateFlagBits::eLinkTimeOptimizationEXT;
+	return create_pipeline(device, pipelineCache, {}, flags, libraries);
+}
+
+// Creates the pipeline from the sections of the state selected by parts. Sections left out
+// are passed as null state and are supplied by the linked libraries instead.
+vk::UniquePipeline PipelineBuilder::create_pipeline(vk::Device device, PipelineCache* pipelineCache, vk::GraphicsPipelineLibraryFlagsEXT parts,
+	vk::PipelineCreateFlags flags, const std::vector<vk::Pipeline>& libraries) const
+{
+	std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
+
+	// Library and caller-provided modules are used as-is; modules created from loose SPIR-V
+	// live only for this build
+	std::vector<vk::ShaderModule> temporaryModules;
+
+	// Reserved up front so the stages' pointers into it stay valid
+	std::vector<vk::SpecializationInfo> specializationInfos;
+	specializationInfos.reserve(m_ShaderInfo.size());
+
+	for (const auto& shaderInfo : m_ShaderInfo)
 	{
+		if (m_PipelineType == PipelineType::Graphics && !stage_in_parts(shaderInfo.shaderStage, parts))
+			continue;
+
+		vk::ShaderModule module = shaderInfo.shaderModule;
+
+		if (!module)
+		{
+			vk::ShaderModuleCreateInfo stageModuleInfo(
+				{},
+				shaderInfo.shaderCode->size(),
+				reinterpret_cast<const uint32_t*>(shaderInfo.shaderCode->data())
+			);
+			module = device.createShaderModule(stageModuleInfo);
+			temporaryModules.push_back(module);
+		}
+
 		vk::PipelineShaderStageCreateInfo stageInfo{};
-		stageInfo.stage = shaderModule.shaderStage;
-		stageInfo.module = shaderModule.shaderModule;
-		stageInfo.pName = "main";
+		stageInfo.stage = shaderInfo.shaderStage;
+		stageInfo.module = module;
+		stageInfo.pName = shaderInfo.entryPoint.c_str();
+		if (!shaderInfo.specialization.empty())
+			stageInfo.pSpecializationInfo = &specializationInfos.emplace_back(shaderInfo.specialization.info());
 		shaderStages.push_back(stageInfo);
 	}
 
@@ -446,32 +531,82 @@ vk::UniquePipeline PipelineBuilder::build(vk::Device device)
 
 	vk::PipelineDynamicStateCreateInfo dynamicStateInfo({}, state.dynamicStates);
 
-	vk::PipelineLayoutCreateInfo pipelineLayoutInfo({}, state.pipelineLayout.descriptorSetLayouts, state.pipelineLayout.pushConstantRanges);
-	vk::PipelineLayout pipelineLayout = device.createPipelineLayout(pipelineLayoutInfo);
+	// Without a caller-provided layout, a temporary one lives only for this build
+	vk::PipelineLayout pipelineLayout = m_PipelineLayout;
+	if (!pipelineLayout)
+	{
+		vk::PipelineLayoutCreateInfo pipelineLayoutInfo({}, state.pipelineLayout.descriptorSetLayouts, state.pipelineLayout.pushConstantRanges);
+		pipelineLayout = device.createPipelineLayout(pipelineLayoutInfo);
+	}
 
 	vk::UniquePipeline pipeline;
 
+	// Creation feedback reports whether the driver found the pipeline in the cache
+	vk::PipelineCreationFeedback creationFeedback{};
+	vk::PipelineCreationFeedbackCreateInfo feedbackInfo(&creationFeedback);
+	vk::PipelineCache cache = pipelineCache ? pipelineCache->get() : vk::PipelineCache{};
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+
 	if (m_PipelineType == PipelineType::Graphics)
 	{
+		if (!m_DynamicRendering && !m_RenderPass)
+		{
+			spdlog::error("Graphics pipeline has neither a render pass nor dynamic rendering formats.");
+			throw std::runtime_error("Missing render pass or rendering formats.");
+		}
+
+		bool vertexInput = static_cast<bool>(parts & vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface);
+		bool preRasterization = static_cast<bool>(parts & vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders);
+		bool fragmentShader = static_cast<bool>(parts & vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader);
+		bool fragmentOutput = static_cast<bool>(parts & vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface);
+
+		// With dynamic rendering the attachment formats replace the render pass. Library
+		// builds name their section and links list their libraries, further down the chain.
+		vk::PipelineRenderingCreateInfo renderingInfo(m_ViewMask, m_ColorFormats, m_DepthFormat, m_StencilFormat);
+		vk::GraphicsPipelineLibraryCreateInfoEXT libraryInfo(parts);
+		vk::PipelineLibraryCreateInfoKHR linkInfo(libraries);
+
+		const void* next = nullptr;
+		if (!libraries.empty())
+		{
+			linkInfo.pNext = next;
+			next = &linkInfo;
+		}
+		if (flags & vk::PipelineCreateFlagBits::eLibraryKHR)
+		{
+			libraryInfo.pNext = next;
+			next = &libraryInfo;
+		}
+		if (m_DynamicRendering)
+		{
+			renderingInfo.pNext = next;
+			next = &renderingInfo;
+		}
+		feedbackInfo.pNext = next;
+
 		// Create the graphics pipeline.
 		vk::GraphicsPipelineCreateInfo pipelineInfo(
-			{},
+			flags,
 			shaderStages,
-			&vertexInputInfo,
-			&inputAssemblyInfo,
-			&tessellationInfo,
-			&viewportStateInfo,
-			&rasterizerInfo,
-			&multisamplingInfo,
-			&depthStencilInfo,
-			&colorBlendInfo,
+			vertexInput ? &vertexInputInfo : nullptr,
+			vertexInput ? &inputAssemblyInfo : nullptr,
+			preRasterization ? &tessellationInfo : nullptr,
+			preRasterization ? &viewportStateInfo : nullptr,
+			preRasterization ? &rasterizerInfo : nullptr,
+			fragmentShader || fragmentOutput ? &multisamplingInfo : nullptr,
+			fragmentShader ? &depthStencilInfo : nullptr,
+			fragmentOutput ? &colorBlendInfo : nullptr,
 			&dynamicStateInfo,
 			pipelineLayout,
 			m_RenderPass,
-			m_SubpassIndex
+			m_SubpassIndex,
+			{},
+			-1,
+			&feedbackInfo
 		);
 
-		vk::ResultValue result = device.createGraphicsPipelineUnique(VK_NULL_HANDLE, pipelineInfo);
+		vk::ResultValue result = device.createGraphicsPipelineUnique(cache, pipelineInfo);
 
 		if (result.result != vk::Result::eSuccess)
 		{
@@ -485,12 +620,15 @@ vk::UniquePipeline PipelineBuilder::build(vk::Device device)
 	{
 		// Create the compute pipeline.
 		vk::ComputePipelineCreateInfo pipelineInfo(
-			{},
+			flags,
 			shaderStages[0], // Only one shader stage for compute
-			pipelineLayout
+			pipelineLayout,
+			{},
+			-1,
+			&feedbackInfo
 		);
 
-		vk::ResultValue result = device.createComputePipelineUnique(VK_NULL_HANDLE, pipelineInfo);
+		vk::ResultValue result = device.createComputePipelineUnique(cache, pipelineInfo);
 
 		if (result.result != vk::Result::eSuccess)
 		{
@@ -501,12 +639,24 @@ vk::UniquePipeline PipelineBuilder::build(vk::Device device)
 		pipeline = std::move(result.value);
 	}
 
-	for (auto& shaderModule : m_ShaderModules)
+	std::chrono::duration<double, std::milli> buildTime = std::chrono::high_resolution_clock::now() - startTime;
+
+	if (pipelineCache)
+	{
+		bool feedbackValid = static_cast<bool>(creationFeedback.flags & vk::PipelineCreationFeedbackFlagBits::eValid);
+		bool cacheHit = feedbackValid && (creationFeedback.flags & vk::PipelineCreationFeedbackFlagBits::eApplicationPipelineCacheHit);
+
+		pipelineCache->record(cacheHit, buildTime);
+		spdlog::debug("Pipeline built in {:.3f} ms (cache {})", buildTime.count(), !feedbackValid ? "unknown" : cacheHit ? "hit" : "miss");
+	}
+
+	for (auto& module : temporaryModules)
 	{
-		device.destroyShaderModule(shaderModule.shaderModule);
+		device.destroyShaderModule(module);
 	}
 
-	device.destroyPipelineLayout(pipelineLayout);
+	if (!m_PipelineLayout)
+		device.destroyPipelineLayout(pipelineLayout);
 
 	if (pipeline.get() == VK_NULL_HANDLE)
 	{
@@ -514,7 +664,249 @@ vk::UniquePipeline PipelineBuilder::build(vk::Device device)
 		throw std::runtime_error("Pipeline creation failed.");
 	}
 
-	return std::move(pipeline);
+	return pipeline;
+}
+
+namespace
+{
+	// Appends trivially copyable values to a pipeline key. All Vulkan state structs written
+	// here consist solely of 32-bit members (or handles), so they contain no padding bytes.
+	struct KeyWriter
+	{
+		std::vector<uint8_t>& bytes;
+
+		template<typename T>
+		void write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Key values must be trivially copyable");
+			const uint8_t* data = reinterpret_cast<const uint8_t*>(&value);
+			bytes.insert(bytes.end(), data, data + sizeof(T));
+		}
+
+		void write(const std::string& value)
+		{
+			write(static_cast<uint64_t>(value.size()));
+			bytes.insert(bytes.end(), value.begin(), value.end());
+		}
+
+		// Elements are copied in one insert; the bytes match writing them one by one
+		template<typename T>
+		void write(const std::vector<T>& values)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Key values must be trivially copyable");
+			write(static_cast<uint64_t>(values.size()));
+			const uint8_t* data = reinterpret_cast<const uint8_t*>(values.data());
+			bytes.insert(bytes.end(), data, data + values.size() * sizeof(T));
+		}
+	};
+}
+
+// Serializes the full builder state (fixed-function state, layout, render pass and shaders)
+// into a key. Shader code is written in full, so equal keys always mean equal code, followed
+// by the stage's entry point and specialization constants.
+PipelineKey PipelineBuilder::key() const
+{
+	PipelineKey key;
+	KeyWriter writer{ key.bytes };
+
+	writer.write(m_PipelineType);
+	write_key(key.bytes, AllLibraryParts);
+
+	key.hash = fnv1a_64(key.bytes.data(), key.bytes.size());
+	return key;
+}
+
+// Keys a library on its section alone. The section is written first, so libraries of
+// different sections never share keys.
+PipelineKey PipelineBuilder::library_key(vk::GraphicsPipelineLibraryFlagBitsEXT part) const
+{
+	PipelineKey key;
+	KeyWriter writer{ key.bytes };
+
+	writer.write(m_PipelineType);
+	writer.write(part);
+	write_key(key.bytes, part);
+
+	key.hash = fnv1a_64(key.bytes.data(), key.bytes.size());
+	return key;
+}
+
+// Writes the render pass and formats, shaders, fixed-function state and layout used by the
+// given sections. Dynamic states are written for every section, since each reads its own.
+void PipelineBuilder::write_key(std::vector<uint8_t>& bytes, vk::GraphicsPipelineLibraryFlagsEXT parts) const
+{
+	KeyWriter writer{ bytes };
+
+	bool vertexInput = static_cast<bool>(parts & vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface);
+	bool preRasterization = static_cast<bool>(parts & vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders);
+	bool fragmentShader = static_cast<bool>(parts & vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader);
+	bool fragmentOutput = static_cast<bool>(parts & vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface);
+
+	if (preRasterization || fragmentShader || fragmentOutput)
+	{
+		writer.write(m_RenderPass);
+		writer.write(m_SubpassIndex);
+		writer.write(static_cast<uint32_t>(m_DynamicRendering));
+		writer.write(m_ViewMask);
+	}
+
+	if (fragmentOutput)
+	{
+		writer.write(m_ColorFormats);
+		writer.write(m_DepthFormat);
+		writer.write(m_StencilFormat);
+	}
+
+	// Shaders with known code are keyed by their full SPIR-V, caller-provided modules by handle.
+	// A hash of the code alone could collide and return a pipeline built from other shaders.
+	for (const auto& shaderInfo : m_ShaderInfo)
+	{
+		if (!stage_in_parts(shaderInfo.shaderStage, parts))
+			continue;
+
+		writer.write(shaderInfo.shaderStage);
+
+		if (shaderInfo.shaderCode)
+		{
+			writer.write(*shaderInfo.shaderCode);
+		}
+		else
+		{
+			writer.write(shaderInfo.shaderModule);
+		}
+
+		writer.write(shaderInfo.entryPoint);
+
+		// Entries are sorted by ID; sizes are written as 64 bits whatever size_t is
+		writer.write(static_cast<uint64_t>(shaderInfo.specialization.entries.size()));
+		for (const vk::SpecializationMapEntry& entry : shaderInfo.specialization.entries)
+		{
+			writer.write(entry.constantID);
+			writer.write(entry.offset);
+			writer.write(static_cast<uint64_t>(entry.size));
+		}
+		writer.write(shaderInfo.specialization.data);
+	}
+
+	writer.write(state.dynamicStates);
+
+	if (vertexInput)
+	{
+		writer.write(state.vertexInput.bindingDescriptions);
+		writer.write(state.vertexInput.attributeDescriptions);
+		writer.write(state.inputAssembly.topology);
+		writer.write(state.inputAssembly.primitiveRestartEnable);
+	}
+
+	if (preRasterization)
+	{
+		writer.write(state.tessellationState.patchControlPoints);
+		writer.write(state.viewportState.viewports);
+		writer.write(state.viewportState.scissors);
+
+		const auto& raster = state.rasterizationState;
+		writer.write(raster.depthClamp);
+		writer.write(raster.rasterizerDiscard);
+		writer.write(raster.polygonMode);
+		writer.write(raster.cullMode);
+		writer.write(raster.frontFace);
+		writer.write(raster.depthBias);
+		writer.write(raster.lineWidth);
+		writer.write(raster.depthBiasConstant);
+		writer.write(raster.depthBiasClamp);
+		writer.write(raster.depthBiasSlope);
+	}
+
+	if (fragmentShader || fragmentOutput)
+	{
+		const auto& multisample = state.multisampleState;
+		writer.write(multisample.rasterizationSamples);
+		writer.write(multisample.sampleShadingEnable);
+		writer.write(multisample.minSampleShading);
+		writer.write(multisample.sampleMasks);
+		writer.write(multisample.alphaToCoverageEnable);
+		writer.write(multisample.alphaToOneEnable);
+	}
+
+	if (fragmentShader)
+	{
+		const auto& depthStencil = state.depthStencilState;
+		writer.write(depthStencil.depthTestEnable);
+		writer.write(depthStencil.depthWriteEnable);
+		writer.write(depthStencil.depthCompareOp);
+		writer.write(depthStencil.depthBoundsTestEnable);
+		writer.write(depthStencil.stencilTestEnable);
+		writer.write(depthStencil.front);
+		writer.write(depthStencil.back);
+		writer.write(depthStencil.minDepthBounds);
+		writer.write(depthStencil.maxDepthBounds);
+	}
+
+	if (fragmentOutput)
+	{
+		writer.write(state.colorBlendState.logicOpEnable);
+		writer.write(state.colorBlendState.logicOp);
+		writer.write(state.colorBlendState.attachments);
+		writer.write(state.colorBlendState.blendConstants);
+	}
+
+	// Both shader sections are created with the layout, and linking requires them to match
+	if (preRasterization || fragmentShader)
+	{
+		writer.write(state.pipelineLayout.descriptorSetLayouts);
+		writer.write(state.pipelineLayout.pushConstantRanges);
+		writer.write(m_PipelineLayout);
+	}
+}
+
+// Queue one build per builder on the thread pool. vkCreate*Pipelines is free-threaded for a
+// shared cache (no externally-synchronized flag is set), so all workers feed the same cache.
+std::vector<std::future<vk::UniquePipeline>> PipelineBuilder::build_batch(
+	vk::Device device,
+	const std::vector<PipelineBuilder>& builders,
+	ThreadPool& threadPool,
+	PipelineCache* pipelineCache
+)
+{
+	std::vector<std::future<vk::UniquePipeline>> pipelines;
+	pipelines.reserve(builders.size());
+
+	for (const auto& builder : builders)
+	{
+		pipelines.push_back(threadPool.submit([device, &builder, pipelineCache]()
+		{
+			return builder.build(device, pipelineCache);
+		}));
+	}
+
+	return pipelines;
+}
+
+// Checks the paths stages were added with.
+bool PipelineBuilder::uses_shader(const std::string& shaderPath) const
+{
+	return std::any_of(m_ShaderInfo.begin(), m_ShaderInfo.end(), [&](const ShaderInfo& shaderInfo)
+	{
+		return !shaderInfo.shaderPath.empty() && shaderInfo.shaderPath == shaderPath;
+	});
+}
+
+// Matches stages by the path they were added with, as the shader library does.
+bool PipelineBuilder::update_shader(const ShaderEntry& entry)
+{
+	bool used = false;
+
+	for (ShaderInfo& shaderInfo : m_ShaderInfo)
+	{
+		if (shaderInfo.shaderPath.empty() || shaderInfo.shaderPath != entry.path)
+			continue;
+
+		shaderInfo.shaderCode = entry.code;
+		shaderInfo.shaderModule = entry.module;
+		used = true;
+	}
+
+	return used;
 }
 
 // Helper to add or remove a dynamic state.
@@ -7,9 +7,14 @@
 #include <unordered_map>
 #include <type_traits>
 #include <array>
+#include <future>
 
 #include <vulkan/vulkan.hpp>
 #include "vertex.h"
+#include "pipeline_cache.h"
+#include "thread_pool.h"
+#include "shader_library.h"
+#include "specialization.h"
 
 // TODO: Raytracing pipeline support
 enum class PipelineType
@@ -18,16 +23,63 @@ enum class PipelineType
 	Compute,
 };
 
+// Byte-exact description of everything that affects a built pipeline, used to
+// deduplicate pipelines in the PipelineRegistry.
+struct PipelineKey
+{
+	std::vector<uint8_t> bytes;
+	uint64_t hash = 0;
+
+	bool operator==(const PipelineKey& other) const { return hash == other.hash && bytes == other.bytes; }
+};
+
+struct PipelineKeyHash
+{
+	size_t operator()(const PipelineKey& key) const { return static_cast<size_t>(key.hash); }
+};
+
+// Sections of a graphics pipeline that VK_EXT_graphics_pipeline_library compiles on their own,
+// in the order they are linked.
+inline constexpr std::array<vk::GraphicsPipelineLibraryFlagBitsEXT, 4> PipelineLibraryParts =
+{
+	vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface,
+	vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders,
+	vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader,
+	vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface,
+};
+
 // Helper class for building Vulkan graphics pipelines with a fluent interface.
 class PipelineBuilder
 {
 public:
-	PipelineBuilder(PipelineType pipelineType);
+	// With a shader library, shader files are loaded and turned into modules once and shared
+	// across builders; without one, each build creates and destroys its own modules.
+	PipelineBuilder(PipelineType pipelineType, ShaderLibrary* shaderLibrary = nullptr);
 	~PipelineBuilder();
 
-	// Add a shader stage from a SPIR-V file.
-	PipelineBuilder& add_shader_stage(const std::string& shaderPath, vk::ShaderStageFlagBits shaderStage);
-	PipelineBuilder& add_shader_stage(vk::ShaderModule shaderModule, vk::ShaderStageFlagBits shaderStage);
+	// Add a shader stage from a SPIR-V file. Specialization constants turn one SPIR-V file into
+	// variants whose constant branches and workgroup sizes are folded by the driver; they are
+	// part of the pipeline key.
+	PipelineBuilder& add_shader_stage(const std::string& shaderPath, vk::ShaderStageFlagBits shaderStage,
+		const SpecializationData& specialization = {}, const std::string& entryPoint = "main");
+	// Add a shader stage from an existing module. The module remains owned by the caller.
+	PipelineBuilder& add_shader_stage(vk::ShaderModule shaderModule, vk::ShaderStageFlagBits shaderStage,
+		const SpecializationData& specialization = {}, const std::string& entryPoint = "main");
+
+	// Typed overloads, checked against the constant set at compile time.
+	template<typename... Constants>
+	PipelineBuilder& add_shader_stage(const std::string& shaderPath, vk::ShaderStageFlagBits shaderStage,
+		const SpecializationMap<Constants...>& specialization, const std::string& entryPoint = "main")
+	{
+		return add_shader_stage(shaderPath, shaderStage, specialization.data(), entryPoint);
+	}
+
+	template<typename... Constants>
+	PipelineBuilder& add_shader_stage(vk::ShaderModule shaderModule, vk::ShaderStageFlagBits shaderStage,
+		const SpecializationMap<Constants...>& specialization, const std::string& entryPoint = "main")
+	{
+		return add_shader_stage(shaderModule, shaderStage, specialization.data(), entryPoint);
+	}
 
 	// Set input assembly and primitive topology.
 	PipelineBuilder& set_primitive_topology(vk::PrimitiveTopology topology);
@@ -65,6 +117,9 @@ public:
 
 	// Render pass and subpass.
 	PipelineBuilder& set_render_pass(vk::RenderPass& renderPass, uint32_t subpassIndex);
+	// Attachment formats for dynamic rendering, used instead of a render pass.
+	PipelineBuilder& set_rendering_formats(const std::vector<vk::Format>& colorFormats, vk::Format depthFormat = vk::Format::eUndefined, vk::Format stencilFormat = vk::Format::eUndefined);
+	PipelineBuilder& set_view_mask(uint32_t viewMask);
 
 	// Depth/stencil state.
 	PipelineBuilder& set_depth_test(bool enable);
@@ -85,17 +140,58 @@ public:
 	// Pipeline layout.
 	PipelineBuilder& add_descriptor_set_layout(vk::DescriptorSetLayout descriptorSetLayout);
 	PipelineBuilder& add_push_constant_range(vk::PushConstantRange pushConstantRange);
-
-	// Build the pipeline.
-	vk::UniquePipeline build(vk::Device device);
-
-	// Set the vertex format using a CRTP vertex type.
-	template<typename T>
+	// Build with an existing layout, owned by the caller, instead of one created from the
+	// descriptor set layouts and push constant ranges. Needed to bind descriptors or push
+	// constants for the built pipeline.
+	PipelineBuilder& set_pipeline_layout(vk::PipelineLayout pipelineLayout);
+
+	// Build the pipeline, optionally through a persistent pipeline cache.
+	vk::UniquePipeline build(vk::Device device, PipelineCache* pipelineCache = nullptr) const;
+
+	// Compute the key identifying the pipeline this builder would produce.
+	PipelineKey key() const;
+
+	// Graphics pipeline libraries (VK_EXT_graphics_pipeline_library). Each section of the state
+	// is built as a library keyed only on the state it depends on, so builders that differ in
+	// e.g. their fragment shader share the vertex input, pre-rasterization and output
+	// libraries. Libraries retain link-time optimization info, so they can be linked fast
+	// (near-instant, slower code) or optimized (a full compile, equivalent to build()).
+	vk::UniquePipeline build_library(vk::Device device, vk::GraphicsPipelineLibraryFlagBitsEXT part, PipelineCache* pipelineCache = nullptr) const;
+	PipelineKey library_key(vk::GraphicsPipelineLibraryFlagBitsEXT part) const;
+	// Link one library per section, built from builders with the same layout as this one.
+	vk::UniquePipeline link_libraries(vk::Device device, const std::vector<vk::Pipeline>& libraries, bool optimize, PipelineCache* pipelineCache = nullptr) const;
+
+	PipelineType type() const { return m_PipelineType; }
+
+	// True if a stage was added from the given SPIR-V path.
+	bool uses_shader(const std::string& shaderPath) const;
+	// Point the stages loaded from the entry's file at its reloaded code and module. Returns
+	// false if no stage uses the file. The key changes with the code.
+	bool update_shader(const ShaderEntry& entry);
+
+	// Build many pipelines in parallel on a worker pool, sharing one pipeline cache.
+	// The builders must outlive the returned futures.
+	static std::vector<std::future<vk::UniquePipeline>> build_batch(
+		vk::Device device,
+		const std::vector<PipelineBuilder>& builders,
+		ThreadPool& threadPool,
+		PipelineCache* pipelineCache = nullptr
+	);
+
+	// Set the vertex input from one or more CRTP vertex formats, e.g. a per-vertex format on
+	// binding 0 and a per-instance one on binding 1. Shader locations are assigned
+	// consecutively across the formats in the order given.
+	template<VertexFormatType... Formats>
 	PipelineBuilder& set_vertex_format()
 	{
-		static_assert(std::is_base_of_v<T, VertexFormat>, "Must inherit from VertexFormat CRTP");
-		state.vertexInput.add_binding_descriptions(T::get_binding_description());
-		state.vertexInput.add_attribute_description(T::get_attribute_description());
+		static_assert(sizeof...(Formats) > 0, "At least one vertex format is required");
+
+		state.vertexInput.bindingDescriptions.clear();
+		state.vertexInput.attributeDescriptions.clear();
+
+		uint32_t firstLocation = 0;
+		(add_vertex_format<Formats>(firstLocation), ...);
+		return *this;
 	}
 
 	// Holds all pipeline state for construction.
@@ -119,6 +215,13 @@ public:
 				return *this;
 			}
 
+			// Binding advanced once per instance instead of once per vertex.
+			VertexInput& add_instance_binding(uint32_t binding, uint32_t stride)
+			{
+				bindingDescriptions.push_back({ binding, stride, vk::VertexInputRate::eInstance });
+				return *this;
+			}
+
 			VertexInput& add_attribute_description(uint32_t binding, uint32_t location, vk::Format format, uint32_t offset)
 			{
 				attributeDescriptions.push_back({ binding, location, format, offset });
@@ -201,7 +304,7 @@ public:
 			vk::Bool32 logicOpEnable = false;
 			vk::LogicOp logicOp = vk::LogicOp::eNoOp;
 			std::vector<vk::PipelineColorBlendAttachmentState> attachments;
-			std::array<float, 4> blendConstants;
+			std::array<float, 4> blendConstants{};
 		} colorBlendState;
 
 		// Pipeline layout state.
@@ -215,25 +318,53 @@ public:
 private:
 	struct ShaderInfo
 	{
-		std::vector<char> shaderCode;
-		vk::ShaderStageFlagBits shaderStage;
-	};
-
-	struct ShaderModule
-	{
-		vk::ShaderModule shaderModule;
+		std::shared_ptr<const std::vector<char>> shaderCode;	// Null for caller-provided modules
+		vk::ShaderModule shaderModule;							// Null if the module is created per build
 		vk::ShaderStageFlagBits shaderStage;
+		SpecializationData specialization;
+		std::string entryPoint = "main";
+		std::string shaderPath;									// Empty for caller-provided modules
 	};
 
 	PipelineType m_PipelineType;
+	ShaderLibrary* m_ShaderLibrary = nullptr;
 	vk::RenderPass m_RenderPass;
 	uint32_t m_SubpassIndex = 0;
+	vk::PipelineLayout m_PipelineLayout;	// Caller-owned layout, or null to create one per build
+
+	// Dynamic rendering attachment formats, used when no render pass is set
+	bool m_DynamicRendering = false;
+	std::vector<vk::Format> m_ColorFormats;
+	vk::Format m_DepthFormat = vk::Format::eUndefined;
+	vk::Format m_StencilFormat = vk::Format::eUndefined;
+	uint32_t m_ViewMask = 0;
 
 	std::vector<ShaderInfo> m_ShaderInfo;
-	std::vector<ShaderModule> m_ShaderModules;
 private:
 	// Helper to enable/disable a dynamic state.
 	void toggle_dynamic_state(bool enable, vk::DynamicState dynamicState);
+
+	// Creates a pipeline describing only the given sections of the state, plus any linked
+	// libraries. All sections and no libraries is a regular monolithic pipeline.
+	vk::UniquePipeline create_pipeline(vk::Device device, PipelineCache* pipelineCache, vk::GraphicsPipelineLibraryFlagsEXT parts,
+		vk::PipelineCreateFlags flags, const std::vector<vk::Pipeline>& libraries) const;
+	// Append the state of the given sections to a key. Compute shaders count as pre-rasterization.
+	void write_key(std::vector<uint8_t>& bytes, vk::GraphicsPipelineLibraryFlagsEXT parts) const;
+
+	// Append one vertex format's binding and attributes, offsetting its locations.
+	template<VertexFormatType Format>
+	void add_vertex_format(uint32_t& firstLocation)
+	{
+		state.vertexInput.add_binding_descriptions(Format::get_binding_description());
+
+		for (vk::VertexInputAttributeDescription attribute : Format::get_attribute_descriptions())
+		{
+			attribute.location += firstLocation;
+			state.vertexInput.add_attribute_description(attribute);
+		}
+
+		firstLocation += Format::location_count();
+	}
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+
+#include <spdlog/spdlog.h>
+#include "pipeline_cache.h"
+
+// Creates the pipeline cache, seeding it with validated data from disk.
+void PipelineCache::init(vk::PhysicalDevice physicalDevice, vk::Device device, const std::string& path)
+{
+	m_Device = device;
+	m_Path = path;
+	m_DeviceProperties = physicalDevice.getProperties();
+
+	std::vector<char> initialData = load_validated();
+
+	vk::PipelineCacheCreateInfo cacheInfo({}, initialData.size(), initialData.data());
+	m_Cache = m_Device.createPipelineCache(cacheInfo);
+}
+
+// Writes the cache to disk and destroys it.
+void PipelineCache::destroy()
+{
+	save();
+	log_stats();
+
+	m_Device.destroyPipelineCache(m_Cache);
+	m_Cache = nullptr;
+}
+
+// Serializes the cache to disk. Data is written to a temporary file first so an interrupted
+// save never leaves a truncated cache behind.
+void PipelineCache::save()
+{
+	if (m_Path.empty() || !m_Cache)
+		return;
+
+	std::vector<uint8_t> data = m_Device.getPipelineCacheData(m_Cache);
+
+	std::string tempPath = m_Path + ".tmp";
+	std::ofstream file(tempPath, std::ofstream::binary | std::ofstream::trunc);
+	if (!file.is_open())
+	{
+		spdlog::warn("Failed to write pipeline cache " + tempPath);
+		return;
+	}
+
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	file.close();
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, m_Path, ec);
+	if (ec)
+	{
+		spdlog::warn("Failed to replace pipeline cache {}: {}", m_Path, ec.message());
+		return;
+	}
+
+	spdlog::info("Saved pipeline cache ({} bytes) to {}", data.size(), m_Path);
+}
+
+// Accumulates hit/miss counts and creation time.
+void PipelineCache::record(bool cacheHit, std::chrono::duration<double, std::milli> duration)
+{
+	auto microseconds = static_cast<uint64_t>(duration.count() * 1000.0);
+
+	if (cacheHit)
+	{
+		m_Hits++;
+		m_HitMicroseconds += microseconds;
+	}
+	else
+	{
+		m_Misses++;
+		m_MissMicroseconds += microseconds;
+	}
+}
+
+// Logs cache hit/miss counts with total and average creation times.
+void PipelineCache::log_stats() const
+{
+	uint32_t hits = m_Hits, misses = m_Misses;
+	if (hits + misses == 0)
+		return;
+
+	double hitMs = m_HitMicroseconds / 1000.0, missMs = m_MissMicroseconds / 1000.0;
+
+	spdlog::info("Pipeline cache: {} hit(s) in {:.2f} ms (avg {:.3f} ms), {} miss(es) in {:.2f} ms (avg {:.3f} ms)",
+		hits, hitMs, hits ? hitMs / hits : 0.0,
+		misses, missMs, misses ? missMs / misses : 0.0
+	);
+}
+
+// Reads the cache file and checks its header against the current device. Returns an empty
+// buffer if the file is missing, truncated or was produced by a different device or driver.
+std::vector<char> PipelineCache::load_validated() const
+{
+	if (m_Path.empty())
+		return {};
+
+	std::ifstream file(m_Path, std::ifstream::ate | std::ifstream::binary);
+	if (!file.is_open())
+	{
+		spdlog::info("No pipeline cache at {}, pipelines will be compiled cold", m_Path);
+		return {};
+	}
+
+	size_t fileSize = file.tellg();
+	std::vector<char> data(fileSize);
+	file.seekg(0);
+	file.read(data.data(), fileSize);
+	file.close();
+
+	VkPipelineCacheHeaderVersionOne header{};
+	if (fileSize < sizeof(header))
+	{
+		spdlog::warn("Discarding pipeline cache {}: file is truncated", m_Path);
+		return {};
+	}
+
+	memcpy(&header, data.data(), sizeof(header));
+
+	bool headerValid = header.headerSize >= sizeof(header)
+		&& header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE;
+	bool deviceMatches = header.vendorID == m_DeviceProperties.vendorID
+		&& header.deviceID == m_DeviceProperties.deviceID;
+	bool driverMatches = memcmp(header.pipelineCacheUUID, m_DeviceProperties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+
+	if (!headerValid || !deviceMatches || !driverMatches)
+	{
+		spdlog::warn("Discarding pipeline cache {}: {}", m_Path,
+			!headerValid ? "invalid header" : !deviceMatches ? "vendor/device mismatch" : "driver UUID mismatch");
+		return {};
+	}
+
+	spdlog::info("Loaded pipeline cache ({} bytes) from {}", fileSize, m_Path);
+	return data;
+}
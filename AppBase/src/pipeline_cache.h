@@ -0,0 +1,43 @@
+#ifndef PIPELINE_CACHE_H
+#define PIPELINE_CACHE_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+#include <vulkan/vulkan.hpp>
+
+// Disk-backed vk::PipelineCache. Cache data is loaded at startup if its header matches the
+// current device and driver, and written back on shutdown so later launches skip driver
+// compilation for pipelines that were already built.
+class PipelineCache
+{
+public:
+	// Create the cache, seeding it from path if valid. An empty path disables persistence.
+	void init(vk::PhysicalDevice physicalDevice, vk::Device device, const std::string& path);
+	// Save the cache to disk and destroy it.
+	void destroy();
+
+	void save();
+
+	// Record the result of a pipeline creation that used this cache.
+	void record(bool cacheHit, std::chrono::duration<double, std::milli> duration);
+	void log_stats() const;
+
+	vk::PipelineCache get() const { return m_Cache; }
+
+private:
+	vk::Device m_Device;
+	vk::PipelineCache m_Cache;
+	vk::PhysicalDeviceProperties m_DeviceProperties;
+	std::string m_Path;
+
+	std::atomic<uint32_t> m_Hits = 0, m_Misses = 0;
+	std::atomic<uint64_t> m_HitMicroseconds = 0, m_MissMicroseconds = 0;
+
+private:
+	std::vector<char> load_validated() const;
+};
+
+#endif
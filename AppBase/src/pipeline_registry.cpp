@@ -0,0 +1,243 @@
+#include <mutex>
+#include <cassert>
+#include <chrono>
+#include <exception>
+
+#include <spdlog/spdlog.h>
+#include "pipeline_registry.h"
+
+// Stores the device and cache used to build missing pipelines.
+void PipelineRegistry::init(vk::Device device, PipelineCache* pipelineCache, ThreadPool* threadPool, bool useLibraries)
+{
+	assert((threadPool || !useLibraries) && "Pipeline libraries need a thread pool for optimized links!");
+
+	m_Device = device;
+	m_PipelineCache = pipelineCache;
+	m_ThreadPool = threadPool;
+	m_UseLibraries = useLibraries;
+}
+
+// Waits for background builds, then destroys every registered pipeline and library.
+void PipelineRegistry::destroy()
+{
+	log_stats();
+	wait_pending();
+
+	std::unique_lock lock(m_Mutex);
+	m_Pending.clear();
+	m_Superseded.clear();
+	m_Pipelines.clear();
+
+	std::unique_lock libraryLock(m_LibraryMutex);
+	m_Libraries.clear();
+}
+
+// Looks the builder's key up under a shared lock and only builds on a miss. The build runs
+// outside the lock so concurrent requests for other pipelines are not serialized; if two
+// threads race on the same key, the first inserted pipeline wins.
+vk::Pipeline PipelineRegistry::get_or_create(const PipelineBuilder& builder)
+{
+	PipelineKey key = builder.key();
+
+	{
+		std::shared_lock lock(m_Mutex);
+		auto it = m_Pipelines.find(key);
+		if (it != m_Pipelines.end())
+		{
+			m_Hits++;
+			return it->second.pipeline.get();
+		}
+	}
+
+	bool linked = m_UseLibraries && builder.type() == PipelineType::Graphics;
+
+	Entry entry;
+	entry.builder = std::make_shared<const PipelineBuilder>(builder);
+
+	std::vector<vk::Pipeline> libraries;
+	if (linked)
+	{
+		for (vk::GraphicsPipelineLibraryFlagBitsEXT part : PipelineLibraryParts)
+			libraries.push_back(get_or_create_library(builder, part));
+		entry.pipeline = builder.link_libraries(m_Device, libraries, false, m_PipelineCache);
+	}
+	else
+	{
+		entry.pipeline = builder.build(m_Device, m_PipelineCache);
+	}
+	m_Misses++;
+
+	std::unique_lock lock(m_Mutex);
+	auto [it, inserted] = m_Pipelines.try_emplace(std::move(key), std::move(entry));
+
+	// Only the winning entry queues its optimized link. The task shares the entry's builder;
+	// the libraries stay alive until destroy(), which waits for it.
+	if (inserted && linked)
+	{
+		set_replacement(it->second, m_ThreadPool->submit([device = m_Device, builder = it->second.builder, libraries, cache = m_PipelineCache]()
+		{
+			return builder->link_libraries(device, libraries, true, cache);
+		}));
+	}
+
+	return it->second.pipeline.get();
+}
+
+// Rebuilds from a copy of each affected builder pointing at the new code and re-keys the
+// entry on that builder, as the key includes code hashes. Rebuilds are full builds through
+// the pipeline cache, so pipeline libraries are not needed for them.
+uint32_t PipelineRegistry::reload_shader(const ShaderEntry& shader)
+{
+	std::unique_lock lock(m_Mutex);
+
+	std::vector<std::pair<PipelineKey, std::shared_ptr<PipelineBuilder>>> updated;
+	for (const auto& [key, entry] : m_Pipelines)
+	{
+		if (!entry.builder->uses_shader(shader.path))
+			continue;
+
+		auto builder = std::make_shared<PipelineBuilder>(*entry.builder);
+		builder->update_shader(shader);
+		updated.emplace_back(key, std::move(builder));
+	}
+
+	uint32_t queued = 0;
+	for (auto& [oldKey, builder] : updated)
+	{
+		// Taken only if a stale builder created a second entry for the old code; that entry
+		// then stays as it is
+		PipelineKey newKey = builder->key();
+		if (newKey != oldKey && m_Pipelines.contains(newKey))
+			continue;
+
+		// Moving the node keeps the entry's address, which m_Pending may hold
+		auto node = m_Pipelines.extract(oldKey);
+		node.key() = std::move(newKey);
+		Entry& entry = m_Pipelines.insert(std::move(node)).position->second;
+
+		entry.builder = builder;
+		auto rebuild = [device = m_Device, builder = entry.builder, cache = m_PipelineCache]()
+		{
+			return builder->build(device, cache);
+		};
+
+		if (m_ThreadPool)
+		{
+			set_replacement(entry, m_ThreadPool->submit(std::move(rebuild)));
+		}
+		else
+		{
+			std::packaged_task<vk::UniquePipeline()> task(std::move(rebuild));
+			set_replacement(entry, task.get_future());
+			task();
+		}
+		queued++;
+	}
+
+	if (queued > 0)
+		spdlog::info("Rebuilding {} pipeline(s) using {}", queued, shader.path);
+	return queued;
+}
+
+// Swaps finished replacements in. A failed build keeps the current pipeline.
+void PipelineRegistry::update(DeletionQueue& deletionQueue, uint64_t frameNumber)
+{
+	std::unique_lock lock(m_Mutex);
+
+	std::erase_if(m_Pending, [&](Entry* entry)
+	{
+		if (entry->replacement.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return false;
+
+		try
+		{
+			vk::UniquePipeline replacement = entry->replacement.get();
+			deletionQueue.push(frameNumber, [device = m_Device, pipeline = entry->pipeline.release()]()
+			{
+				device.destroyPipeline(pipeline);
+			});
+			entry->pipeline = std::move(replacement);
+			m_Replaced++;
+		}
+		catch (const std::exception& e)
+		{
+			spdlog::warn("Background pipeline build failed, keeping the current pipeline: {}", e.what());
+		}
+
+		return true;
+	});
+
+	// Superseded builds are discarded once finished
+	std::erase_if(m_Superseded, [](const std::future<vk::UniquePipeline>& replacement)
+	{
+		return replacement.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	});
+}
+
+// A newer replacement wins over one still in flight, such as an optimized link of code that
+// has since been reloaded. The older one is kept until it finishes, as it may still be running.
+void PipelineRegistry::set_replacement(Entry& entry, std::future<vk::UniquePipeline>&& replacement)
+{
+	if (entry.replacement.valid())
+		m_Superseded.push_back(std::move(entry.replacement));
+	else
+		m_Pending.push_back(&entry);
+
+	entry.replacement = std::move(replacement);
+}
+
+// Returns the cached library for one section of the builder's state, building it on a miss.
+vk::Pipeline PipelineRegistry::get_or_create_library(const PipelineBuilder& builder, vk::GraphicsPipelineLibraryFlagBitsEXT part)
+{
+	PipelineKey key = builder.library_key(part);
+
+	{
+		std::shared_lock lock(m_LibraryMutex);
+		auto it = m_Libraries.find(key);
+		if (it != m_Libraries.end())
+		{
+			m_LibraryHits++;
+			return it->second.get();
+		}
+	}
+
+	vk::UniquePipeline library = builder.build_library(m_Device, part, m_PipelineCache);
+	m_LibraryMisses++;
+
+	std::unique_lock lock(m_LibraryMutex);
+	auto it = m_Libraries.try_emplace(std::move(key), std::move(library)).first;
+	return it->second.get();
+}
+
+// Blocks until every queued background build has finished, successfully or not.
+void PipelineRegistry::wait_pending()
+{
+	std::shared_lock lock(m_Mutex);
+	for (Entry* entry : m_Pending)
+		entry->replacement.wait();
+	for (const auto& replacement : m_Superseded)
+		replacement.wait();
+}
+
+// Returns the number of unique pipelines held.
+size_t PipelineRegistry::size() const
+{
+	std::shared_lock lock(m_Mutex);
+	return m_Pipelines.size();
+}
+
+// Logs how many requests were served from the registry, and from cached libraries.
+void PipelineRegistry::log_stats() const
+{
+	spdlog::info("Pipeline registry: {} unique pipeline(s), {} hit(s), {} miss(es)", size(), m_Hits.load(), m_Misses.load());
+
+	if (uses_libraries())
+	{
+		std::shared_lock lock(m_LibraryMutex);
+		spdlog::info("Pipeline libraries: {} librar{}, {} hit(s), {} miss(es)",
+			m_Libraries.size(), m_Libraries.size() == 1 ? "y" : "ies", m_LibraryHits.load(), m_LibraryMisses.load());
+	}
+
+	if (m_Replaced > 0)
+		spdlog::info("Pipeline registry: {} pipeline(s) replaced by background builds", m_Replaced.load());
+}
@@ -0,0 +1,83 @@
+#ifndef PIPELINE_REGISTRY_H
+#define PIPELINE_REGISTRY_H
+
+#include <unordered_map>
+#include <shared_mutex>
+#include <atomic>
+#include <future>
+
+#include <vulkan/vulkan.hpp>
+#include "pipeline_builder.h"
+#include "pipeline_cache.h"
+#include "thread_pool.h"
+#include "deletion_queue.h"
+
+// Deduplicating pipeline store. Pipelines are keyed on the full PipelineBuilder state, so
+// requesting an identical configuration twice returns the existing pipeline instead of
+// creating shader modules and a new vk::Pipeline. Pipelines are owned by the registry and
+// live until destroy().
+//
+// With pipeline libraries, graphics pipelines are assembled from libraries instead: each
+// section of the state is compiled once and cached, a first request fast-links the sections
+// (no hitch for a new material/vertex layout combination mid-frame), and an optimized link
+// runs on the thread pool. Pipelines rebuilt after a shader reload are built there too.
+// update() swaps replacements in, so callers should request pipelines every frame rather
+// than keep the handle. A reload moves each affected entry to the key of its updated
+// builder, which is what builders created from the shader library afterwards produce, so
+// they find the entry at once and get its current pipeline until the rebuild lands.
+class PipelineRegistry
+{
+public:
+	// Libraries and background rebuilds need the thread pool; without one, shader reloads
+	// rebuild on the calling thread. Libraries require VK_EXT_graphics_pipeline_library.
+	void init(vk::Device device, PipelineCache* pipelineCache, ThreadPool* threadPool = nullptr, bool useLibraries = false);
+	void destroy();
+
+	// Return the pipeline matching the builder's state, building it on first request.
+	vk::Pipeline get_or_create(const PipelineBuilder& builder);
+
+	// Queue a rebuild of every pipeline with a stage loaded from the reloaded shader's file.
+	// Returns the number of pipelines queued.
+	uint32_t reload_shader(const ShaderEntry& entry);
+
+	// Swap in replacements that have finished: optimized links and rebuilds. Call at a frame
+	// boundary; the replaced pipelines are destroyed once frameNumber has completed.
+	void update(DeletionQueue& deletionQueue, uint64_t frameNumber);
+
+	bool uses_libraries() const { return m_UseLibraries; }
+	size_t size() const;
+	void log_stats() const;
+
+private:
+	struct Entry
+	{
+		vk::UniquePipeline pipeline;
+		std::shared_ptr<const PipelineBuilder> builder;	// Builder state the pipeline was created from
+		std::future<vk::UniquePipeline> replacement;	// Pending optimized link or rebuild
+	};
+
+	vk::Device m_Device;
+	PipelineCache* m_PipelineCache = nullptr;
+	ThreadPool* m_ThreadPool = nullptr;
+	bool m_UseLibraries = false;
+
+	std::unordered_map<PipelineKey, Entry, PipelineKeyHash> m_Pipelines;
+	std::vector<Entry*> m_Pending;		// Entries with a replacement in flight; nodes are stable
+	std::vector<std::future<vk::UniquePipeline>> m_Superseded;	// Replacements overtaken by a newer one
+	mutable std::shared_mutex m_Mutex;
+
+	// Section libraries keyed on PipelineBuilder::library_key
+	std::unordered_map<PipelineKey, vk::UniquePipeline, PipelineKeyHash> m_Libraries;
+	mutable std::shared_mutex m_LibraryMutex;
+
+	std::atomic<uint32_t> m_Hits = 0, m_Misses = 0;
+	std::atomic<uint32_t> m_LibraryHits = 0, m_LibraryMisses = 0, m_Replaced = 0;
+
+private:
+	vk::Pipeline get_or_create_library(const PipelineBuilder& builder, vk::GraphicsPipelineLibraryFlagBitsEXT part);
+	// Hands a replacement to update(). Requires the unique lock.
+	void set_replacement(Entry& entry, std::future<vk::UniquePipeline>&& replacement);
+	void wait_pending();
+};
+
+#endif
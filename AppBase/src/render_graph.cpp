@@ -0,0 +1,761 @@
+#include "render_graph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+namespace
+{
+	constexpr vk::AccessFlags2 WriteAccess =
+		vk::AccessFlagBits2::eShaderWrite | vk::AccessFlagBits2::eShaderStorageWrite |
+		vk::AccessFlagBits2::eColorAttachmentWrite | vk::AccessFlagBits2::eDepthStencilAttachmentWrite |
+		vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eHostWrite | vk::AccessFlagBits2::eMemoryWrite;
+
+	// Aspects covered by barriers and views of an image of the given format.
+	vk::ImageAspectFlags aspect_for_format(vk::Format format)
+	{
+		switch (format)
+		{
+		case vk::Format::eD16Unorm:
+		case vk::Format::eX8D24UnormPack32:
+		case vk::Format::eD32Sfloat:
+			return vk::ImageAspectFlagBits::eDepth;
+		case vk::Format::eD16UnormS8Uint:
+		case vk::Format::eD24UnormS8Uint:
+		case vk::Format::eD32SfloatS8Uint:
+			return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+		case vk::Format::eS8Uint:
+			return vk::ImageAspectFlagBits::eStencil;
+		default:
+			return vk::ImageAspectFlagBits::eColor;
+		}
+	}
+
+	bool is_depth_layout(vk::ImageLayout layout)
+	{
+		return layout == vk::ImageLayout::eDepthAttachmentOptimal || layout == vk::ImageLayout::eDepthReadOnlyOptimal ||
+			layout == vk::ImageLayout::eDepthStencilAttachmentOptimal || layout == vk::ImageLayout::eDepthStencilReadOnlyOptimal ||
+			layout == vk::ImageLayout::eStencilAttachmentOptimal || layout == vk::ImageLayout::eStencilReadOnlyOptimal;
+	}
+
+	// Depth-only layouts apply to the depth aspect alone; images with a stencil aspect use the
+	// layout covering the aspects they have.
+	vk::ImageLayout layout_for_aspects(vk::ImageLayout layout, vk::ImageAspectFlags aspects)
+	{
+		if (!(aspects & vk::ImageAspectFlagBits::eStencil))
+			return layout;
+
+		bool depth = static_cast<bool>(aspects & vk::ImageAspectFlagBits::eDepth);
+		if (layout == vk::ImageLayout::eDepthAttachmentOptimal)
+			return depth ? vk::ImageLayout::eDepthStencilAttachmentOptimal : vk::ImageLayout::eStencilAttachmentOptimal;
+		if (layout == vk::ImageLayout::eDepthReadOnlyOptimal)
+			return depth ? vk::ImageLayout::eDepthStencilReadOnlyOptimal : vk::ImageLayout::eStencilReadOnlyOptimal;
+		return layout;
+	}
+}
+
+// Returns true if the usage writes the resource.
+bool ResourceUsage::writes() const
+{
+	return static_cast<bool>(access & WriteAccess);
+}
+
+// Declares a read of the resource by this pass.
+RenderGraphPass& RenderGraphPass::read(RenderGraphResource resource, const ResourceUsage& usage)
+{
+	access(resource.index, usage, false);
+	return *this;
+}
+
+// Declares a write of the resource by this pass.
+RenderGraphPass& RenderGraphPass::write(RenderGraphResource resource, const ResourceUsage& usage)
+{
+	access(resource.index, usage, true);
+	return *this;
+}
+
+// Clears an attachment already declared as written by this pass when rendering begins.
+RenderGraphPass& RenderGraphPass::clear(RenderGraphResource resource, const vk::ClearValue& value)
+{
+	auto it = std::find_if(m_Accesses.begin(), m_Accesses.end(), [&](const ResourceAccess& access) { return access.resource == resource.index; });
+	if (it == m_Accesses.end() || !it->write)
+	{
+		spdlog::error("Render graph pass '{}' clears a resource it does not write", m_Name);
+		throw std::runtime_error("Cleared render graph resource not written by the pass");
+	}
+
+	it->clearValue = value;
+	return *this;
+}
+
+// Keeps the pass through culling.
+RenderGraphPass& RenderGraphPass::set_side_effects()
+{
+	m_SideEffects = true;
+	return *this;
+}
+
+// Adds an access, merging it with an earlier access to the same resource. A resource used in
+// two layouts by one pass falls back to eGeneral.
+RenderGraphPass::ResourceAccess& RenderGraphPass::access(uint32_t resource, const ResourceUsage& usage, bool write)
+{
+	for (ResourceAccess& existing : m_Accesses)
+	{
+		if (existing.resource != resource)
+			continue;
+
+		if (existing.usage.layout != usage.layout)
+			existing.usage.layout = vk::ImageLayout::eGeneral;
+		existing.usage.stages |= usage.stages;
+		existing.usage.access |= usage.access;
+		existing.usage.imageUsage |= usage.imageUsage;
+		existing.usage.bufferUsage |= usage.bufferUsage;
+		existing.write = existing.write || write;
+		return existing;
+	}
+
+	ResourceAccess& added = m_Accesses.emplace_back();
+	added.resource = resource;
+	added.usage = usage;
+	added.write = write;
+	return added;
+}
+
+// Stores the device and the allocator transient resources are placed in.
+void RenderGraph::init(vk::Device device, GpuAllocator& allocator)
+{
+	m_Device = device;
+	m_Allocator = &allocator;
+}
+
+// Destroys the transient resources. The GPU must no longer be using them.
+void RenderGraph::destroy()
+{
+	if (!m_Device)
+		return;
+
+	reset();
+	m_Device = nullptr;
+	m_Allocator = nullptr;
+}
+
+// Clears the graph so it can be declared again, e.g. after a swapchain resize.
+void RenderGraph::reset()
+{
+	destroy_transient_resources();
+	m_Resources.clear();
+	m_Passes.clear();
+	m_FinalImageBarriers.clear();
+	m_FinalBufferBarriers.clear();
+	m_FinalImageBarrierResources.clear();
+	m_FinalBufferBarrierResources.clear();
+	m_Compiled = false;
+}
+
+// Declares an image owned outside the graph.
+RenderGraphResource RenderGraph::import_image(const std::string& name, vk::Image image, vk::ImageView view, vk::Format format, vk::Extent2D extent,
+	const ResourceUsage& initialUsage, const ResourceUsage& finalUsage)
+{
+	Resource& resource = m_Resources.emplace_back();
+	resource.name = name;
+	resource.imported = true;
+	resource.format = format;
+	resource.extent = extent;
+	resource.initialUsage = initialUsage;
+	resource.finalUsage = finalUsage;
+	resource.initialUsage.layout = layout_for_aspects(initialUsage.layout, aspect_for_format(format));
+	resource.finalUsage.layout = layout_for_aspects(finalUsage.layout, aspect_for_format(format));
+	resource.image = image;
+	resource.view = view;
+
+	m_Compiled = false;
+	return RenderGraphResource{ static_cast<uint32_t>(m_Resources.size() - 1) };
+}
+
+// Declares a buffer owned outside the graph.
+RenderGraphResource RenderGraph::import_buffer(const std::string& name, vk::Buffer buffer, const ResourceUsage& initialUsage, const ResourceUsage& finalUsage)
+{
+	Resource& resource = m_Resources.emplace_back();
+	resource.name = name;
+	resource.isImage = false;
+	resource.imported = true;
+	resource.initialUsage = initialUsage;
+	resource.finalUsage = finalUsage;
+	resource.buffer = buffer;
+
+	m_Compiled = false;
+	return RenderGraphResource{ static_cast<uint32_t>(m_Resources.size() - 1) };
+}
+
+// Rebinds an imported image. The new image must match the imported format and extent.
+void RenderGraph::set_imported_image(RenderGraphResource resource, vk::Image image, vk::ImageView view)
+{
+	assert(m_Resources[resource.index].imported && m_Resources[resource.index].isImage && "Not an imported image!");
+
+	m_Resources[resource.index].image = image;
+	m_Resources[resource.index].view = view;
+}
+
+// Rebinds an imported buffer.
+void RenderGraph::set_imported_buffer(RenderGraphResource resource, vk::Buffer buffer)
+{
+	assert(m_Resources[resource.index].imported && !m_Resources[resource.index].isImage && "Not an imported buffer!");
+
+	m_Resources[resource.index].buffer = buffer;
+}
+
+// Declares an image created by the graph at compile time. Its contents do not persist
+// between executions.
+RenderGraphResource RenderGraph::create_image(const std::string& name, const TransientImageDesc& desc)
+{
+	Resource& resource = m_Resources.emplace_back();
+	resource.name = name;
+	resource.format = desc.format;
+	resource.extent = desc.extent;
+	resource.samples = desc.samples;
+	resource.imageUsage = desc.usage;
+
+	m_Compiled = false;
+	return RenderGraphResource{ static_cast<uint32_t>(m_Resources.size() - 1) };
+}
+
+// Declares a buffer created by the graph at compile time.
+RenderGraphResource RenderGraph::create_buffer(const std::string& name, const TransientBufferDesc& desc)
+{
+	Resource& resource = m_Resources.emplace_back();
+	resource.name = name;
+	resource.isImage = false;
+	resource.size = desc.size;
+	resource.bufferUsage = desc.usage;
+
+	m_Compiled = false;
+	return RenderGraphResource{ static_cast<uint32_t>(m_Resources.size() - 1) };
+}
+
+// Appends a pass, executed after every pass added before it.
+RenderGraphPass& RenderGraph::add_pass(const std::string& name, RenderGraphPass::ExecuteFunction&& execute)
+{
+	RenderGraphPass& pass = m_Passes.emplace_back();
+	pass.m_Name = name;
+	pass.m_Execute = std::move(execute);
+
+	m_Compiled = false;
+	return pass;
+}
+
+// Keeps the passes producing the resource through culling and its memory out of aliasing.
+void RenderGraph::mark_output(RenderGraphResource resource)
+{
+	m_Resources[resource.index].output = true;
+	m_Compiled = false;
+}
+
+// Culls unused passes, creates and aliases the transient resources and derives the barriers.
+// Recompiling recreates the transient resources, so the GPU must no longer be using them.
+void RenderGraph::compile()
+{
+	destroy_transient_resources();
+
+	cull_passes();
+	compute_lifetimes();
+	create_transient_resources();
+	build_barriers();
+	m_Compiled = true;
+
+	size_t livePasses = std::count_if(m_Passes.begin(), m_Passes.end(), [](const RenderGraphPass& pass) { return !pass.m_Culled; });
+	spdlog::info("Render graph compiled: {} of {} passes, {} memory slots for transient images ({} KiB, {} KiB without aliasing)",
+		livePasses, m_Passes.size(), m_MemorySlots.size(), m_TransientMemory / 1024, m_UnaliasedTransientMemory / 1024);
+}
+
+// Records every live pass with the barriers it needs, then returns imported resources to
+// their final usage.
+void RenderGraph::execute(vk::CommandBuffer commandBuffer) const
+{
+	assert(m_Compiled && "Render graph must be compiled before execution!");
+
+	for (const RenderGraphPass& pass : m_Passes)
+	{
+		if (pass.m_Culled)
+			continue;
+
+		record_barriers(commandBuffer, pass.m_ImageBarriers, pass.m_ImageBarrierResources, pass.m_BufferBarriers, pass.m_BufferBarrierResources);
+
+		bool rendering = begin_rendering(commandBuffer, pass);
+		if (pass.m_Execute)
+			pass.m_Execute(commandBuffer, *this);
+		if (rendering)
+			commandBuffer.endRendering();
+	}
+
+	record_barriers(commandBuffer, m_FinalImageBarriers, m_FinalImageBarrierResources, m_FinalBufferBarriers, m_FinalBufferBarrierResources);
+}
+
+// Walks the passes backwards from the graph's outputs. A pass survives if it has side effects
+// or writes a resource that is needed; the resources it reads, and those it writes without
+// overwriting them completely, are then needed as well.
+void RenderGraph::cull_passes()
+{
+	std::vector<bool> needed(m_Resources.size());
+	for (size_t i = 0; i < m_Resources.size(); i++)
+		needed[i] = m_Resources[i].imported || m_Resources[i].output;
+
+	for (auto pass = m_Passes.rbegin(); pass != m_Passes.rend(); ++pass)
+	{
+		pass->m_Culled = !pass->m_SideEffects && std::none_of(pass->m_Accesses.begin(), pass->m_Accesses.end(),
+			[&](const RenderGraphPass::ResourceAccess& access) { return access.write && needed[access.resource]; });
+
+		if (pass->m_Culled)
+		{
+			spdlog::debug("Render graph: culled pass '{}'", pass->m_Name);
+			continue;
+		}
+
+		for (const RenderGraphPass::ResourceAccess& access : pass->m_Accesses)
+		{
+			bool readsContents = !access.write || ((access.usage.access & ~WriteAccess) && !access.clearValue);
+			if (readsContents)
+				needed[access.resource] = true;
+		}
+	}
+}
+
+// Finds the first and last live pass using each resource and gathers the usage flags
+// transient resources are created with.
+void RenderGraph::compute_lifetimes()
+{
+	for (Resource& resource : m_Resources)
+	{
+		resource.firstPass = UINT32_MAX;
+		resource.lastPass = 0;
+	}
+
+	for (uint32_t i = 0; i < m_Passes.size(); i++)
+	{
+		if (m_Passes[i].m_Culled)
+			continue;
+
+		for (const RenderGraphPass::ResourceAccess& access : m_Passes[i].m_Accesses)
+		{
+			Resource& resource = m_Resources[access.resource];
+			resource.firstPass = std::min(resource.firstPass, i);
+			resource.lastPass = std::max(resource.lastPass, i);
+			resource.imageUsage |= access.usage.imageUsage;
+			resource.bufferUsage |= access.usage.bufferUsage;
+		}
+	}
+}
+
+// Creates the transient resources used by live passes. Images are placed largest first into
+// memory slots: an image shares a slot with images whose lifetimes don't overlap its own, so
+// the graph needs only as much memory as its peak set of simultaneously live images.
+void RenderGraph::create_transient_resources()
+{
+	struct Candidate
+	{
+		uint32_t resource;
+		vk::MemoryRequirements requirements;
+	};
+	struct SlotRequirements
+	{
+		vk::MemoryRequirements requirements;
+		bool exclusive = false;
+	};
+
+	std::vector<Candidate> candidates;
+	for (uint32_t i = 0; i < m_Resources.size(); i++)
+	{
+		Resource& resource = m_Resources[i];
+		if (resource.imported || resource.firstPass == UINT32_MAX)
+			continue;
+
+		if (!resource.isImage)
+		{
+			resource.buffer = m_Device.createBuffer(vk::BufferCreateInfo({}, resource.size, resource.bufferUsage, vk::SharingMode::eExclusive));
+			vk::MemoryRequirements requirements = m_Device.getBufferMemoryRequirements(resource.buffer);
+			resource.bufferAllocation = m_Allocator->allocate(requirements, m_Allocator->find_memory_type(requirements.memoryTypeBits, MemoryUsage::GpuOnly));
+			m_Device.bindBufferMemory(resource.buffer, resource.bufferAllocation.memory, resource.bufferAllocation.offset);
+			continue;
+		}
+
+		vk::ImageCreateInfo imageInfo{};
+		imageInfo.imageType = vk::ImageType::e2D;
+		imageInfo.format = resource.format;
+		imageInfo.extent = vk::Extent3D(resource.extent, 1);
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = resource.samples;
+		imageInfo.tiling = vk::ImageTiling::eOptimal;
+		imageInfo.usage = resource.imageUsage;
+		imageInfo.sharingMode = vk::SharingMode::eExclusive;
+		imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+		resource.image = m_Device.createImage(imageInfo);
+
+		candidates.push_back({ i, m_Device.getImageMemoryRequirements(resource.image) });
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.requirements.size > b.requirements.size; });
+
+	// Outputs are read after the graph has run, so they never share their memory
+	std::vector<SlotRequirements> slotRequirements;
+	for (const Candidate& candidate : candidates)
+	{
+		Resource& resource = m_Resources[candidate.resource];
+		m_UnaliasedTransientMemory += candidate.requirements.size;
+
+		uint32_t slotIndex = UINT32_MAX;
+		for (uint32_t s = 0; s < m_MemorySlots.size() && !resource.output; s++)
+		{
+			const SlotRequirements& slot = slotRequirements[s];
+			if (slot.exclusive || !(slot.requirements.memoryTypeBits & candidate.requirements.memoryTypeBits))
+				continue;
+
+			bool overlaps = std::any_of(m_MemorySlots[s].resources.begin(), m_MemorySlots[s].resources.end(), [&](uint32_t other) {
+				return resource.firstPass <= m_Resources[other].lastPass && m_Resources[other].firstPass <= resource.lastPass;
+			});
+			if (!overlaps)
+			{
+				slotIndex = s;
+				break;
+			}
+		}
+
+		if (slotIndex == UINT32_MAX)
+		{
+			slotIndex = static_cast<uint32_t>(m_MemorySlots.size());
+			m_MemorySlots.emplace_back();
+			slotRequirements.push_back({ candidate.requirements, resource.output });
+		}
+		else
+		{
+			// Alignments are powers of two, so the larger one satisfies both
+			vk::MemoryRequirements& requirements = slotRequirements[slotIndex].requirements;
+			requirements.alignment = std::max(requirements.alignment, candidate.requirements.alignment);
+			requirements.memoryTypeBits &= candidate.requirements.memoryTypeBits;
+		}
+
+		m_MemorySlots[slotIndex].resources.push_back(candidate.resource);
+		resource.memorySlot = slotIndex;
+	}
+
+	for (uint32_t s = 0; s < m_MemorySlots.size(); s++)
+	{
+		MemorySlot& slot = m_MemorySlots[s];
+		const vk::MemoryRequirements& requirements = slotRequirements[s].requirements;
+
+		uint32_t memoryType = m_Allocator->find_memory_type(requirements.memoryTypeBits, MemoryUsage::GpuOnly);
+		if (memoryType == UINT32_MAX)
+		{
+			spdlog::error("Render graph: no memory type for transient image '{}'", m_Resources[slot.resources.front()].name);
+			throw std::runtime_error("No memory type for render graph transient images");
+		}
+
+		slot.allocation = m_Allocator->allocate(requirements, memoryType, AllocationKind::Optimal);
+		m_TransientMemory += requirements.size;
+
+		std::sort(slot.resources.begin(), slot.resources.end(), [&](uint32_t a, uint32_t b) { return m_Resources[a].firstPass < m_Resources[b].firstPass; });
+
+		for (uint32_t index : slot.resources)
+		{
+			Resource& resource = m_Resources[index];
+			m_Device.bindImageMemory(resource.image, slot.allocation.memory, slot.allocation.offset);
+
+			vk::ImageViewCreateInfo viewInfo({}, resource.image, vk::ImageViewType::e2D, resource.format, {},
+				vk::ImageSubresourceRange(aspect_for_format(resource.format), 0, 1, 0, 1));
+			resource.view = m_Device.createImageView(viewInfo);
+		}
+	}
+}
+
+// Destroys the transient resources and frees their memory.
+void RenderGraph::destroy_transient_resources()
+{
+	for (Resource& resource : m_Resources)
+	{
+		if (resource.imported)
+			continue;
+
+		if (resource.view)
+			m_Device.destroyImageView(resource.view);
+		if (resource.image)
+			m_Device.destroyImage(resource.image);
+		if (resource.buffer)
+			m_Device.destroyBuffer(resource.buffer);
+		if (resource.bufferAllocation)
+			m_Allocator->free(resource.bufferAllocation);
+
+		resource.view = nullptr;
+		resource.image = nullptr;
+		resource.buffer = nullptr;
+		resource.bufferAllocation = {};
+		resource.memorySlot = UINT32_MAX;
+	}
+
+	for (MemorySlot& slot : m_MemorySlots)
+		m_Allocator->free(slot.allocation);
+
+	m_MemorySlots.clear();
+	m_TransientMemory = 0;
+	m_UnaliasedTransientMemory = 0;
+}
+
+// Replays the live passes' accesses against each resource's last known state and emits a
+// barrier wherever a write follows any access, a read follows a write it has not yet been
+// synchronized with, or the layout changes. Barriers of one pass are batched into a single
+// vkCmdPipelineBarrier2. A transient image starts out waiting on the last use of the memory
+// it occupies, which for the first image of a slot is the slot's last use in the previous
+// execution.
+void RenderGraph::build_barriers()
+{
+	std::vector<ResourceState> states(m_Resources.size());
+
+	// The merged usage of a resource in its last live pass
+	auto lastUsage = [&](uint32_t index) {
+		for (const RenderGraphPass::ResourceAccess& access : m_Passes[m_Resources[index].lastPass].m_Accesses)
+		{
+			if (access.resource == index)
+				return access.usage;
+		}
+		return ResourceUsage{};
+	};
+
+	auto setPrevious = [](ResourceState& state, const ResourceUsage& usage) {
+		if (usage.writes())
+		{
+			state.writeStages = usage.stages;
+			state.writeAccess = usage.access & WriteAccess;
+		}
+		else
+		{
+			state.readStages = usage.stages;
+			state.readAccess = usage.access;
+		}
+	};
+
+	for (uint32_t i = 0; i < m_Resources.size(); i++)
+	{
+		const Resource& resource = m_Resources[i];
+		if (resource.imported)
+		{
+			states[i].layout = resource.initialUsage.layout;
+			setPrevious(states[i], resource.initialUsage);
+		}
+		else if (resource.firstPass != UINT32_MAX)
+		{
+			uint32_t previous = i;
+			if (resource.isImage)
+			{
+				const std::vector<uint32_t>& occupants = m_MemorySlots[resource.memorySlot].resources;
+				auto it = std::find(occupants.begin(), occupants.end(), i);
+				previous = it == occupants.begin() ? occupants.back() : *(it - 1);
+			}
+
+			// Memory reuse is ordered as a write-after-write, whatever the previous use was
+			ResourceUsage usage = lastUsage(previous);
+			states[i].writeStages = usage.stages;
+			states[i].writeAccess = usage.access & WriteAccess;
+		}
+	}
+
+	// Returns the barrier needed before the usage, and updates the state past it
+	auto transition = [&](uint32_t index, const ResourceUsage& usage, bool write,
+		vk::PipelineStageFlags2& srcStages, vk::AccessFlags2& srcAccess, vk::ImageLayout& oldLayout) {
+		ResourceState& state = states[index];
+		bool layoutChange = m_Resources[index].isImage && state.layout != usage.layout;
+		bool needed = false;
+
+		oldLayout = state.layout;
+		if (write || layoutChange)
+		{
+			// Write-after-write and write-after-read; layout transitions count as writes
+			srcStages = state.writeStages | state.readStages;
+			srcAccess = state.writeAccess;
+			needed = layoutChange || srcStages;
+
+			state.writeStages = usage.stages;
+			state.writeAccess = write ? usage.access & WriteAccess : vk::AccessFlags2{};
+			state.readStages = write ? vk::PipelineStageFlags2{} : usage.stages;
+			state.readAccess = write ? vk::AccessFlags2{} : usage.access;
+		}
+		else
+		{
+			// Read-after-write, unless an earlier read already synchronized these stages
+			vk::PipelineStageFlags2 missingStages = usage.stages & ~state.readStages;
+			vk::AccessFlags2 missingAccess = usage.access & ~state.readAccess;
+			srcStages = state.writeStages;
+			srcAccess = state.writeAccess;
+			needed = state.writeStages && (missingStages || missingAccess);
+
+			state.readStages |= usage.stages;
+			state.readAccess |= usage.access;
+		}
+
+		state.layout = usage.layout;
+		return needed;
+	};
+
+	auto addBarrier = [&](uint32_t index, const ResourceUsage& usage, vk::PipelineStageFlags2 srcStages, vk::AccessFlags2 srcAccess, vk::ImageLayout oldLayout,
+		std::vector<vk::ImageMemoryBarrier2>& imageBarriers, std::vector<uint32_t>& imageResources,
+		std::vector<vk::BufferMemoryBarrier2>& bufferBarriers, std::vector<uint32_t>& bufferResources) {
+		const Resource& resource = m_Resources[index];
+		if (resource.isImage)
+		{
+			imageBarriers.emplace_back(
+				srcStages, srcAccess, usage.stages, usage.access,
+				oldLayout, usage.layout,
+				VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+				resource.image,
+				vk::ImageSubresourceRange(aspect_for_format(resource.format), 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS)
+			);
+			imageResources.push_back(index);
+		}
+		else
+		{
+			bufferBarriers.emplace_back(
+				srcStages, srcAccess, usage.stages, usage.access,
+				VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+				resource.buffer, 0, VK_WHOLE_SIZE
+			);
+			bufferResources.push_back(index);
+		}
+	};
+
+	for (uint32_t p = 0; p < m_Passes.size(); p++)
+	{
+		RenderGraphPass& pass = m_Passes[p];
+		pass.m_ImageBarriers.clear();
+		pass.m_BufferBarriers.clear();
+		pass.m_ImageBarrierResources.clear();
+		pass.m_BufferBarrierResources.clear();
+
+		if (pass.m_Culled)
+			continue;
+
+		for (RenderGraphPass::ResourceAccess& access : pass.m_Accesses)
+		{
+			const Resource& resource = m_Resources[access.resource];
+			if (resource.isImage)
+				access.usage.layout = layout_for_aspects(access.usage.layout, aspect_for_format(resource.format));
+
+			vk::PipelineStageFlags2 srcStages;
+			vk::AccessFlags2 srcAccess;
+			vk::ImageLayout oldLayout;
+			if (transition(access.resource, access.usage, access.write, srcStages, srcAccess, oldLayout))
+			{
+				addBarrier(access.resource, access.usage, srcStages, srcAccess, oldLayout,
+					pass.m_ImageBarriers, pass.m_ImageBarrierResources, pass.m_BufferBarriers, pass.m_BufferBarrierResources);
+			}
+
+			// Contents that were never defined or are never read again need not touch memory
+			if (access.clearValue)
+				access.loadOp = vk::AttachmentLoadOp::eClear;
+			else
+				access.loadOp = oldLayout == vk::ImageLayout::eUndefined ? vk::AttachmentLoadOp::eDontCare : vk::AttachmentLoadOp::eLoad;
+
+			bool discard = !resource.imported && !resource.output && resource.lastPass == p;
+			access.storeOp = discard ? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore;
+		}
+	}
+
+	m_FinalImageBarriers.clear();
+	m_FinalBufferBarriers.clear();
+	m_FinalImageBarrierResources.clear();
+	m_FinalBufferBarrierResources.clear();
+
+	for (uint32_t i = 0; i < m_Resources.size(); i++)
+	{
+		const Resource& resource = m_Resources[i];
+		if (!resource.imported)
+			continue;
+
+		vk::PipelineStageFlags2 srcStages;
+		vk::AccessFlags2 srcAccess;
+		vk::ImageLayout oldLayout;
+		if (transition(i, resource.finalUsage, resource.finalUsage.writes(), srcStages, srcAccess, oldLayout))
+		{
+			addBarrier(i, resource.finalUsage, srcStages, srcAccess, oldLayout,
+				m_FinalImageBarriers, m_FinalImageBarrierResources, m_FinalBufferBarriers, m_FinalBufferBarrierResources);
+		}
+	}
+}
+
+// Records one batched barrier, patching in the current handles of imported resources.
+void RenderGraph::record_barriers(vk::CommandBuffer commandBuffer,
+	const std::vector<vk::ImageMemoryBarrier2>& imageBarriers, const std::vector<uint32_t>& imageResources,
+	const std::vector<vk::BufferMemoryBarrier2>& bufferBarriers, const std::vector<uint32_t>& bufferResources) const
+{
+	if (imageBarriers.empty() && bufferBarriers.empty())
+		return;
+
+	std::vector<vk::ImageMemoryBarrier2> images = imageBarriers;
+	for (size_t i = 0; i < images.size(); i++)
+		images[i].image = m_Resources[imageResources[i]].image;
+
+	std::vector<vk::BufferMemoryBarrier2> buffers = bufferBarriers;
+	for (size_t i = 0; i < buffers.size(); i++)
+		buffers[i].buffer = m_Resources[bufferResources[i]].buffer;
+
+	vk::DependencyInfo dependencyInfo{};
+	dependencyInfo.setImageMemoryBarriers(images);
+	dependencyInfo.setBufferMemoryBarriers(buffers);
+	commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+// Begins dynamic rendering over the pass's color and depth attachments, in declaration
+// order. Returns false if the pass has no attachments.
+bool RenderGraph::begin_rendering(vk::CommandBuffer commandBuffer, const RenderGraphPass& pass) const
+{
+	std::vector<vk::RenderingAttachmentInfo> colorAttachments;
+	vk::RenderingAttachmentInfo depthAttachment{};
+	vk::Format depthFormat = vk::Format::eUndefined;
+	vk::Extent2D extent;
+
+	for (const RenderGraphPass::ResourceAccess& access : pass.m_Accesses)
+	{
+		const Resource& resource = m_Resources[access.resource];
+		bool color = access.usage.layout == vk::ImageLayout::eColorAttachmentOptimal;
+		bool depth = is_depth_layout(access.usage.layout);
+		if (!resource.isImage || (!color && !depth))
+			continue;
+
+		vk::RenderingAttachmentInfo attachment{};
+		attachment.imageView = resource.view;
+		attachment.imageLayout = access.usage.layout;
+		attachment.loadOp = access.loadOp;
+		attachment.storeOp = access.storeOp;
+		if (access.clearValue)
+			attachment.clearValue = *access.clearValue;
+
+		if (color)
+		{
+			colorAttachments.push_back(attachment);
+		}
+		else
+		{
+			depthAttachment = attachment;
+			depthFormat = resource.format;
+		}
+
+		if (extent.width == 0)
+			extent = resource.extent;
+	}
+
+	if (colorAttachments.empty() && depthFormat == vk::Format::eUndefined)
+		return false;
+
+	vk::ImageAspectFlags depthAspects = aspect_for_format(depthFormat);
+
+	vk::RenderingInfo renderingInfo{};
+	renderingInfo.renderArea = vk::Rect2D({ 0, 0 }, extent);
+	renderingInfo.layerCount = 1;
+	renderingInfo.setColorAttachments(colorAttachments);
+	if (depthFormat != vk::Format::eUndefined)
+	{
+		renderingInfo.pDepthAttachment = depthAspects & vk::ImageAspectFlagBits::eDepth ? &depthAttachment : nullptr;
+		renderingInfo.pStencilAttachment = depthAspects & vk::ImageAspectFlagBits::eStencil ? &depthAttachment : nullptr;
+	}
+
+	commandBuffer.beginRendering(renderingInfo);
+	return true;
+}
@@ -0,0 +1,245 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <optional>
+
+#include <vulkan/vulkan.hpp>
+#include "gpu_allocator.h"
+
+// How a pass uses a resource: the synchronization scope, the image layout, and the usage
+// flags a transient resource is created with to allow it.
+struct ResourceUsage
+{
+	vk::PipelineStageFlags2 stages;
+	vk::AccessFlags2 access;
+	vk::ImageLayout layout = vk::ImageLayout::eUndefined;	// Ignored for buffers
+	vk::ImageUsageFlags imageUsage;
+	vk::BufferUsageFlags bufferUsage;
+
+	bool writes() const;
+};
+
+// Common resource usages. The depth attachment usages take the combined depth/stencil (or
+// stencil-only) layouts for images whose format has a stencil aspect.
+namespace Access
+{
+	using Stage = vk::PipelineStageFlagBits2;
+	using Flag = vk::AccessFlagBits2;
+	using Layout = vk::ImageLayout;
+	using Image = vk::ImageUsageFlagBits;
+	using Buffer = vk::BufferUsageFlagBits;
+
+	inline const ResourceUsage ColorAttachmentWrite{ Stage::eColorAttachmentOutput, Flag::eColorAttachmentRead | Flag::eColorAttachmentWrite, Layout::eColorAttachmentOptimal, Image::eColorAttachment, {} };
+	inline const ResourceUsage DepthAttachmentWrite{ Stage::eEarlyFragmentTests | Stage::eLateFragmentTests, Flag::eDepthStencilAttachmentRead | Flag::eDepthStencilAttachmentWrite, Layout::eDepthAttachmentOptimal, Image::eDepthStencilAttachment, {} };
+	inline const ResourceUsage DepthAttachmentRead{ Stage::eEarlyFragmentTests | Stage::eLateFragmentTests, Flag::eDepthStencilAttachmentRead, Layout::eDepthReadOnlyOptimal, Image::eDepthStencilAttachment, {} };
+	inline const ResourceUsage FragmentSampled{ Stage::eFragmentShader, Flag::eShaderSampledRead, Layout::eShaderReadOnlyOptimal, Image::eSampled, {} };
+	inline const ResourceUsage ComputeSampled{ Stage::eComputeShader, Flag::eShaderSampledRead, Layout::eShaderReadOnlyOptimal, Image::eSampled, {} };
+	inline const ResourceUsage ComputeStorageRead{ Stage::eComputeShader, Flag::eShaderStorageRead, Layout::eGeneral, Image::eStorage, Buffer::eStorageBuffer };
+	inline const ResourceUsage ComputeStorageWrite{ Stage::eComputeShader, Flag::eShaderStorageRead | Flag::eShaderStorageWrite, Layout::eGeneral, Image::eStorage, Buffer::eStorageBuffer };
+	inline const ResourceUsage TransferRead{ Stage::eTransfer, Flag::eTransferRead, Layout::eTransferSrcOptimal, Image::eTransferSrc, Buffer::eTransferSrc };
+	inline const ResourceUsage TransferWrite{ Stage::eTransfer, Flag::eTransferWrite, Layout::eTransferDstOptimal, Image::eTransferDst, Buffer::eTransferDst };
+	inline const ResourceUsage IndirectRead{ Stage::eDrawIndirect, Flag::eIndirectCommandRead, Layout::eUndefined, {}, Buffer::eIndirectBuffer };
+	inline const ResourceUsage VertexBufferRead{ Stage::eVertexAttributeInput, Flag::eVertexAttributeRead, Layout::eUndefined, {}, Buffer::eVertexBuffer };
+	inline const ResourceUsage IndexBufferRead{ Stage::eIndexInput, Flag::eIndexRead, Layout::eUndefined, {}, Buffer::eIndexBuffer };
+	inline const ResourceUsage Present{ Stage::eNone, Flag::eNone, Layout::ePresentSrcKHR, {}, {} };
+	// Contents are discarded; used as the initial usage of imported images written from scratch
+	inline const ResourceUsage Undefined{ Stage::eNone, Flag::eNone, Layout::eUndefined, {}, {} };
+}
+
+// Handle to a resource declared in a RenderGraph.
+struct RenderGraphResource
+{
+	uint32_t index = UINT32_MAX;
+
+	bool valid() const { return index != UINT32_MAX; }
+};
+
+// Transient images are created and owned by the graph, and share memory with other
+// transient images whose lifetimes don't overlap.
+struct TransientImageDesc
+{
+	vk::Format format = vk::Format::eUndefined;
+	vk::Extent2D extent;
+	vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+	vk::ImageUsageFlags usage;		// Added to the usage derived from the passes
+};
+
+struct TransientBufferDesc
+{
+	vk::DeviceSize size = 0;
+	vk::BufferUsageFlags usage;		// Added to the usage derived from the passes
+};
+
+class RenderGraph;
+
+// A node of the graph. Declares the resources it touches; the graph records the barriers
+// they need before calling execute. Passes writing color or depth attachments are recorded
+// inside dynamic rendering over those attachments.
+class RenderGraphPass
+{
+public:
+	using ExecuteFunction = std::function<void(vk::CommandBuffer, const RenderGraph&)>;
+
+	RenderGraphPass& read(RenderGraphResource resource, const ResourceUsage& usage);
+	RenderGraphPass& write(RenderGraphResource resource, const ResourceUsage& usage);
+	// Clear an attachment written by this pass instead of loading it.
+	RenderGraphPass& clear(RenderGraphResource resource, const vk::ClearValue& value);
+	// Keep the pass even if nothing reads its outputs, e.g. for readbacks or queries.
+	RenderGraphPass& set_side_effects();
+
+private:
+	friend class RenderGraph;
+
+	struct ResourceAccess
+	{
+		uint32_t resource = 0;
+		ResourceUsage usage;
+		bool write = false;
+		std::optional<vk::ClearValue> clearValue;
+
+		// Attachment operations, set by compile
+		vk::AttachmentLoadOp loadOp = vk::AttachmentLoadOp::eLoad;
+		vk::AttachmentStoreOp storeOp = vk::AttachmentStoreOp::eStore;
+	};
+
+	std::string m_Name;
+	ExecuteFunction m_Execute;
+	std::vector<ResourceAccess> m_Accesses;
+	bool m_SideEffects = false;
+
+	// Compiled state
+	bool m_Culled = false;
+	std::vector<vk::ImageMemoryBarrier2> m_ImageBarriers;
+	std::vector<vk::BufferMemoryBarrier2> m_BufferBarriers;
+	std::vector<uint32_t> m_ImageBarrierResources;		// Resource of each barrier, to patch in imported handles
+	std::vector<uint32_t> m_BufferBarrierResources;
+
+	ResourceAccess& access(uint32_t resource, const ResourceUsage& usage, bool write);
+};
+
+// Frame graph of passes over images and buffers. Passes are declared in submission order;
+// compile() culls passes whose results are never used, derives one batched synchronization2
+// barrier per pass from the declared accesses, and places transient images with disjoint
+// lifetimes in the same memory. The compiled graph is executed every frame, with imported
+// resources (such as the swapchain image) rebound before each execution.
+class RenderGraph
+{
+public:
+	void init(vk::Device device, GpuAllocator& allocator);
+	void destroy();
+
+	// Remove all passes and resources, freeing transient memory, to declare a new graph.
+	// The GPU must no longer be using the transient resources.
+	void reset();
+
+	// Resources owned outside the graph. initialUsage is the state the resource is in when the
+	// graph starts and finalUsage the state it is left in.
+	RenderGraphResource import_image(const std::string& name, vk::Image image, vk::ImageView view, vk::Format format, vk::Extent2D extent,
+		const ResourceUsage& initialUsage, const ResourceUsage& finalUsage);
+	RenderGraphResource import_buffer(const std::string& name, vk::Buffer buffer, const ResourceUsage& initialUsage, const ResourceUsage& finalUsage);
+	// Rebind an imported resource, e.g. to this frame's swapchain image, without recompiling.
+	void set_imported_image(RenderGraphResource resource, vk::Image image, vk::ImageView view);
+	void set_imported_buffer(RenderGraphResource resource, vk::Buffer buffer);
+
+	RenderGraphResource create_image(const std::string& name, const TransientImageDesc& desc);
+	RenderGraphResource create_buffer(const std::string& name, const TransientBufferDesc& desc);
+
+	// Add a pass. The returned reference stays valid until the next add_pass.
+	RenderGraphPass& add_pass(const std::string& name, RenderGraphPass::ExecuteFunction&& execute);
+
+	// Imported resources are outputs implicitly; mark transient resources that are read
+	// outside of the graph.
+	void mark_output(RenderGraphResource resource);
+
+	void compile();
+	void execute(vk::CommandBuffer commandBuffer) const;
+
+	// Resource handles, valid in pass callbacks after compile.
+	vk::Image image(RenderGraphResource resource) const { return m_Resources[resource.index].image; }
+	vk::ImageView image_view(RenderGraphResource resource) const { return m_Resources[resource.index].view; }
+	vk::Buffer buffer(RenderGraphResource resource) const { return m_Resources[resource.index].buffer; }
+	vk::Extent2D extent(RenderGraphResource resource) const { return m_Resources[resource.index].extent; }
+
+	// Device memory used by transient images, and what it would be without aliasing.
+	vk::DeviceSize transient_memory() const { return m_TransientMemory; }
+	vk::DeviceSize unaliased_transient_memory() const { return m_UnaliasedTransientMemory; }
+
+private:
+	struct Resource
+	{
+		std::string name;
+		bool isImage = true;
+		bool imported = false;
+		bool output = false;
+
+		// Description
+		vk::Format format = vk::Format::eUndefined;
+		vk::Extent2D extent;
+		vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+		vk::ImageUsageFlags imageUsage;
+		vk::DeviceSize size = 0;
+		vk::BufferUsageFlags bufferUsage;
+		ResourceUsage initialUsage;
+		ResourceUsage finalUsage;
+
+		// Vulkan objects, owned by the graph for transient resources
+		vk::Image image;
+		vk::ImageView view;
+		vk::Buffer buffer;
+		Allocation bufferAllocation;
+
+		// Compiled state
+		uint32_t firstPass = UINT32_MAX, lastPass = 0;
+		uint32_t memorySlot = UINT32_MAX;
+	};
+
+	// Memory shared by transient images with disjoint lifetimes.
+	struct MemorySlot
+	{
+		Allocation allocation;
+		std::vector<uint32_t> resources;	// In lifetime order
+	};
+
+	// Last known state of a resource while barriers are derived.
+	struct ResourceState
+	{
+		vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+		vk::PipelineStageFlags2 writeStages;
+		vk::AccessFlags2 writeAccess;
+		vk::PipelineStageFlags2 readStages;		// Stages that read since the last write
+		vk::AccessFlags2 readAccess;
+	};
+
+	vk::Device m_Device;
+	GpuAllocator* m_Allocator = nullptr;
+
+	std::vector<Resource> m_Resources;
+	std::vector<RenderGraphPass> m_Passes;
+	std::vector<MemorySlot> m_MemorySlots;
+	bool m_Compiled = false;
+
+	// Barriers returning imported resources to their final usage, recorded after the last pass
+	std::vector<vk::ImageMemoryBarrier2> m_FinalImageBarriers;
+	std::vector<vk::BufferMemoryBarrier2> m_FinalBufferBarriers;
+	std::vector<uint32_t> m_FinalImageBarrierResources;
+	std::vector<uint32_t> m_FinalBufferBarrierResources;
+
+	vk::DeviceSize m_TransientMemory = 0;
+	vk::DeviceSize m_UnaliasedTransientMemory = 0;
+
+private:
+	void cull_passes();
+	void compute_lifetimes();
+	void create_transient_resources();
+	void destroy_transient_resources();
+	void build_barriers();
+	void record_barriers(vk::CommandBuffer commandBuffer,
+		const std::vector<vk::ImageMemoryBarrier2>& imageBarriers, const std::vector<uint32_t>& imageResources,
+		const std::vector<vk::BufferMemoryBarrier2>& bufferBarriers, const std::vector<uint32_t>& bufferResources) const;
+	bool begin_rendering(vk::CommandBuffer commandBuffer, const RenderGraphPass& pass) const;
+};
+
+#endif
@@ -0,0 +1,19 @@
+// Declarations of the global descriptor set managed by BindlessDescriptors. Include after
+// #version; resources are indexed with values passed in push constants, wrapped in
+// nonuniformEXT when the index may differ within a subgroup.
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Binding 0: storage buffers. Declare a typed view with
+//   BINDLESS_STORAGE_BUFFER(Material, materials);
+// and access it as materials[index].data[i].
+#define BINDLESS_STORAGE_BUFFER(Type, name) \
+	layout(std430, set = 0, binding = 0) buffer name##Buffer { Type data[]; } name[]
+
+// Binding 1: combined image samplers
+layout(set = 0, binding = 1) uniform sampler2D bindlessTextures[];
+
+// Binding 2: storage images. Declare a view with a matching format qualifier, e.g.
+//   BINDLESS_STORAGE_IMAGE(rgba8, outputImages);
+#define BINDLESS_STORAGE_IMAGE(format, name) \
+	layout(set = 0, binding = 2, format) uniform image2D name[]
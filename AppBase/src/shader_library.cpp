@@ -0,0 +1,128 @@
+#include <fstream>
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+#include "shader_library.h"
+#include "hash.h"
+
+namespace
+{
+	constexpr uint32_t SpirvMagic = 0x07230203;
+
+	// Reads a whole file, or returns null if it cannot be opened.
+	std::shared_ptr<std::vector<char>> read_binary(const std::string& path)
+	{
+		std::ifstream file(path, std::ifstream::ate | std::ifstream::binary);
+		if (!file.is_open())
+			return nullptr;
+
+		size_t fileSize = file.tellg();
+		auto code = std::make_shared<std::vector<char>>(fileSize);
+
+		file.seekg(0);
+		file.read(code->data(), fileSize);
+		file.close();
+
+		return code;
+	}
+}
+
+// Stores the device shader modules are created on.
+void ShaderLibrary::init(vk::Device device)
+{
+	m_Device = device;
+}
+
+// Destroys every cached shader module.
+void ShaderLibrary::destroy()
+{
+	std::lock_guard lock(m_Mutex);
+
+	for (const auto& [path, entry] : m_Entries)
+		m_Device.destroyShaderModule(entry->module);
+	for (const auto& entry : m_Replaced)
+		m_Device.destroyShaderModule(entry->module);
+
+	m_Entries.clear();
+	m_Replaced.clear();
+}
+
+// Returns the cached shader for path, reading the file and creating its module on a miss.
+std::shared_ptr<const ShaderEntry> ShaderLibrary::load(const std::string& path)
+{
+	std::lock_guard lock(m_Mutex);
+
+	auto it = m_Entries.find(path);
+	if (it != m_Entries.end())
+		return it->second;
+
+	std::shared_ptr<const ShaderEntry> entry = create_entry(path, read_spirv(path));
+	m_Entries.emplace(path, entry);
+	return entry;
+}
+
+// Validates the new binary before touching the cache; the file is read outside the lock.
+std::shared_ptr<const ShaderEntry> ShaderLibrary::reload(const std::string& path)
+{
+	std::shared_ptr<const std::vector<char>> code = read_binary(path);
+
+	uint32_t magic = 0;
+	if (code && code->size() >= sizeof(magic) && code->size() % sizeof(uint32_t) == 0)
+		std::memcpy(&magic, code->data(), sizeof(magic));
+
+	if (magic != SpirvMagic)
+	{
+		spdlog::warn("Not reloading {}: missing or not a SPIR-V binary", path);
+		return nullptr;
+	}
+
+	std::lock_guard lock(m_Mutex);
+
+	// A rewrite with identical contents (e.g. a rebuild with no changes) is not a reload
+	auto it = m_Entries.find(path);
+	if (it != m_Entries.end() && *it->second->code == *code)
+		return nullptr;
+
+	std::shared_ptr<const ShaderEntry> entry = create_entry(path, std::move(code));
+	if (it != m_Entries.end())
+	{
+		m_Replaced.push_back(std::move(it->second));
+		it->second = entry;
+	}
+	else
+	{
+		m_Entries.emplace(path, entry);
+	}
+
+	spdlog::info("Reloaded shader {}", path);
+	return entry;
+}
+
+// Hashes the code and creates its module.
+std::shared_ptr<const ShaderEntry> ShaderLibrary::create_entry(const std::string& path, std::shared_ptr<const std::vector<char>> code)
+{
+	auto entry = std::make_shared<ShaderEntry>();
+	entry->path = path;
+	entry->code = std::move(code);
+	entry->codeHash = fnv1a_64(entry->code->data(), entry->code->size());
+
+	vk::ShaderModuleCreateInfo moduleInfo(
+		{}, entry->code->size(), reinterpret_cast<const uint32_t*>(entry->code->data())
+	);
+	entry->module = m_Device.createShaderModule(moduleInfo);
+
+	return entry;
+}
+
+// Reads a SPIR-V binary into a shared, immutable buffer.
+std::shared_ptr<const std::vector<char>> ShaderLibrary::read_spirv(const std::string& path)
+{
+	std::shared_ptr<std::vector<char>> code = read_binary(path);
+	if (!code)
+	{
+		spdlog::error("Failed to open file " + path);
+		exit(EXIT_FAILURE);
+	}
+
+	return code;
+}
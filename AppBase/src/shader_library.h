@@ -0,0 +1,52 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+
+#include <vulkan/vulkan.hpp>
+
+// A SPIR-V binary loaded once and its shader module.
+struct ShaderEntry
+{
+	std::string path;
+	std::shared_ptr<const std::vector<char>> code;
+	uint64_t codeHash = 0;
+	vk::ShaderModule module;
+};
+
+// Shared cache of SPIR-V binaries and shader modules. Each file is read and turned into a
+// vk::ShaderModule on first use; later requests (from any PipelineBuilder or thread) reuse
+// the cached entry. Modules are owned by the library and destroyed in destroy().
+class ShaderLibrary
+{
+public:
+	void init(vk::Device device);
+	void destroy();
+
+	// Return the cached entry for path, loading it on first request.
+	std::shared_ptr<const ShaderEntry> load(const std::string& path);
+
+	// Re-read path and replace its entry, so later loads get the new code. Returns null and
+	// keeps the current entry if the file is missing, unchanged or not SPIR-V (e.g. still
+	// being written).
+	// Replaced modules live until destroy(), as existing builders may still reference them.
+	std::shared_ptr<const ShaderEntry> reload(const std::string& path);
+
+	// Read a SPIR-V file into memory. Exits on failure, matching VulkanAppBase::read_file.
+	static std::shared_ptr<const std::vector<char>> read_spirv(const std::string& path);
+
+private:
+	vk::Device m_Device;
+	std::unordered_map<std::string, std::shared_ptr<const ShaderEntry>> m_Entries;
+	std::vector<std::shared_ptr<const ShaderEntry>> m_Replaced;
+	std::mutex m_Mutex;
+
+private:
+	std::shared_ptr<const ShaderEntry> create_entry(const std::string& path, std::shared_ptr<const std::vector<char>> code);
+};
+
+#endif
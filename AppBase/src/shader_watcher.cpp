@@ -0,0 +1,153 @@
+#include <cstdlib>
+#include <chrono>
+
+#include <spdlog/spdlog.h>
+#include "shader_watcher.h"
+
+namespace
+{
+	// Returns the file's modification time, or the minimum time if it does not exist.
+	std::filesystem::file_time_type modification_time(const std::string& path)
+	{
+		std::error_code error;
+		std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+		return error ? std::filesystem::file_time_type::min() : time;
+	}
+
+	std::string quote(const std::string& argument)
+	{
+		return "\"" + argument + "\"";
+	}
+}
+
+// Starts the polling thread.
+void ShaderWatcher::init(ShaderLibrary& shaderLibrary, PipelineRegistry& pipelineRegistry, ThreadPool& threadPool, const ShaderWatcherConfig& config)
+{
+	m_ShaderLibrary = &shaderLibrary;
+	m_PipelineRegistry = &pipelineRegistry;
+	m_ThreadPool = &threadPool;
+	m_Config = config;
+
+	m_Stopping = false;
+	m_Thread = std::thread(&ShaderWatcher::poll_loop, this);
+
+	spdlog::info("Shader hot reload enabled (polling every {} ms)", m_Config.poll_interval_ms);
+}
+
+// Stops the polling thread and waits for compiles in flight.
+void ShaderWatcher::destroy()
+{
+	if (!m_Thread.joinable())
+		return;
+
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_Condition.notify_all();
+	m_Thread.join();
+
+	for (const auto& shader : m_Shaders)
+	{
+		if (shader->compile.valid())
+			shader->compile.wait();
+	}
+	m_Shaders.clear();
+}
+
+// Records the current modification times, so only later changes trigger a reload.
+void ShaderWatcher::watch(const std::string& spirvPath, const std::string& sourcePath, const std::vector<std::string>& compileArgs)
+{
+	auto shader = std::make_unique<WatchedShader>();
+	shader->spirvPath = spirvPath;
+	shader->sourcePath = sourcePath;
+	shader->compileArgs = compileArgs;
+	shader->spirvTime = modification_time(spirvPath);
+	shader->sourceTime = sourcePath.empty() ? std::filesystem::file_time_type::min() : modification_time(sourcePath);
+
+	std::lock_guard lock(m_Mutex);
+	m_Shaders.push_back(std::move(shader));
+}
+
+// Polls every watched shader, reloads the changed binaries, then sleeps for the poll interval
+// or until stopped. Reloads run without the lock, so watch() and destroy() never wait on them.
+void ShaderWatcher::poll_loop()
+{
+	std::unique_lock lock(m_Mutex);
+
+	while (!m_Stopping)
+	{
+		std::vector<std::string> changed;
+		for (const auto& shader : m_Shaders)
+		{
+			if (poll(*shader))
+				changed.push_back(shader->spirvPath);
+		}
+
+		lock.unlock();
+		for (const std::string& spirvPath : changed)
+		{
+			std::shared_ptr<const ShaderEntry> entry = m_ShaderLibrary->reload(spirvPath);
+			if (entry)
+				m_PipelineRegistry->reload_shader(*entry);
+		}
+		lock.lock();
+
+		m_Condition.wait_for(lock, std::chrono::milliseconds(m_Config.poll_interval_ms), [this]() { return m_Stopping; });
+	}
+}
+
+// Compiles a changed source unless a compile is still running. Returns whether the binary changed.
+bool ShaderWatcher::poll(WatchedShader& shader)
+{
+	if (!shader.sourcePath.empty())
+	{
+		bool compiling = shader.compile.valid() && shader.compile.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+		std::filesystem::file_time_type sourceTime = modification_time(shader.sourcePath);
+
+		if (!compiling && sourceTime != shader.sourceTime)
+		{
+			shader.sourceTime = sourceTime;
+			shader.compile = m_ThreadPool->submit([this, &shader]() { compile(shader); });
+		}
+	}
+
+	std::filesystem::file_time_type spirvTime = modification_time(shader.spirvPath);
+	if (spirvTime == shader.spirvTime)
+		return false;
+
+	shader.spirvTime = spirvTime;
+	return true;
+}
+
+// Compiles to a temporary file that replaces the binary in one rename, so a poll never sees
+// a partly written file. Compile errors are logged and leave the previous SPIR-V, and
+// pipelines, in place.
+void ShaderWatcher::compile(const WatchedShader& shader) const
+{
+	std::string outputPath = shader.spirvPath + ".tmp";
+
+	std::string command = quote(m_Config.compiler);
+	for (const std::string& argument : shader.compileArgs)
+		command += " " + quote(argument);
+	command += " " + quote(shader.sourcePath) + " -o " + quote(outputPath);
+
+#ifdef _WIN32
+	// cmd.exe strips the outer pair of quotes from a command that starts with one
+	command = quote(command);
+#endif
+
+	spdlog::info("Compiling {}", shader.sourcePath);
+
+	int result = std::system(command.c_str());
+	if (result != 0)
+	{
+		spdlog::error("Shader compile failed ({}): {}", result, command);
+		return;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(outputPath, shader.spirvPath, error);
+	if (error)
+		spdlog::error("Failed to replace {}: {}", shader.spirvPath, error.message());
+}
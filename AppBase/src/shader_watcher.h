@@ -0,0 +1,73 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <filesystem>
+#include <future>
+
+#include "shader_library.h"
+#include "pipeline_registry.h"
+#include "thread_pool.h"
+
+struct ShaderWatcherConfig
+{
+	uint32_t poll_interval_ms = 250;		// Time between checks of the watched files
+	std::string compiler = "glslc";			// GLSL compiler command, e.g. a full path to the SDK's glslc
+};
+
+// Hot shader reload for iteration without restarts. A background thread polls the watched
+// files' modification times. A changed GLSL source is recompiled to its SPIR-V path on the
+// thread pool; a changed SPIR-V file, whether written by that compile or by an external
+// build, is reloaded into the shader library and every registry pipeline using it is rebuilt
+// in the background. PipelineRegistry::update swaps the rebuilt pipelines in at the next
+// frame boundary, so the device never has to idle.
+//
+// Paths must match the ones given to PipelineBuilder::add_shader_stage. Files pulled in with
+// #include are not watched. Pipelines built outside the registry are not rebuilt.
+class ShaderWatcher
+{
+public:
+	void init(ShaderLibrary& shaderLibrary, PipelineRegistry& pipelineRegistry, ThreadPool& threadPool, const ShaderWatcherConfig& config);
+	void destroy();
+
+	// Watch a SPIR-V file and, optionally, the GLSL source it is compiled from with the given
+	// extra compiler arguments (e.g. -DOCCLUSION).
+	void watch(const std::string& spirvPath, const std::string& sourcePath = {}, const std::vector<std::string>& compileArgs = {});
+
+private:
+	struct WatchedShader
+	{
+		std::string spirvPath;
+		std::string sourcePath;
+		std::vector<std::string> compileArgs;
+		std::filesystem::file_time_type spirvTime;
+		std::filesystem::file_time_type sourceTime;
+		std::future<void> compile;		// Compile in flight, if valid
+	};
+
+	ShaderLibrary* m_ShaderLibrary = nullptr;
+	PipelineRegistry* m_PipelineRegistry = nullptr;
+	ThreadPool* m_ThreadPool = nullptr;
+	ShaderWatcherConfig m_Config;
+
+	std::vector<std::unique_ptr<WatchedShader>> m_Shaders;
+	std::mutex m_Mutex;
+
+	std::thread m_Thread;
+	std::condition_variable m_Condition;
+	bool m_Stopping = false;
+
+private:
+	void poll_loop();
+	// Called with m_Mutex held; the caller reloads changed binaries after releasing it.
+	bool poll(WatchedShader& shader);
+	// Runs the compiler; the resulting SPIR-V is picked up by a later poll.
+	void compile(const WatchedShader& shader) const;
+};
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef SPECIALIZATION_H
+#define SPECIALIZATION_H
+
+#include <vector>
+#include <tuple>
+#include <optional>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <vulkan/vulkan.hpp>
+
+// Specialization constants of one shader stage, laid out as VkSpecializationInfo expects.
+// Entries are kept sorted by constant ID, so equal constant sets produce equal pipeline keys
+// whatever order they were added in.
+struct SpecializationData
+{
+	std::vector<vk::SpecializationMapEntry> entries;
+	std::vector<uint8_t> data;
+
+	bool empty() const { return entries.empty(); }
+
+	// Set a constant's value, replacing any earlier value for the same ID.
+	template<typename T>
+	SpecializationData& set(uint32_t constantId, const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Specialization constants must be trivially copyable");
+
+		remove(constantId);
+
+		auto position = std::lower_bound(entries.begin(), entries.end(), constantId,
+			[](const vk::SpecializationMapEntry& entry, uint32_t id) { return entry.constantID < id; });
+		uint32_t offset = position == entries.end() ? static_cast<uint32_t>(data.size()) : position->offset;
+
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+		data.insert(data.begin() + offset, bytes, bytes + sizeof(T));
+		for (auto it = position; it != entries.end(); ++it)
+			it->offset += sizeof(T);
+		entries.insert(position, vk::SpecializationMapEntry(constantId, offset, sizeof(T)));
+		return *this;
+	}
+
+	// Points into this object, so it is only valid while the data is alive and unchanged.
+	vk::SpecializationInfo info() const
+	{
+		return vk::SpecializationInfo(static_cast<uint32_t>(entries.size()), entries.data(), data.size(), data.data());
+	}
+
+private:
+	void remove(uint32_t constantId)
+	{
+		auto it = std::find_if(entries.begin(), entries.end(), [&](const vk::SpecializationMapEntry& entry) { return entry.constantID == constantId; });
+		if (it == entries.end())
+			return;
+
+		uint32_t offset = it->offset;
+		uint32_t size = static_cast<uint32_t>(it->size);
+		data.erase(data.begin() + offset, data.begin() + offset + size);
+		for (auto later = entries.erase(it); later != entries.end(); ++later)
+			later->offset -= size;
+	}
+};
+
+// Scalar types a specialization constant can have. SPIR-V booleans are 32 bits wide.
+template<typename T>
+concept SpecConstantType =
+	std::is_same_v<T, bool> || std::is_same_v<T, int32_t> || std::is_same_v<T, uint32_t> || std::is_same_v<T, float> ||
+	std::is_same_v<T, int64_t> || std::is_same_v<T, uint64_t> || std::is_same_v<T, double>;
+
+// Declares a specialization constant by its constant_id in the shader and its C++ type. Use
+// constant_id 0..2 with local_size_x_id etc. to specialize compute workgroup sizes.
+template<uint32_t Id, SpecConstantType T>
+struct SpecConstant
+{
+	static constexpr uint32_t id = Id;
+	using Type = T;
+	using StorageType = std::conditional_t<std::is_same_v<T, bool>, vk::Bool32, T>;
+};
+
+// Values for the fixed set of specialization constants a shader declares, e.g.
+//
+//   using CullConstants = SpecializationMap<SpecConstant<0, uint32_t>, SpecConstant<1, bool>>;
+//   builder.add_shader_stage(path, stage, CullConstants().set<SpecConstant<0, uint32_t>>(128));
+//
+// Setting a constant outside the set is a compile error, as are duplicate constant IDs.
+// Constants left unset keep the default declared in the shader.
+template<typename... Constants>
+class SpecializationMap
+{
+	static constexpr bool unique_ids()
+	{
+		constexpr uint32_t ids[] = { Constants::id..., 0 };
+		for (size_t i = 0; i < sizeof...(Constants); i++)
+			for (size_t j = i + 1; j < sizeof...(Constants); j++)
+				if (ids[i] == ids[j])
+					return false;
+		return true;
+	}
+
+	static_assert(unique_ids(), "Specialization constant IDs must be unique");
+
+public:
+	template<typename Constant>
+		requires (std::is_same_v<Constant, Constants> || ...)
+	SpecializationMap& set(typename Constant::Type value)
+	{
+		std::get<index_of<Constant>()>(m_Values) = static_cast<typename Constant::StorageType>(value);
+		return *this;
+	}
+
+	// Flatten the constants that have been set.
+	SpecializationData data() const
+	{
+		SpecializationData result;
+		add_constants(result, std::index_sequence_for<Constants...>{});
+		return result;
+	}
+
+private:
+	std::tuple<std::optional<typename Constants::StorageType>...> m_Values;
+
+	template<typename Constant>
+	static constexpr size_t index_of()
+	{
+		constexpr bool matches[] = { std::is_same_v<Constant, Constants>... };
+		return static_cast<size_t>(std::find(std::begin(matches), std::end(matches), true) - std::begin(matches));
+	}
+
+	template<size_t... I>
+	void add_constants(SpecializationData& result, std::index_sequence<I...>) const
+	{
+		auto add = [&](uint32_t id, const auto& value)
+		{
+			if (value)
+				result.set(id, *value);
+		};
+		(add(Constants::id, std::get<I>(m_Values)), ...);
+	}
+};
+
+#endif
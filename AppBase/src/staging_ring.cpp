@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+#include "staging_ring.h"
+
+// Creates the ring's command pool, per-submission command buffers and timeline semaphore.
+void StagingRing::init(vk::Device device, GpuAllocator& allocator, AllocatedBuffer buffer, uint32_t queueFamily, vk::Queue queue, uint32_t dstQueueFamily,
+	std::mutex& queueMutex, vk::Semaphore graphicsTimeline)
+{
+	assert(buffer.allocation.mapped && "Staging ring buffer must be host-visible!");
+
+	m_Device = device;
+	m_Allocator = &allocator;
+	m_Buffer = buffer;
+	m_Queue = queue;
+	m_QueueMutex = &queueMutex;
+	m_GraphicsTimeline = graphicsTimeline;
+	m_QueueFamily = queueFamily;
+	m_DstQueueFamily = dstQueueFamily;
+	m_Capacity = buffer.allocation.size;
+
+	vk::CommandPoolCreateInfo poolInfo(
+		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer, queueFamily
+	);
+	m_CommandPool = m_Device.createCommandPool(poolInfo);
+
+	vk::CommandBufferAllocateInfo allocInfo(m_CommandPool, vk::CommandBufferLevel::ePrimary, MaxSubmissions);
+	std::vector<vk::CommandBuffer> commandBuffers = m_Device.allocateCommandBuffers(allocInfo);
+
+	for (uint32_t i = 0; i < MaxSubmissions; i++)
+		m_Submissions[i].commandBuffer = commandBuffers[i];
+
+	// Timeline semaphore signaled with each submission's value
+	vk::SemaphoreTypeCreateInfo timelineInfo(vk::SemaphoreType::eTimeline, 0);
+	vk::SemaphoreCreateInfo semaphoreInfo({}, &timelineInfo);
+	m_Timeline = m_Device.createSemaphore(semaphoreInfo);
+}
+
+// Waits for outstanding submissions and releases the ring's resources.
+void StagingRing::destroy()
+{
+	std::lock_guard lock(m_Mutex);
+
+	while (!m_InFlight.empty())
+		wait_oldest();
+
+	m_Device.destroySemaphore(m_Timeline);
+	m_Device.destroyCommandPool(m_CommandPool);
+	m_Device.destroyBuffer(m_Buffer.buffer);
+	m_Allocator->free(m_Buffer.allocation);
+}
+
+// Writes data into the ring and queues the copies to the destination buffer.
+void StagingRing::upload(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size, const UploadSync& sync)
+{
+	std::lock_guard lock(m_Mutex);
+
+	// The buffer was released to the graphics family by its first upload
+	if (sync.overwrite && sync.transferOwnership && m_QueueFamily != m_DstQueueFamily)
+	{
+		spdlog::error("Overwriting uploads need an eConcurrent buffer and transferOwnership = false");
+		throw std::runtime_error("Staging upload overwrites an exclusive buffer");
+	}
+
+	const char* src = static_cast<const char*>(data);
+	vk::DeviceSize remaining = size;
+
+	while (remaining > 0)
+	{
+		vk::DeviceSize chunk = std::min(remaining, m_Capacity);
+		vk::DeviceSize ringOffset = reserve(chunk, 16);
+
+		memcpy(static_cast<char*>(m_Buffer.allocation.mapped) + ringOffset, src, static_cast<size_t>(chunk));
+		m_PendingCopies.push_back({ dst, vk::BufferCopy(ringOffset, dstOffset, chunk), sync });
+
+		src += chunk;
+		dstOffset += chunk;
+		remaining -= chunk;
+	}
+}
+
+// Submits all pending copies.
+uint64_t StagingRing::flush()
+{
+	std::lock_guard lock(m_Mutex);
+	return flush_locked();
+}
+
+// Records acquire barriers for flushed uploads and returns the timeline wait covering them.
+std::optional<vk::SemaphoreSubmitInfo> StagingRing::acquire(vk::CommandBuffer commandBuffer)
+{
+	std::lock_guard lock(m_Mutex);
+
+	uint64_t lastFlushedValue = m_NextValue - 1;
+	if (lastFlushedValue == m_LastAcquiredValue)
+		return std::nullopt;
+
+	if (!m_PendingAcquires.empty())
+	{
+		vk::DependencyInfo dependencyInfo{};
+		dependencyInfo.setBufferMemoryBarriers(m_PendingAcquires);
+		commandBuffer.pipelineBarrier2(dependencyInfo);
+		m_PendingAcquires.clear();
+	}
+
+	m_LastAcquiredValue = lastFlushedValue;
+	return vk::SemaphoreSubmitInfo(m_Timeline, lastFlushedValue, vk::PipelineStageFlagBits2::eAllCommands);
+}
+
+// Later overwriting uploads wait for this value before copying.
+void StagingRing::graphics_submitted(uint64_t graphicsValue)
+{
+	std::lock_guard lock(m_Mutex);
+	m_GraphicsValue = graphicsValue;
+}
+
+// Returns true if the submission with the given timeline value has finished executing.
+bool StagingRing::is_complete(uint64_t value)
+{
+	return m_Device.getSemaphoreCounterValue(m_Timeline) >= value;
+}
+
+// Blocks until the submission with the given timeline value has finished executing.
+void StagingRing::wait(uint64_t value)
+{
+	vk::SemaphoreWaitInfo waitInfo{};
+	waitInfo.setSemaphores(m_Timeline);
+	waitInfo.setValues(value);
+
+	auto result = m_Device.waitSemaphores(waitInfo, UINT64_MAX);
+	if (result != vk::Result::eSuccess)
+		spdlog::error("Staging ring timeline wait failed: {}", vk::to_string(result));
+}
+
+// Reserves a contiguous, aligned range of the ring, flushing and waiting on older
+// submissions if the ring is full. Returns the byte offset into the ring buffer.
+vk::DeviceSize StagingRing::reserve(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+	assert(size <= m_Capacity && "Staging reservation larger than ring!");
+
+	while (true)
+	{
+		reclaim();
+
+		uint64_t pos = (m_Head + alignment - 1) & ~(alignment - 1);
+
+		// Skip to the start of the ring if the range would straddle the end
+		if (pos % m_Capacity + size > m_Capacity)
+			pos = (pos / m_Capacity + 1) * m_Capacity;
+
+		if (pos + size - m_Tail <= m_Capacity)
+		{
+			m_Head = pos + size;
+			return pos % m_Capacity;
+		}
+
+		// Out of space: push pending copies out so their space can be recycled, then wait
+		if (!m_PendingCopies.empty())
+			flush_locked();
+
+		if (m_InFlight.empty())
+		{
+			// Nothing left to wait on, the whole ring is free
+			m_Head = m_Tail = 0;
+			continue;
+		}
+
+		wait_oldest();
+	}
+}
+
+// Records all pending copies (and ownership releases) into one command buffer and submits
+// it, signaling the ring's timeline semaphore. Overwriting copies make the submission wait
+// for the last submitted graphics frame; later frames already wait on the ring's timeline.
+uint64_t StagingRing::flush_locked()
+{
+	if (m_PendingCopies.empty())
+		return m_NextValue - 1;
+
+	reclaim();
+	if (m_InFlight.size() == MaxSubmissions)
+		wait_oldest();
+
+	uint32_t slot = m_NextSlot;
+	m_NextSlot = (m_NextSlot + 1) % MaxSubmissions;
+	Submission& submission = m_Submissions[slot];
+
+	submission.commandBuffer.reset();
+
+	vk::CommandBufferBeginInfo beginInfo({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+	submission.commandBuffer.begin(beginInfo);
+
+	// Group consecutive copies to the same destination into one vkCmdCopyBuffer
+	std::vector<vk::BufferCopy> regions;
+	for (size_t i = 0; i < m_PendingCopies.size(); i++)
+	{
+		regions.push_back(m_PendingCopies[i].region);
+
+		bool lastForDst = i + 1 == m_PendingCopies.size() || m_PendingCopies[i + 1].dst != m_PendingCopies[i].dst;
+		if (lastForDst)
+		{
+			submission.commandBuffer.copyBuffer(m_Buffer.buffer, m_PendingCopies[i].dst, regions);
+			regions.clear();
+		}
+	}
+
+	// Release exclusive destinations to the graphics queue family; the matching acquire is
+	// recorded on the graphics queue by acquire()
+	if (m_QueueFamily != m_DstQueueFamily)
+	{
+		std::vector<vk::BufferMemoryBarrier2> releases;
+		for (const auto& copy : m_PendingCopies)
+		{
+			if (!copy.sync.transferOwnership)
+				continue;
+
+			releases.emplace_back(
+				vk::PipelineStageFlagBits2::eCopy, vk::AccessFlagBits2::eTransferWrite,
+				vk::PipelineStageFlagBits2::eNone, vk::AccessFlagBits2::eNone,
+				m_QueueFamily, m_DstQueueFamily,
+				copy.dst, copy.region.dstOffset, copy.region.size
+			);
+
+			m_PendingAcquires.emplace_back(
+				vk::PipelineStageFlagBits2::eNone, vk::AccessFlagBits2::eNone,
+				copy.sync.dstStage, copy.sync.dstAccess,
+				m_QueueFamily, m_DstQueueFamily,
+				copy.dst, copy.region.dstOffset, copy.region.size
+			);
+		}
+
+		if (!releases.empty())
+		{
+			vk::DependencyInfo dependencyInfo{};
+			dependencyInfo.setBufferMemoryBarriers(releases);
+			submission.commandBuffer.pipelineBarrier2(dependencyInfo);
+		}
+	}
+
+	submission.commandBuffer.end();
+
+	submission.value = m_NextValue++;
+	submission.ringEnd = m_Head;
+
+	bool overwrite = std::any_of(m_PendingCopies.begin(), m_PendingCopies.end(), [](const PendingCopy& copy) { return copy.sync.overwrite; });
+
+	vk::CommandBufferSubmitInfo commandBufferInfo(submission.commandBuffer);
+	vk::SemaphoreSubmitInfo waitInfo(m_GraphicsTimeline, m_GraphicsValue, vk::PipelineStageFlagBits2::eCopy);
+	vk::SemaphoreSubmitInfo signalInfo(m_Timeline, submission.value, vk::PipelineStageFlagBits2::eAllCommands);
+
+	vk::SubmitInfo2 submitInfo{};
+	if (overwrite && m_GraphicsValue != 0)
+		submitInfo.setWaitSemaphoreInfos(waitInfo);
+	submitInfo.setCommandBufferInfos(commandBufferInfo);
+	submitInfo.setSignalSemaphoreInfos(signalInfo);
+	{
+		std::lock_guard lock(*m_QueueMutex);
+		m_Queue.submit2(submitInfo);
+	}
+
+	m_InFlight.push_back(slot);
+	m_PendingCopies.clear();
+
+	return submission.value;
+}
+
+// Retires completed submissions in order and advances the ring tail past their data.
+void StagingRing::reclaim()
+{
+	uint64_t completedValue = m_Device.getSemaphoreCounterValue(m_Timeline);
+
+	while (!m_InFlight.empty())
+	{
+		Submission& submission = m_Submissions[m_InFlight.front()];
+		if (submission.value > completedValue)
+			break;
+
+		m_Tail = submission.ringEnd;
+		m_InFlight.pop_front();
+	}
+}
+
+// Blocks on the oldest in-flight submission and retires it.
+void StagingRing::wait_oldest()
+{
+	wait(m_Submissions[m_InFlight.front()].value);
+	reclaim();
+}
@@ -0,0 +1,120 @@
+#ifndef STAGING_RING_H
+#define STAGING_RING_H
+
+#include <vector>
+#include <deque>
+#include <array>
+#include <mutex>
+#include <optional>
+
+#include <vulkan/vulkan.hpp>
+#include "gpu_allocator.h"
+
+// Describes how the graphics queue consumes an uploaded range.
+//
+// Exclusive buffers change owner once, on their first upload; uploading into them again
+// would release a buffer the transfer queue no longer owns. Buffers uploaded more than once,
+// and buffers read by the async compute family, which never acquires uploads, must be
+// created with eConcurrent sharing and uploaded with transferOwnership = false.
+struct UploadSync
+{
+	vk::PipelineStageFlags2 dstStage = vk::PipelineStageFlagBits2::eAllCommands;
+	vk::AccessFlags2 dstAccess = vk::AccessFlagBits2::eMemoryRead;
+	bool transferOwnership = true;		// Set to false for eConcurrent destination buffers
+	bool overwrite = false;				// Submitted frames may still read dst: the copy waits for them
+};
+
+// Persistently mapped staging ring buffer for asynchronous host-to-device uploads.
+// Uploads are written back-to-back into the ring and their copies are recorded into a
+// single transfer submission on flush(). Every submission signals a timeline semaphore;
+// ring space is reclaimed once the semaphore passes that submission's value.
+//
+// When the transfer and graphics queue families differ, exclusive destination buffers are
+// released by the transfer queue and must be acquired by the graphics queue through
+// acquire() before use.
+//
+// Uploads may come from any thread, and a full ring submits from the uploading thread, so
+// every submit takes queueMutex; the queue may be shared with the graphics queue.
+//
+// A submission containing overwriting uploads waits on the graphics timeline for the last
+// frame reported through graphics_submitted(), so its copies never race that frame's reads.
+class StagingRing
+{
+public:
+	// Takes ownership of a host-visible buffer created with eTransferSrc usage.
+	void init(vk::Device device, GpuAllocator& allocator, AllocatedBuffer buffer, uint32_t queueFamily, vk::Queue queue, uint32_t dstQueueFamily,
+		std::mutex& queueMutex, vk::Semaphore graphicsTimeline);
+	void destroy();
+
+	// Copy host data into the ring and queue a copy to dst. Uploads larger than the ring
+	// are split into multiple copies. The copy executes after the next flush().
+	void upload(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size, const UploadSync& sync = {});
+
+	// Submit all pending copies in one submission. Returns the timeline value signaled on
+	// completion, or the value of the last submission if nothing was pending.
+	uint64_t flush();
+
+	// Record ownership acquire barriers for every flushed upload not yet acquired into a
+	// graphics command buffer. Returns the semaphore wait that submission must include.
+	std::optional<vk::SemaphoreSubmitInfo> acquire(vk::CommandBuffer commandBuffer);
+
+	// Record the graphics timeline value signaled by the frame just submitted.
+	void graphics_submitted(uint64_t graphicsValue);
+
+	bool is_complete(uint64_t value);
+	void wait(uint64_t value);
+
+	vk::Semaphore timeline() const { return m_Timeline; }
+	vk::DeviceSize capacity() const { return m_Capacity; }
+
+private:
+	static constexpr uint32_t MaxSubmissions = 8;
+
+	struct PendingCopy
+	{
+		vk::Buffer dst;
+		vk::BufferCopy region;
+		UploadSync sync;
+	};
+
+	struct Submission
+	{
+		vk::CommandBuffer commandBuffer;
+		uint64_t value = 0;
+		uint64_t ringEnd = 0;	// Ring position up to which this submission's data extends
+	};
+
+	vk::Device m_Device;
+	GpuAllocator* m_Allocator = nullptr;
+	AllocatedBuffer m_Buffer;
+	vk::Queue m_Queue;
+	std::mutex* m_QueueMutex = nullptr;		// Held around submits to m_Queue
+	uint32_t m_QueueFamily = 0, m_DstQueueFamily = 0;
+	vk::CommandPool m_CommandPool;
+	vk::Semaphore m_Timeline;
+	vk::Semaphore m_GraphicsTimeline;
+	uint64_t m_GraphicsValue = 0;		// Signaled by the last submitted graphics frame
+
+	vk::DeviceSize m_Capacity = 0;
+	uint64_t m_Head = 0;		// Monotonic write position
+	uint64_t m_Tail = 0;		// Monotonic position of the oldest data still in use
+
+	std::vector<PendingCopy> m_PendingCopies;
+	std::vector<vk::BufferMemoryBarrier2> m_PendingAcquires;
+	uint64_t m_LastAcquiredValue = 0;
+
+	std::array<Submission, MaxSubmissions> m_Submissions;
+	std::deque<uint32_t> m_InFlight;		// Submission slots in submission order
+	uint32_t m_NextSlot = 0;
+	uint64_t m_NextValue = 1;
+
+	std::mutex m_Mutex;
+
+private:
+	vk::DeviceSize reserve(vk::DeviceSize size, vk::DeviceSize alignment);
+	uint64_t flush_locked();
+	void reclaim();
+	void wait_oldest();
+};
+
+#endif
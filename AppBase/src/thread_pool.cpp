@@ -0,0 +1,118 @@
+#include "thread_pool.h"
+
+thread_local const ThreadPool* ThreadPool::t_Pool = nullptr;
+thread_local uint32_t ThreadPool::t_WorkerIndex = 0;
+
+// Spawns the worker threads, each with its own task deque.
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+	m_Queues.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; i++)
+		m_Queues.push_back(std::make_unique<WorkerQueue>());
+
+	m_Workers.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; i++)
+		m_Workers.emplace_back(&ThreadPool::worker_loop, this, i);
+}
+
+// Finishes queued tasks and joins the worker threads.
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_Condition.notify_all();
+
+	for (auto& worker : m_Workers)
+		worker.join();
+}
+
+// Returns the calling thread's worker index, or thread_count() for outside threads.
+uint32_t ThreadPool::current_worker() const
+{
+	return t_Pool == this ? t_WorkerIndex : thread_count();
+}
+
+// Pushes a task onto the calling worker's deque, or round-robin onto a worker deque when
+// called from outside the pool, and wakes a sleeping worker.
+void ThreadPool::enqueue(std::function<void()>&& task)
+{
+	uint32_t queueIndex = current_worker();
+	if (queueIndex == thread_count())
+		queueIndex = m_NextQueue.fetch_add(1, std::memory_order_relaxed) % thread_count();
+
+	{
+		WorkerQueue& queue = *m_Queues[queueIndex];
+		std::lock_guard lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Pending++;
+	}
+	m_Condition.notify_one();
+}
+
+// Takes the newest task from the worker's own deque, or steals the oldest task from
+// another worker. Returns false if every deque is empty.
+bool ThreadPool::try_pop(uint32_t workerIndex, std::function<void()>& task)
+{
+	{
+		WorkerQueue& own = *m_Queues[workerIndex];
+		std::lock_guard lock(own.mutex);
+		if (!own.tasks.empty())
+		{
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+
+	for (uint32_t i = 1; i < thread_count(); i++)
+	{
+		WorkerQueue& victim = *m_Queues[(workerIndex + i) % thread_count()];
+		std::lock_guard lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Runs own and stolen tasks, sleeping while no work is queued, until the pool is stopped
+// and drained.
+void ThreadPool::worker_loop(uint32_t workerIndex)
+{
+	t_Pool = this;
+	t_WorkerIndex = workerIndex;
+
+	while (true)
+	{
+		std::function<void()> task;
+
+		if (try_pop(workerIndex, task))
+		{
+			{
+				std::lock_guard lock(m_Mutex);
+				m_Pending--;
+			}
+
+			task();
+			continue;
+		}
+
+		// A task counted in m_Pending may be mid-steal by another worker; in that case this
+		// wait returns immediately and the worker retries
+		std::unique_lock lock(m_Mutex);
+		m_Condition.wait(lock, [this]() { return m_Stopping || m_Pending > 0; });
+
+		if (m_Stopping && m_Pending == 0)
+			return;
+	}
+}
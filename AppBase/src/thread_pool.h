@@ -0,0 +1,76 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+// Fixed-size pool of worker threads executing queued tasks. Every worker owns a task deque:
+// tasks submitted from a worker go to its own deque and are popped LIFO for locality, tasks
+// submitted from other threads are spread round-robin, and idle workers steal the oldest
+// task from other deques so uneven workloads balance across cores.
+class ThreadPool
+{
+public:
+	explicit ThreadPool(uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency()));
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Queue a task and return a future for its result.
+	template<typename F>
+	auto submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+	{
+		using Result = std::invoke_result_t<std::decay_t<F>>;
+
+		// std::function requires copyable targets, so the packaged task is shared
+		auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+		std::future<Result> future = packagedTask->get_future();
+
+		enqueue([packagedTask]() { (*packagedTask)(); });
+
+		return future;
+	}
+
+	uint32_t thread_count() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+	// Index of the calling worker in [0, thread_count()), or thread_count() when called from
+	// a thread outside this pool.
+	uint32_t current_worker() const;
+
+private:
+	struct WorkerQueue
+	{
+		std::deque<std::function<void()>> tasks;
+		std::mutex mutex;
+	};
+
+	std::vector<std::thread> m_Workers;
+	std::vector<std::unique_ptr<WorkerQueue>> m_Queues;
+	std::atomic<uint32_t> m_NextQueue = 0;
+
+	// Sleeping workers wait on the condition until a task is queued
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	uint32_t m_Pending = 0;		// Tasks queued but not yet started, guarded by m_Mutex
+	bool m_Stopping = false;
+
+	static thread_local const ThreadPool* t_Pool;
+	static thread_local uint32_t t_WorkerIndex;
+
+private:
+	void enqueue(std::function<void()>&& task);
+	bool try_pop(uint32_t workerIndex, std::function<void()>& task);
+	void worker_loop(uint32_t workerIndex);
+};
+
+#endif
@@ -1,68 +1,231 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 #include <vulkan/vulkan.hpp>
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Packed attribute types
+// Storage types for quantized vertex data. Each one is built from full-precision glm values
+// on the CPU and expanded back to floats by the vertex fetch hardware, so shaders still
+// declare vec2/vec4 inputs.
+
+// Two 16-bit floats.
+struct Half2
+{
+    std::array<uint16_t, 2> value{};
+
+    Half2() = default;
+    explicit Half2(glm::vec2 v) : value{ glm::packHalf1x16(v.x), glm::packHalf1x16(v.y) } {}
+};
+
+// Four 16-bit floats.
+struct Half4
+{
+    std::array<uint16_t, 4> value{};
+
+    Half4() = default;
+    explicit Half4(glm::vec4 v)
+        : value{ glm::packHalf1x16(v.x), glm::packHalf1x16(v.y), glm::packHalf1x16(v.z), glm::packHalf1x16(v.w) } {}
+};
+
+// Two signed normalized 16-bit values in [-1, 1].
+struct Snorm16x2
+{
+    std::array<uint16_t, 2> value{};
+
+    Snorm16x2() = default;
+    explicit Snorm16x2(glm::vec2 v) : value{ glm::packSnorm1x16(v.x), glm::packSnorm1x16(v.y) } {}
+};
+
+// Four signed normalized 16-bit values in [-1, 1].
+struct Snorm16x4
+{
+    std::array<uint16_t, 4> value{};
+
+    Snorm16x4() = default;
+    explicit Snorm16x4(glm::vec4 v)
+        : value{ glm::packSnorm1x16(v.x), glm::packSnorm1x16(v.y), glm::packSnorm1x16(v.z), glm::packSnorm1x16(v.w) } {}
+};
+
+// Four signed normalized 8-bit values in [-1, 1], e.g. normals and tangents.
+struct Snorm8x4
+{
+    std::array<uint8_t, 4> value{};
+
+    Snorm8x4() = default;
+    explicit Snorm8x4(glm::vec4 v)
+        : value{ glm::packSnorm1x8(v.x), glm::packSnorm1x8(v.y), glm::packSnorm1x8(v.z), glm::packSnorm1x8(v.w) } {}
+};
+
+// Four unsigned normalized 8-bit values in [0, 1], e.g. RGBA8 colours.
+struct Unorm8x4
+{
+    std::array<uint8_t, 4> value{};
+
+    Unorm8x4() = default;
+    explicit Unorm8x4(glm::vec4 v)
+        : value{ glm::packUnorm1x8(v.x), glm::packUnorm1x8(v.y), glm::packUnorm1x8(v.z), glm::packUnorm1x8(v.w) } {}
+};
+
+// VertexAttributeTraits
+// Maps a C++ member type to its Vulkan vertex format. Matrices occupy one location per
+// column.
+template<typename T>
+struct VertexAttributeTraits;
+
+template<vk::Format F, uint32_t Locations = 1>
+struct VertexAttributeTraitsBase
+{
+    static constexpr vk::Format format = F;
+    static constexpr uint32_t locations = Locations;
+};
+
+template<> struct VertexAttributeTraits<float> : VertexAttributeTraitsBase<vk::Format::eR32Sfloat> {};
+template<> struct VertexAttributeTraits<glm::vec2> : VertexAttributeTraitsBase<vk::Format::eR32G32Sfloat> {};
+template<> struct VertexAttributeTraits<glm::vec3> : VertexAttributeTraitsBase<vk::Format::eR32G32B32Sfloat> {};
+template<> struct VertexAttributeTraits<glm::vec4> : VertexAttributeTraitsBase<vk::Format::eR32G32B32A32Sfloat> {};
+template<> struct VertexAttributeTraits<int32_t> : VertexAttributeTraitsBase<vk::Format::eR32Sint> {};
+template<> struct VertexAttributeTraits<glm::ivec2> : VertexAttributeTraitsBase<vk::Format::eR32G32Sint> {};
+template<> struct VertexAttributeTraits<glm::ivec3> : VertexAttributeTraitsBase<vk::Format::eR32G32B32Sint> {};
+template<> struct VertexAttributeTraits<glm::ivec4> : VertexAttributeTraitsBase<vk::Format::eR32G32B32A32Sint> {};
+template<> struct VertexAttributeTraits<uint32_t> : VertexAttributeTraitsBase<vk::Format::eR32Uint> {};
+template<> struct VertexAttributeTraits<glm::uvec2> : VertexAttributeTraitsBase<vk::Format::eR32G32Uint> {};
+template<> struct VertexAttributeTraits<glm::uvec3> : VertexAttributeTraitsBase<vk::Format::eR32G32B32Uint> {};
+template<> struct VertexAttributeTraits<glm::uvec4> : VertexAttributeTraitsBase<vk::Format::eR32G32B32A32Uint> {};
+template<> struct VertexAttributeTraits<glm::mat4> : VertexAttributeTraitsBase<vk::Format::eR32G32B32A32Sfloat, 4> {};
+template<> struct VertexAttributeTraits<Half2> : VertexAttributeTraitsBase<vk::Format::eR16G16Sfloat> {};
+template<> struct VertexAttributeTraits<Half4> : VertexAttributeTraitsBase<vk::Format::eR16G16B16A16Sfloat> {};
+template<> struct VertexAttributeTraits<Snorm16x2> : VertexAttributeTraitsBase<vk::Format::eR16G16Snorm> {};
+template<> struct VertexAttributeTraits<Snorm16x4> : VertexAttributeTraitsBase<vk::Format::eR16G16B16A16Snorm> {};
+template<> struct VertexAttributeTraits<Snorm8x4> : VertexAttributeTraitsBase<vk::Format::eR8G8B8A8Snorm> {};
+template<> struct VertexAttributeTraits<Unorm8x4> : VertexAttributeTraitsBase<vk::Format::eR8G8B8A8Unorm> {};
+
+// A single member of a vertex type, as listed by the type's attributes().
+struct VertexAttribute
+{
+    vk::Format format = vk::Format::eUndefined;
+    uint32_t offset = 0;
+    uint32_t locations = 1;         // Consecutive shader locations used by the member
+    uint32_t locationStride = 0;    // Byte distance between those locations
+};
+
+// Describes a member from its type and byte offset.
+template<typename T>
+consteval VertexAttribute make_vertex_attribute(size_t offset)
+{
+    using Traits = VertexAttributeTraits<std::remove_cv_t<T>>;
+    static_assert(sizeof(T) % Traits::locations == 0, "Attribute size must split evenly across its locations");
+
+    return VertexAttribute{
+        Traits::format,
+        static_cast<uint32_t>(offset),
+        Traits::locations,
+        static_cast<uint32_t>(sizeof(T) / Traits::locations)
+    };
+}
+
+// Lists a member of a standard-layout vertex type; the format is deduced from the member's type.
+#define VERTEX_ATTRIBUTE(Type, member) make_vertex_attribute<decltype(Type::member)>(offsetof(Type, member))
 
 // VertexFormat CRTP base class
-// Provides a static interface for derived vertex types to define their
-// Vulkan binding and attribute descriptions.
-template<typename Derived>
-class VertexFormat
+// Generates the Vulkan binding and attribute descriptions of one vertex buffer binding at
+// compile time. Derived types list their members in a static constexpr attributes()
+// function; attributes are assigned consecutive locations in list order.
+template<typename Derived, uint32_t BindingIndex = 0, vk::VertexInputRate Rate = vk::VertexInputRate::eVertex>
+struct VertexFormat
 {
-    // Returns the name of the vertex format (must be implemented by Derived)
-    static consteval std::string_view name() { return Derived::name(); }
+    static constexpr uint32_t Binding = BindingIndex;
+    static constexpr vk::VertexInputRate InputRate = Rate;
 
     // Returns the Vulkan binding description for this vertex format
-    static consteval vk::VertexInputBindingDescription get_binding_description();
+    static consteval vk::VertexInputBindingDescription get_binding_description()
+    {
+        return vk::VertexInputBindingDescription(Binding, sizeof(Derived), InputRate);
+    }
 
-    // Returns the Vulkan attribute descriptions for this vertex format
-    static consteval vk::VertexInputAttributeDescription get_attribute_description();
+    // Returns the number of shader locations used by this vertex format
+    static consteval uint32_t location_count()
+    {
+        uint32_t count = 0;
+        for (const VertexAttribute& attribute : Derived::attributes())
+            count += attribute.locations;
+        return count;
+    }
+
+    // Returns the Vulkan attribute descriptions for this vertex format, starting at location 0
+    static consteval auto get_attribute_descriptions()
+    {
+        std::array<vk::VertexInputAttributeDescription, location_count()> descriptions{};
+
+        uint32_t location = 0;
+        for (const VertexAttribute& attribute : Derived::attributes())
+        {
+            for (uint32_t i = 0; i < attribute.locations; i++, location++)
+            {
+                descriptions[location].binding = Binding;
+                descriptions[location].location = location;
+                descriptions[location].format = attribute.format;
+                descriptions[location].offset = attribute.offset + i * attribute.locationStride;
+            }
+        }
+
+        return descriptions;
+    }
 };
 
+// Satisfied by types deriving from VertexFormat with themselves as Derived.
+template<typename T>
+concept VertexFormatType = std::is_base_of_v<VertexFormat<T, T::Binding, T::InputRate>, T>;
+
 // Vertex2DColor
 // A simple 2D vertex with position and color attributes.
-// Inherits from VertexFormat for static interface.
 struct Vertex2DColor : VertexFormat<Vertex2DColor>
 {
     glm::vec2 position; // 2D position of the vertex
     glm::vec3 color;    // RGB color of the vertex
 
-    // Returns the Vulkan binding description for this vertex type.
-    // Describes how the vertex data is laid out in memory and how it is
-    // provided to the vertex shader.
-    static consteval vk::VertexInputBindingDescription get_binding_description()
+    static constexpr auto attributes()
     {
-        // binding: binding index in the shader (0 = first binding)
-        // stride: size of each vertex in bytes
-        // inputRate: per-vertex or per-instance data
-        vk::VertexInputBindingDescription bindingDescription(
-            0,                              // binding
-            sizeof(Vertex2DColor),          // stride
-            vk::VertexInputRate::eVertex    // inputRate
-        );
-
-        return bindingDescription;
+        return std::array{
+            VERTEX_ATTRIBUTE(Vertex2DColor, position),  // location 0
+            VERTEX_ATTRIBUTE(Vertex2DColor, color)      // location 1
+        };
     }
+};
 
-    // Returns the Vulkan attribute descriptions for this vertex type.
-    // Describes how to extract each attribute from the vertex data.
-    static consteval std::array<vk::VertexInputAttributeDescription, 2> get_attribute_description()
-    {
-        std::array<vk::VertexInputAttributeDescription, 2> attributeDescriptions{};
+// VertexPacked
+// A quantized 3D vertex: 24 bytes instead of the 48 of its full-precision equivalent.
+struct VertexPacked : VertexFormat<VertexPacked>
+{
+    glm::vec3 position; // Object-space position
+    Snorm8x4 normal;    // Unit normal in xyz
+    Half2 uv;           // Texture coordinates
+    Unorm8x4 color;     // RGBA8 vertex color
 
-        // Attribute 0: position (vec2)
-        attributeDescriptions[0].binding = 0;                              // binding index
-        attributeDescriptions[0].location = 0;                             // location in shader
-        attributeDescriptions[0].format = vk::Format::eR32G32Sfloat;       // format: 2x float
-        attributeDescriptions[0].offset = offsetof(Vertex2DColor, position); // offset in struct
+    static constexpr auto attributes()
+    {
+        return std::array{
+            VERTEX_ATTRIBUTE(VertexPacked, position),   // location 0
+            VERTEX_ATTRIBUTE(VertexPacked, normal),     // location 1
+            VERTEX_ATTRIBUTE(VertexPacked, uv),         // location 2
+            VERTEX_ATTRIBUTE(VertexPacked, color)       // location 3
+        };
+    }
+};
 
-        // Attribute 1: color (vec3)
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = vk::Format::eR32G32B32Sfloat;    // format: 3x float
-        attributeDescriptions[1].offset = offsetof(Vertex2DColor, color);
+// InstanceTransform
+// Per-instance model matrix on binding 1, for instanced draws alongside a vertex format on
+// binding 0. Occupies four locations, one per column.
+struct InstanceTransform : VertexFormat<InstanceTransform, 1, vk::VertexInputRate::eInstance>
+{
+    glm::mat4 model;
 
-        return attributeDescriptions;
+    static constexpr auto attributes()
+    {
+        return std::array{ VERTEX_ATTRIBUTE(InstanceTransform, model) };
     }
-};
\ No newline at end of file
+};
@@ -1,5 +1,76 @@
 #include "vulkan_app_base.h"
 
+namespace
+{
+	// Bytes per texel of the uncompressed color formats offscreen images can use, or 0.
+	uint32_t texel_size(vk::Format format)
+	{
+		switch (format)
+		{
+		case vk::Format::eR8Unorm:
+		case vk::Format::eR8Snorm:
+		case vk::Format::eR8Uint:
+		case vk::Format::eR8Sint:
+		case vk::Format::eR8Srgb:
+			return 1;
+		case vk::Format::eR8G8Unorm:
+		case vk::Format::eR8G8Snorm:
+		case vk::Format::eR8G8Uint:
+		case vk::Format::eR8G8Sint:
+		case vk::Format::eR8G8Srgb:
+		case vk::Format::eR16Unorm:
+		case vk::Format::eR16Snorm:
+		case vk::Format::eR16Uint:
+		case vk::Format::eR16Sint:
+		case vk::Format::eR16Sfloat:
+		case vk::Format::eR5G6B5UnormPack16:
+		case vk::Format::eB5G6R5UnormPack16:
+			return 2;
+		case vk::Format::eR8G8B8A8Unorm:
+		case vk::Format::eR8G8B8A8Snorm:
+		case vk::Format::eR8G8B8A8Uint:
+		case vk::Format::eR8G8B8A8Sint:
+		case vk::Format::eR8G8B8A8Srgb:
+		case vk::Format::eB8G8R8A8Unorm:
+		case vk::Format::eB8G8R8A8Snorm:
+		case vk::Format::eB8G8R8A8Uint:
+		case vk::Format::eB8G8R8A8Sint:
+		case vk::Format::eB8G8R8A8Srgb:
+		case vk::Format::eA8B8G8R8UnormPack32:
+		case vk::Format::eA8B8G8R8SrgbPack32:
+		case vk::Format::eA2R10G10B10UnormPack32:
+		case vk::Format::eA2B10G10R10UnormPack32:
+		case vk::Format::eA2B10G10R10UintPack32:
+		case vk::Format::eB10G11R11UfloatPack32:
+		case vk::Format::eE5B9G9R9UfloatPack32:
+		case vk::Format::eR16G16Unorm:
+		case vk::Format::eR16G16Snorm:
+		case vk::Format::eR16G16Uint:
+		case vk::Format::eR16G16Sint:
+		case vk::Format::eR16G16Sfloat:
+		case vk::Format::eR32Uint:
+		case vk::Format::eR32Sint:
+		case vk::Format::eR32Sfloat:
+			return 4;
+		case vk::Format::eR16G16B16A16Unorm:
+		case vk::Format::eR16G16B16A16Snorm:
+		case vk::Format::eR16G16B16A16Uint:
+		case vk::Format::eR16G16B16A16Sint:
+		case vk::Format::eR16G16B16A16Sfloat:
+		case vk::Format::eR32G32Uint:
+		case vk::Format::eR32G32Sint:
+		case vk::Format::eR32G32Sfloat:
+			return 8;
+		case vk::Format::eR32G32B32A32Uint:
+		case vk::Format::eR32G32B32A32Sint:
+		case vk::Format::eR32G32B32A32Sfloat:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+}
+
 VulkanAppBase::VulkanAppBase()
 	: m_Config{}
 {
@@ -35,39 +106,102 @@ void VulkanAppBase::init()
 	// Create Vulkan instance
 	create_instance();
 
-	// Create window and surface
-	create_window_and_surface();
+	// Create window and surface, unless rendering headless
+	if (!m_Config.headless)
+		create_window_and_surface();
 
 	// Create physical & logical devices
 	create_device();
 
+	// Create device memory allocator
+	m_Allocator.init(m_PhysicalDevice, m_Device, m_Config.memory_block_size, m_DeviceGroupSize);
+
+	// Load the pipeline cache from disk
+	m_PipelineCache.init(m_PhysicalDevice, m_Device, m_Config.pipeline_cache_path);
+	m_PipelineRegistry.init(m_Device, &m_PipelineCache, &m_ThreadPool, m_Config.pipeline_libraries);
+	m_ShaderLibrary.init(m_Device);
+
+	// Watch shaders for changes and rebuild the pipelines using them in the background
+	if (m_Config.shader_hot_reload)
+		m_ShaderWatcher.init(m_ShaderLibrary, m_PipelineRegistry, m_ThreadPool, m_Config.shader_watcher);
+
+	// Create the global descriptor set for bindless resource access
+	if (m_Config.enable_bindless)
+		m_Bindless.init(m_PhysicalDevice, m_Device, m_Config.bindless);
+
 	// Create device and swapchain
 	create_swapchain();
 
 	// Create command pools
 	create_command_pools();
 
-	// Create synchronization objects (semaphores and fences)
-	create_sync_objects();
+	// Create per-frame contexts (sync objects, command buffers, descriptor pools)
+	create_frame_contexts();
+	m_ParallelRecorder.init(m_Device, m_GraphicsIdx, m_FramesInFlight, m_ThreadPool);
+	m_ComputeScheduler.init(m_Device, m_ComputeIdx, m_ComputeQueue, m_FramesInFlight, m_ComputeIdx != m_GraphicsIdx, m_QueueMutex);
+
+	// Set up frame pacing
+	m_FramePacer.init(m_Device, m_Dispatch, m_Config.frame_pacing);
+
+	// Create per-frame GPU timestamp queries
+	if (m_Config.enable_gpu_profiler)
+		m_Profiler.init(m_PhysicalDevice, m_Device, m_GraphicsIdx, m_FramesInFlight, m_Config.gpu_profiler);
+
+	// Create staging ring for buffer uploads
+	create_staging_ring();
 }
 
 // Destroys and cleans up all Vulkan and window resources.
 void VulkanAppBase::destroy()
 {
+	// Let mesh loads running on the thread pool finish, as they use the allocator and staging ring
+	{
+		std::unique_lock lock(m_StreamMutex);
+		m_StreamsIdle.wait(lock, [this]() { return m_ActiveStreams == 0; });
+	}
+
 	// Wait until all GPU work is done before cleanup
 	m_Device.waitIdle();
 
-	// Destroy all synchronization primitives
-	for (auto& fence : m_InFlightFences) m_Device.destroyFence(fence);
-	for (auto& semaphore : m_ImageAvailableSemaphores) m_Device.destroySemaphore(semaphore);
-	for (auto& semaphore : m_RenderFinishedSemaphores) m_Device.destroySemaphore(semaphore);
+	// Destroy resources still awaiting deferred deletion, such as retired swapchains
+	m_DeletionQueue.flush_all();
+
+	// Free streamed meshes that were never destroyed, including those whose futures were dropped
+	if (!m_StreamedBuffers.empty())
+		spdlog::warn("Destroying {} buffers of streamed meshes that were not destroyed", m_StreamedBuffers.size());
+	while (!m_StreamedBuffers.empty())
+	{
+		AllocatedBuffer buffer = m_StreamedBuffers.begin()->second;
+		destroy_buffer(buffer);
+	}
+
+	// Destroy staging ring and its buffer
+	m_StagingRing.destroy();
+
+	// Stop reloading shaders, then destroy registered pipelines and save the pipeline cache to disk
+	m_ShaderWatcher.destroy();
+	m_PipelineRegistry.destroy();
+	m_PipelineCache.destroy();
+
+	// Destroy cached shader modules
+	m_ShaderLibrary.destroy();
+
+	// Destroy the global descriptor set
+	m_Bindless.destroy();
+
+	// Destroy per-frame sync objects, command pools and descriptor pools
+	m_Profiler.destroy();
+	m_ParallelRecorder.destroy();
+	m_ComputeScheduler.destroy();
+	destroy_frame_contexts();
 
 	// Destroy swapchain and related resources
 	destroy_swapchain();
 
 	// Destroy command pools
 	m_Device.destroyCommandPool(m_GraphicsCommandPool);
-	m_Device.destroyCommandPool(m_TransferCommandPool);
+	m_TransferCommandAllocator.destroy();
+	m_Device.destroyFence(m_CopyFence);
 
 	// Destroy image views and images
 	for (const auto& imageView : m_ImageViews)
@@ -84,26 +218,38 @@ void VulkanAppBase::destroy()
 	vk::DispatchLoaderDynamic dldi(m_Instance, vkGetInstanceProcAddr);
 	m_Instance.destroyDebugUtilsMessengerEXT(m_DebugMessenger, nullptr, dldi);
 
+	// Release device memory blocks
+	m_Allocator.destroy();
+
 	// Destroy logical device and Vulkan instance
 	m_Device.destroy();
 	m_Instance.destroy();
 
 	// Destroy window and terminate GLFW
-	glfwDestroyWindow(m_Window);
-	glfwTerminate();
+	if (m_Window)
+		glfwDestroyWindow(m_Window);
+
+	if (!m_Config.headless)
+		glfwTerminate();
 }
 
 // Creates the Vulkan instance using vk-bootstrap.
 void VulkanAppBase::create_instance()
 {
-	// Get required extensions from GLFW
-	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-	m_Config.instance_extensions.insert(
-		m_Config.instance_extensions.end(),
-		glfwExtensions,
-		glfwExtensions + glfwExtensionCount
-	);
+	// Get required extensions from GLFW (surface extensions are not needed headless)
+	if (!m_Config.headless)
+	{
+		if (!glfwInit())
+			error("Failed to initialize GLFW!");
+
+		uint32_t glfwExtensionCount = 0;
+		const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		m_Config.instance_extensions.insert(
+			m_Config.instance_extensions.end(),
+			glfwExtensions,
+			glfwExtensions + glfwExtensionCount
+		);
+	}
 
 	// Build the Vulkan instance with vk-bootstrap
 	vkb::InstanceBuilder instanceBuilder;
@@ -111,6 +257,7 @@ void VulkanAppBase::create_instance()
 		.set_app_version(m_Config.application_version)
 		.set_engine_name(m_Config.engine_name.c_str())
 		.set_engine_version(m_Config.engine_version)
+		.require_api_version(m_Config.api_version)
 		.enable_validation_layers(m_Config.enable_validation_layers)
 		.request_validation_layers(m_Config.enable_validation_layers)
 		.use_default_debug_messenger()
@@ -129,8 +276,11 @@ void VulkanAppBase::create_instance()
 // Selects a physical device and creates a logical device and queues.
 void VulkanAppBase::create_device()
 {
-	// Enable synchronization2 (required for Vulkan 1.3+)
-	vk::PhysicalDeviceSynchronization2FeaturesKHR synchronization2{ vk::True };
+	// Enable timeline semaphores (async uploads) and synchronization2 (barriers and queue submission)
+	m_Config.device_features_12.timelineSemaphore = vk::True;
+	m_Config.device_features_13.synchronization2 = vk::True;
+	if (m_Config.dynamic_rendering)
+		m_Config.device_features_13.dynamicRendering = vk::True;
 
 	// If no device features are specified, enable geometry shader by default
 	vk::PhysicalDeviceFeatures zeroFeatures{};
@@ -139,40 +289,172 @@ void VulkanAppBase::create_device()
 		m_Config.device_features.geometryShader = vk::True;
 	}
 
-	assert(m_Surface && "vk::SurfaceKHR has not been initialized!");
+	// Indirect draws with a GPU-side count and more than one draw per call. Opt-in, since
+	// requiring them rejects devices without drawIndirectCount
+	if (m_Config.indirect_draw)
+	{
+		m_Config.device_features.multiDrawIndirect = vk::True;
+		m_Config.device_features_12.drawIndirectCount = vk::True;
+	}
+
+	// Descriptor indexing (core since Vulkan 1.2) for the bindless descriptor set
+	if (m_Config.enable_bindless)
+	{
+		m_Config.device_features_12.descriptorIndexing = vk::True;
+		m_Config.device_features_12.runtimeDescriptorArray = vk::True;
+		m_Config.device_features_12.descriptorBindingPartiallyBound = vk::True;
+		m_Config.device_features_12.descriptorBindingUpdateUnusedWhilePending = vk::True;
+		m_Config.device_features_12.descriptorBindingStorageBufferUpdateAfterBind = vk::True;
+		m_Config.device_features_12.descriptorBindingSampledImageUpdateAfterBind = vk::True;
+		m_Config.device_features_12.descriptorBindingStorageImageUpdateAfterBind = vk::True;
+		m_Config.device_features_12.shaderStorageBufferArrayNonUniformIndexing = vk::True;
+		m_Config.device_features_12.shaderSampledImageArrayNonUniformIndexing = vk::True;
+		m_Config.device_features_12.shaderStorageImageArrayNonUniformIndexing = vk::True;
+	}
+
+	// Present IDs and present wait for frame pacing; there is nothing to present headless
+	if (m_Config.headless)
+		m_Config.frame_pacing.present_wait = false;
+
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR };
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR };
+	if (m_Config.frame_pacing.present_wait)
+	{
+		m_Config.device_extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+		m_Config.device_extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+		presentIdFeatures.presentId = VK_TRUE;
+		presentWaitFeatures.presentWait = VK_TRUE;
+	}
+
+	// Graphics pipeline libraries for fast-linked pipelines in the registry
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT };
+	if (m_Config.pipeline_libraries)
+	{
+		m_Config.device_extensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+		m_Config.device_extensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+		pipelineLibraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+	}
+
+	// Pipeline statistics queries for the GPU profiler. The query spans the whole frame, so
+	// secondary command buffers from record_parallel execute inside it and must inherit it
+	if (m_Config.enable_gpu_profiler && m_Config.gpu_profiler.pipelineStatistics)
+	{
+		m_Config.device_features.pipelineStatisticsQuery = vk::True;
+		m_Config.device_features.inheritedQueries = vk::True;
+	}
+
+	assert((m_Surface || m_Config.headless) && "vk::SurfaceKHR has not been initialized!");
+
+	// Headless devices need neither presentation support nor the swapchain extension
+	if (m_Config.headless)
+	{
+		std::erase_if(m_Config.device_extensions, [](const char* extension)
+		{
+			return strcmp(extension, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0;
+		});
+	}
 
 	// Select a physical device using vk-bootstrap
 	vkb::PhysicalDeviceSelector physicalDeviceSelector{ m_VkbInstance };
 	physicalDeviceSelector.add_required_extensions(m_Config.device_extensions)
-		.set_surface(m_Surface)
-		.set_required_features(m_Config.device_features);
+		.set_minimum_version(VK_API_VERSION_MAJOR(m_Config.api_version), VK_API_VERSION_MINOR(m_Config.api_version))
+		.require_present(!m_Config.headless)
+		.set_required_features(m_Config.device_features)
+		.set_required_features_12(m_Config.device_features_12)
+		.set_required_features_13(m_Config.device_features_13);
+
+	if (m_Surface)
+		physicalDeviceSelector.set_surface(m_Surface);
+
+	if (m_Config.frame_pacing.present_wait)
+	{
+		physicalDeviceSelector.add_required_extension_features(presentIdFeatures)
+			.add_required_extension_features(presentWaitFeatures);
+	}
 
-	auto physRet = physicalDeviceSelector.select();
-	if (!physRet)
-		error("Failed to select physical device: " + physRet.error().message());
+	if (m_Config.pipeline_libraries)
+		physicalDeviceSelector.add_required_extension_features(pipelineLibraryFeatures);
 
-	m_PhysicalDevice = physRet.value().physical_device;
+	auto devicesRet = physicalDeviceSelector.select_devices();
+	if (!devicesRet)
+		error("Failed to select physical device: " + devicesRet.error().message());
+
+	// Rank the suitable devices; the ranking is stable, so contexts created with different
+	// device indices always get different GPUs
+	std::vector<std::pair<uint64_t, vkb::PhysicalDevice>> rankedDevices;
+	for (const vkb::PhysicalDevice& device : devicesRet.value())
+		rankedDevices.emplace_back(score_physical_device(device.physical_device), device);
+	std::stable_sort(rankedDevices.begin(), rankedDevices.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+	m_SuitableDeviceCount = static_cast<uint32_t>(rankedDevices.size());
+	if (m_Config.device_index >= m_SuitableDeviceCount)
+		error("Device index " + std::to_string(m_Config.device_index) + " out of range, " + std::to_string(m_SuitableDeviceCount) + " suitable device(s)");
+
+	for (uint32_t i = 0; i < m_SuitableDeviceCount; i++)
+		spdlog::info("{} GPU {}: {} (score {:#x})", i == m_Config.device_index ? "*" : " ", i, rankedDevices[i].second.name, rankedDevices[i].first);
+
+	const vkb::PhysicalDevice& selectedDevice = rankedDevices[m_Config.device_index].second;
+	m_PhysicalDevice = selectedDevice.physical_device;
 
 	// Create logical device
-	vkb::DeviceBuilder deviceBuilder{ physRet.value() };
-	deviceBuilder.add_pNext(&synchronization2);
+	vkb::DeviceBuilder deviceBuilder{ selectedDevice };
+
+	// Span the device group containing the selected GPU, if it has other members
+	std::vector<vk::PhysicalDevice> groupDevices;
+	vk::DeviceGroupDeviceCreateInfo deviceGroupInfo{};
+	if (m_Config.device_group && !m_Config.headless)
+		spdlog::warn("Device groups are only supported headless, using a single GPU");
+	else if (m_Config.device_group)
+	{
+		for (const vk::PhysicalDeviceGroupProperties& group : m_Instance.enumeratePhysicalDeviceGroups())
+		{
+			auto first = group.physicalDevices.begin();
+			auto last = first + group.physicalDeviceCount;
+			if (group.physicalDeviceCount > 1 && std::find(first, last, m_PhysicalDevice) != last)
+				groupDevices.assign(first, last);
+		}
+
+		if (groupDevices.empty())
+		{
+			spdlog::warn("{} is not part of a device group, using a single GPU", selectedDevice.name);
+		}
+		else
+		{
+			deviceGroupInfo.setPhysicalDevices(groupDevices);
+			deviceBuilder.add_pNext(&deviceGroupInfo);
+			m_DeviceGroupSize = static_cast<uint32_t>(groupDevices.size());
+			spdlog::info("Device group of {} GPUs, split-frame rendering enabled", m_DeviceGroupSize);
+		}
+	}
 
 	auto deviceRet = deviceBuilder.build();
 	if (!deviceRet)
 		error("Failed to create logical device: " + deviceRet.error().message());
 
 	m_Device = deviceRet.value().device;
+	m_Dispatch.init(m_Instance, vkGetInstanceProcAddr, m_Device, vkGetDeviceProcAddr);
 
 	// Retrieve queue handles and indices
-	auto presentQueueRet = deviceRet.value().get_queue(vkb::QueueType::present);
-	m_PresentIdx = deviceRet.value().get_queue_index(vkb::QueueType::present).value();
-	if (!presentQueueRet)
-		error("Failed to get presentation queue: " + presentQueueRet.error().message());
-
 	auto graphicsQueueRet = deviceRet.value().get_queue(vkb::QueueType::graphics);
-	m_GraphicsIdx = deviceRet.value().get_queue_index(vkb::QueueType::graphics).value();
 	if (!graphicsQueueRet)
 		error("Failed to get graphics queue: " + graphicsQueueRet.error().message());
+	m_GraphicsIdx = deviceRet.value().get_queue_index(vkb::QueueType::graphics).value();
+
+	// Headless rendering never presents, so the graphics queue stands in for the present queue
+	if (m_Config.headless)
+	{
+		m_PresentIdx = m_GraphicsIdx;
+		m_PresentQueue = graphicsQueueRet.value();
+	}
+	else
+	{
+		auto presentQueueRet = deviceRet.value().get_queue(vkb::QueueType::present);
+		if (!presentQueueRet)
+			error("Failed to get presentation queue: " + presentQueueRet.error().message());
+
+		m_PresentIdx = deviceRet.value().get_queue_index(vkb::QueueType::present).value();
+		m_PresentQueue = presentQueueRet.value();
+	}
 
 	// Attempt to get a dedicated transfer queue, fallback to graphics (implicit transfer functionality) if unavailable
 	auto transferQueueRet = deviceRet.value().get_dedicated_queue(vkb::QueueType::transfer);
@@ -187,8 +469,62 @@ void VulkanAppBase::create_device()
 		m_TransferQueue = transferQueueRet.value();
 	}
 
-	m_PresentQueue = presentQueueRet.value();
 	m_GraphicsQueue = graphicsQueueRet.value();
+
+	// Prefer a compute-only family for async compute, then any family without graphics, and
+	// fall back to the graphics queue so compute submissions still work
+	m_ComputeIdx = m_GraphicsIdx;
+	m_ComputeQueue = m_GraphicsQueue;
+	if (m_Config.async_compute)
+	{
+		auto computeQueueRet = deviceRet.value().get_dedicated_queue(vkb::QueueType::compute);
+		if (computeQueueRet)
+		{
+			m_ComputeIdx = deviceRet.value().get_dedicated_queue_index(vkb::QueueType::compute).value();
+			m_ComputeQueue = computeQueueRet.value();
+		}
+		else if (auto separateQueueRet = deviceRet.value().get_queue(vkb::QueueType::compute))
+		{
+			m_ComputeIdx = deviceRet.value().get_queue_index(vkb::QueueType::compute).value();
+			m_ComputeQueue = separateQueueRet.value();
+		}
+	}
+}
+
+// Device type dominates the score, then the largest device-local heap in MiB, then one bit
+// each for a compute-only and a transfer-only queue family.
+uint64_t VulkanAppBase::score_physical_device(vk::PhysicalDevice physicalDevice) const
+{
+	uint64_t typeRank = 0;
+	switch (physicalDevice.getProperties().deviceType)
+	{
+	case vk::PhysicalDeviceType::eDiscreteGpu:		typeRank = 4; break;
+	case vk::PhysicalDeviceType::eIntegratedGpu:	typeRank = 3; break;
+	case vk::PhysicalDeviceType::eVirtualGpu:		typeRank = 2; break;
+	case vk::PhysicalDeviceType::eCpu:				typeRank = 1; break;
+	default:										break;
+	}
+
+	vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+	vk::DeviceSize deviceLocalSize = 0;
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+	{
+		if (memoryProperties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal)
+			deviceLocalSize = std::max(deviceLocalSize, memoryProperties.memoryHeaps[i].size);
+	}
+	uint64_t vramMiB = std::min<uint64_t>(deviceLocalSize / (1024 * 1024), UINT32_MAX);
+
+	uint64_t queueRank = 0;
+	for (const vk::QueueFamilyProperties& family : physicalDevice.getQueueFamilyProperties())
+	{
+		using Queue = vk::QueueFlagBits;
+		if ((family.queueFlags & Queue::eCompute) && !(family.queueFlags & Queue::eGraphics))
+			queueRank |= 2;
+		if ((family.queueFlags & Queue::eTransfer) && !(family.queueFlags & (Queue::eGraphics | Queue::eCompute)))
+			queueRank |= 1;
+	}
+
+	return typeRank << 40 | vramMiB << 8 | queueRank;
 }
 
 // Creates the GLFW window and Vulkan surface.
@@ -223,7 +559,7 @@ void VulkanAppBase::create_swapchain()
 {
 	SwapchainConfig swapConfig{
 			.format = vk::SurfaceFormatKHR(vk::Format::eB8G8R8A8Srgb, vk::ColorSpaceKHR::eSrgbNonlinear),
-			.presentMode = vk::PresentModeKHR::eMailbox,
+			.presentMode = m_Config.present_mode,
 			.usage = vk::ImageUsageFlagBits::eColorAttachment
 	};
 
@@ -237,8 +573,18 @@ void VulkanAppBase::create_swapchain(const SwapchainConfig& swapConfig)
 
 	m_SwapConfig = swapConfig;
 
+	if (m_Config.headless)
+	{
+		create_offscreen_images();
+		return;
+	}
+
 	vkb::SwapchainBuilder swapBuilder{ m_PhysicalDevice, m_Device, m_Surface, m_GraphicsIdx, m_PresentIdx };
 
+	// When recreating, hand the current swapchain over so the driver can reuse its resources
+	// and images already queued for presentation stay valid
+	swapBuilder.set_old_swapchain(m_Swapchain);
+
 	int width, height;
 	glfwGetFramebufferSize(m_Window, &width, &height);
 
@@ -264,11 +610,25 @@ void VulkanAppBase::create_swapchain(const SwapchainConfig& swapConfig)
 
 	m_SwapExtent = swapRet.value().extent;
 	m_SwapFormat = static_cast<vk::Format>(swapRet.value().image_format);
+
+	if (swapRet.value().present_mode != static_cast<VkPresentModeKHR>(swapConfig.presentMode))
+	{
+		spdlog::warn("Present mode {} unsupported, using {}", vk::to_string(swapConfig.presentMode),
+			vk::to_string(static_cast<vk::PresentModeKHR>(swapRet.value().present_mode)));
+	}
 }
 
-// Recreates the swapchain and framebuffers, e.g., after a window resize.
+// Recreates the swapchain and its image views, e.g., after a window resize. The device is not
+// idled: the retired swapchain is passed as oldSwapchain and destroyed once every frame that
+// may still reference it has completed.
 void VulkanAppBase::recreate_swapchain()
 {
+	if (m_Config.headless)
+	{
+		recreate_offscreen_images();
+		return;
+	}
+
 	// Pause application while minimized
 	int width = 0, height = 0;
 	glfwGetFramebufferSize(m_Window, &width, &height);
@@ -278,12 +638,22 @@ void VulkanAppBase::recreate_swapchain()
 		glfwWaitEvents();
 	}
 
-	m_Device.waitIdle();
-
-	// Destroy previous swapchain before recreation
-	destroy_swapchain();
+	vk::SwapchainKHR oldSwapchain = m_Swapchain;
+	std::vector<vk::ImageView> oldImageViews = std::move(m_ImageViews);
+	m_ImageViews.clear();
+	m_Images.clear();
 
 	create_swapchain(m_SwapConfig);
+	m_FramePacer.on_swapchain_recreated();
+
+	// The current frame is the last one that may have used the old swapchain
+	m_DeletionQueue.push(m_FrameNumber, [device = m_Device, oldSwapchain, oldImageViews]()
+	{
+		for (const auto& imageView : oldImageViews)
+			device.destroyImageView(imageView);
+
+		device.destroySwapchainKHR(oldSwapchain);
+	});
 }
 
 // Destroys the swapchain and associated resources.
@@ -293,11 +663,116 @@ void VulkanAppBase::destroy_swapchain()
 	for (const auto& imageView : m_ImageViews)
 		m_Device.destroyImageView(imageView);
 
+	// Offscreen images are owned by the application, swapchain images by the swapchain
+	for (size_t i = 0; i < m_OffscreenAllocations.size(); i++)
+	{
+		m_Device.destroyImage(m_Images[i]);
+		m_Allocator.free(m_OffscreenAllocations[i]);
+	}
+
 	// Clear images and views
 	m_ImageViews.clear();
 	m_Images.clear();
+	m_OffscreenAllocations.clear();
 
-	m_Device.destroySwapchainKHR(m_Swapchain);
+	if (m_Swapchain)
+		m_Device.destroySwapchainKHR(m_Swapchain);
+}
+
+// Creates the headless image ring, one color image per frame in flight, standing in for the
+// swapchain images. Frame N renders into image N % frames_in_flight, so an image is reused
+// only after the fence of the frame that last wrote it has signaled.
+void VulkanAppBase::create_offscreen_images()
+{
+	m_SwapExtent = vk::Extent2D(static_cast<uint32_t>(m_Config.window_width), static_cast<uint32_t>(m_Config.window_height));
+	m_SwapFormat = m_Config.headless_format;
+
+	// Readbacks are sized from the texel size, so only formats with a known one are accepted
+	if (texel_size(m_SwapFormat) == 0)
+		error("Unsupported headless format " + vk::to_string(m_SwapFormat) + ", use an uncompressed color format");
+
+	uint32_t imageCount = std::max(1u, m_Config.frames_in_flight);
+	vk::ImageUsageFlags usage = m_SwapConfig.usage | vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
+
+	for (uint32_t i = 0; i < imageCount; i++)
+	{
+		vk::ImageCreateInfo imageInfo(
+			{},
+			vk::ImageType::e2D,
+			m_SwapFormat,
+			vk::Extent3D(m_SwapExtent, 1),
+			1, 1,
+			vk::SampleCountFlagBits::e1,
+			vk::ImageTiling::eOptimal,
+			usage,
+			vk::SharingMode::eExclusive
+		);
+
+		vk::Image image = m_Device.createImage(imageInfo);
+		vk::MemoryRequirements memReqs = m_Device.getImageMemoryRequirements(image);
+
+		uint32_t memTypeIndex = find_memory_type(memReqs.memoryTypeBits, MemoryUsage::GpuOnly);
+		Allocation allocation = m_Allocator.allocate(memReqs, memTypeIndex, AllocationKind::Optimal);
+		m_Device.bindImageMemory(image, allocation.memory, allocation.offset);
+
+		vk::ImageViewCreateInfo viewInfo(
+			{},
+			image,
+			vk::ImageViewType::e2D,
+			m_SwapFormat,
+			{},
+			vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
+		);
+
+		m_Images.push_back(image);
+		m_ImageViews.push_back(m_Device.createImageView(viewInfo));
+		m_OffscreenAllocations.push_back(allocation);
+	}
+}
+
+// Rebuilds the offscreen images and readback buffers together at the configured window size.
+// Frames in flight are waited for first, and their readbacks delivered at the old size.
+void VulkanAppBase::recreate_offscreen_images()
+{
+	flush_readbacks();
+
+	std::vector<vk::Fence> fences;
+	for (const FrameContext& frame : m_Frames)
+		fences.push_back(frame.inFlight);
+
+	auto fenceResult = m_Device.waitForFences(fences, vk::True, UINT64_MAX);
+	if (fenceResult != vk::Result::eSuccess)
+		error("Fence operation failed!");
+
+	destroy_swapchain();
+	create_offscreen_images();
+
+	for (FrameContext& frame : m_Frames)
+	{
+		if (frame.readbackBuffer.buffer)
+			destroy_buffer(frame.readbackBuffer);
+		create_readback_buffer(frame);
+	}
+}
+
+// Requests a new present mode. Recreation is deferred to the end of the frame so it goes
+// through the same non-blocking path as a resize.
+void VulkanAppBase::set_present_mode(vk::PresentModeKHR presentMode)
+{
+	if (presentMode == m_SwapConfig.presentMode)
+		return;
+
+	m_SwapConfig.presentMode = presentMode;
+	m_SwapchainOutdated = true;
+}
+
+// Returns the present modes the surface supports, none when headless as there is no surface.
+std::vector<vk::PresentModeKHR> VulkanAppBase::get_supported_present_modes() const
+{
+	if (m_Config.headless)
+		return {};
+
+	return m_PhysicalDevice.getSurfacePresentModesKHR(m_Surface);
 }
 
 // Creates command pools for graphics and transfer operations.
@@ -310,37 +785,502 @@ void VulkanAppBase::create_command_pools()
 	);
 	m_GraphicsCommandPool = m_Device.createCommandPool(graphicsPoolInfo);
 
-	vk::CommandPoolCreateInfo transferPoolInfo(
-		vk::CommandPoolCreateFlagBits::eTransient, m_TransferIdx
-	);
-	m_TransferCommandPool = m_Device.createCommandPool(transferPoolInfo);
+	// Recycled command buffer and fence for synchronous copies on the transfer queue
+	m_TransferCommandAllocator.init(m_Device, m_TransferIdx);
+	m_CopyFence = m_Device.createFence({});
 }
 
-// Creates synchronization primitives (semaphores and fences) for each frame in flight.
-// These are used to coordinate rendering and presentation between the CPU and GPU.
-void VulkanAppBase::create_sync_objects()
+// Creates one frame context per frame in flight. Each context owns the semaphores, fence,
+// command pool and descriptor pool used while recording and submitting that frame.
+void VulkanAppBase::create_frame_contexts()
 {
 	assert(m_Device && "vk::Device must be initialized!");
 
-	// Create info structures for semaphores and fences.
+	m_FramesInFlight = std::max(1u, m_Config.frames_in_flight);
+	m_Frames.resize(m_FramesInFlight);
+
 	vk::SemaphoreCreateInfo semaphoreInfo{};
 	// Fences are created in the signaled state so the first frame can be rendered immediately.
 	vk::FenceCreateInfo fenceInfo(vk::FenceCreateFlagBits::eSignaled);
 
-	// Resize the vectors to hold one set of sync objects per frame in flight.
-	m_ImageAvailableSemaphores.resize(m_FramesInFlight);
-	m_RenderFinishedSemaphores.resize(m_FramesInFlight);
-	m_InFlightFences.resize(m_FramesInFlight);
+	vk::DescriptorPoolCreateInfo descriptorPoolInfo({}, m_Config.frame_descriptor_sets, m_Config.frame_descriptor_pool_sizes);
+
+	// Every slice of the frame data buffer may be bound as a uniform or storage buffer
+	vk::PhysicalDeviceLimits limits = m_PhysicalDevice.getProperties().limits;
+	vk::DeviceSize frameDataAlignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+	vk::DeviceSize frameDataSize = (m_Config.frame_allocator_size + frameDataAlignment - 1) / frameDataAlignment * frameDataAlignment;
+
+	if (frameDataSize > 0)
+	{
+		m_FrameDataBuffer = create_buffer(
+			frameDataSize * m_FramesInFlight,
+			vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer
+				| vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer,
+			MemoryUsage::Dynamic,
+			vk::SharingMode::eExclusive,
+			{ m_GraphicsIdx }
+		);
+	}
+
+	for (uint32_t i = 0; i < m_FramesInFlight; i++)
+	{
+		FrameContext& frame = m_Frames[i];
+
+		if (m_FrameDataBuffer.buffer)
+			frame.frameAllocator.init(m_FrameDataBuffer.buffer, m_FrameDataBuffer.allocation.mapped, i * frameDataSize, frameDataSize, frameDataAlignment);
+
+		frame.imageAvailable = m_Device.createSemaphore(semaphoreInfo);
+		frame.renderFinished = m_Device.createSemaphore(semaphoreInfo);
+		frame.inFlight = m_Device.createFence(fenceInfo);
+
+		frame.commandAllocator.init(m_Device, m_GraphicsIdx);
+
+		if (!m_Config.frame_descriptor_pool_sizes.empty())
+			frame.descriptorPool = m_Device.createDescriptorPool(descriptorPoolInfo);
+
+		create_readback_buffer(frame);
+	}
+}
+
+// Headless mode: creates the frame's host-visible buffer for one whole offscreen image. One
+// readback buffer per frame in flight keeps readbacks pipelined with rendering.
+void VulkanAppBase::create_readback_buffer(FrameContext& frame)
+{
+	if (!m_Config.headless || !m_Config.headless_readback)
+		return;
+
+	frame.readbackBuffer = create_buffer(
+		static_cast<vk::DeviceSize>(m_SwapExtent.width) * m_SwapExtent.height * texel_size(m_SwapFormat),
+		vk::BufferUsageFlagBits::eTransferDst,
+		MemoryUsage::Readback,
+		vk::SharingMode::eExclusive,
+		{ m_GraphicsIdx }
+	);
+}
+
+// Destroys every frame context. The device must be idle.
+void VulkanAppBase::destroy_frame_contexts()
+{
+	for (auto& frame : m_Frames)
+	{
+		if (frame.descriptorPool)
+			m_Device.destroyDescriptorPool(frame.descriptorPool);
+
+		if (frame.readbackBuffer.buffer)
+			destroy_buffer(frame.readbackBuffer);
+
+		frame.commandAllocator.destroy();
+		m_Device.destroyFence(frame.inFlight);
+		m_Device.destroySemaphore(frame.renderFinished);
+		m_Device.destroySemaphore(frame.imageAvailable);
+	}
+
+	m_Frames.clear();
+
+	if (m_FrameDataBuffer.buffer)
+		destroy_buffer(m_FrameDataBuffer);
+}
+
+// Creates the persistently mapped staging ring used for uploads on the transfer queue.
+void VulkanAppBase::create_staging_ring()
+{
+	assert(m_Device && "vk::Device must be initialized!");
+
+	AllocatedBuffer ringBuffer = create_buffer(
+		m_Config.staging_ring_size,
+		vk::BufferUsageFlagBits::eTransferSrc,
+		MemoryUsage::Staging,
+		vk::SharingMode::eExclusive,
+		{ m_TransferIdx }
+	);
+
+	m_StagingRing.init(m_Device, m_Allocator, ringBuffer, m_TransferIdx, m_TransferQueue, m_GraphicsIdx, m_QueueMutex, m_ComputeScheduler.graphics_timeline());
+}
+
+// Renders and presents one frame. The graphics submission acquires ownership of, and
+// waits on the timeline semaphore for, every upload flushed since the previous frame.
+void VulkanAppBase::draw_frame()
+{
+	FrameContext& frame = current_frame();
+
+	// Hold the frame back until older presents reach the display and the target frame time has passed
+	m_FramePacer.wait_for_next_frame(m_Swapchain);
+
+	// CPU frame time is measured between consecutive frame starts
+	auto frameStart = std::chrono::steady_clock::now();
+	if (m_FrameNumber > 0)
+		m_Profiler.record_cpu_frame(std::chrono::duration<double, std::milli>(frameStart - m_LastFrameStart).count());
+	m_LastFrameStart = frameStart;
+
+	auto fenceResult = m_Device.waitForFences(frame.inFlight, vk::True, UINT64_MAX);
+	if (fenceResult != vk::Result::eSuccess)
+		error("Fence operation failed!");
+
+	// This slot's fence was last signaled by frame (m_FrameNumber - m_FramesInFlight), so that
+	// frame and every one before it has completed
+	if (m_FrameNumber >= static_cast<uint64_t>(m_FramesInFlight))
+	{
+		m_DeletionQueue.flush(m_FrameNumber - m_FramesInFlight);
+		m_Bindless.collect(m_FrameNumber - m_FramesInFlight);
+	}
+
+	// Pipelines finished in the background (optimized links, shader reloads) replace the
+	// current ones before this frame records; the old ones may still be used by frames in flight
+	m_PipelineRegistry.update(m_DeletionQueue, m_FrameNumber);
+
+	// Recycle the secondary command buffers recorded for this frame last time around
+	m_ParallelRecorder.begin_frame(m_CurrentFrame);
+	m_ComputeScheduler.begin_frame(m_CurrentFrame);
+
+	// The frame that last used this context has finished, so its pixels can be read
+	if (frame.readbackPending)
+	{
+		frame.readbackPending = false;
+		on_readback(frame.readbackFrame, frame.readbackBuffer.allocation.mapped, frame.readbackBuffer.allocation.size);
+	}
+
+	// Headless frames render into the offscreen image owned by this frame context
+	uint32_t imageIdx = m_CurrentFrame;
+	if (!m_Config.headless)
+	{
+		try
+		{
+			auto acquireResult = m_Device.acquireNextImageKHR(m_Swapchain, UINT64_MAX, frame.imageAvailable, {});
+			imageIdx = acquireResult.value;
+		}
+		catch (const vk::OutOfDateKHRError&)
+		{
+			// Swapchain no longer matches the surface, recreate and skip this frame
+			recreate_swapchain();
+			return;
+		}
+	}
+
+	// Only reset the fence once work is guaranteed to be submitted with it
+	m_Device.resetFences(frame.inFlight);
+
+	// Descriptor sets from this frame's last use are no longer referenced by the GPU
+	if (frame.descriptorPool)
+		m_Device.resetDescriptorPool(frame.descriptorPool);
+
+	// Nor is the dynamic data written for it
+	frame.frameAllocator.reset();
+
+	// Reset the frame's whole command pool at once and take its recycled primary buffer
+	frame.commandAllocator.reset();
+	frame.commandBuffer = frame.commandAllocator.allocate();
+
+	vk::CommandBuffer commandBuffer = frame.commandBuffer;
+
+	vk::CommandBufferBeginInfo beginInfo({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+	commandBuffer.begin(beginInfo);
+
+	// Collect this frame slot's previous GPU timings and start timing the frame
+	m_Profiler.begin_frame(m_CurrentFrame, commandBuffer);
+
+	// Bindless resources stay bound for the whole frame; secondary command buffers must bind them again
+	if (m_Config.enable_bindless)
+	{
+		m_Bindless.bind(commandBuffer, vk::PipelineBindPoint::eGraphics);
+		m_Bindless.bind(commandBuffer, vk::PipelineBindPoint::eCompute);
+	}
+
+	// Take ownership of uploaded buffers before any of the frame's commands use them
+	std::vector<vk::SemaphoreSubmitInfo> waitInfos;
+	if (!m_Config.headless)
+		waitInfos.emplace_back(frame.imageAvailable, 0, vk::PipelineStageFlagBits2::eColorAttachmentOutput);
+
+	if (auto uploadWait = m_StagingRing.acquire(commandBuffer))
+		waitInfos.push_back(*uploadWait);
+
+	record_command_buffer(commandBuffer, imageIdx);
+
+	if (frame.readbackBuffer.buffer)
+		record_readback(commandBuffer, imageIdx, frame);
+
+	m_Profiler.end_frame(commandBuffer);
+	commandBuffer.end();
+
+	vk::CommandBufferSubmitInfo commandBufferInfo(commandBuffer);
+	std::vector<vk::SemaphoreSubmitInfo> signalInfos;
+	if (!m_Config.headless)
+		signalInfos.emplace_back(frame.renderFinished, 0, vk::PipelineStageFlagBits2::eAllCommands);
+
+	// Wait for the async compute results this frame consumes and advance the graphics timeline
+	m_ComputeScheduler.prepare_graphics_submit(waitInfos, signalInfos, m_FrameNumber + 1);
+
+	vk::SubmitInfo2 submitInfo{};
+	submitInfo.setWaitSemaphoreInfos(waitInfos);
+	submitInfo.setCommandBufferInfos(commandBufferInfo);
+	submitInfo.setSignalSemaphoreInfos(signalInfos);
+	{
+		std::lock_guard lock(m_QueueMutex);
+		m_GraphicsQueue.submit2(submitInfo, frame.inFlight);
+	}
+	m_StagingRing.graphics_submitted(m_FrameNumber + 1);
+
+	if (m_Config.headless)
+	{
+		m_CurrentFrame = (m_CurrentFrame + 1) % m_FramesInFlight;
+		m_FrameNumber++;
+		return;
+	}
+
+	vk::PresentInfoKHR presentInfo(frame.renderFinished, m_Swapchain, imageIdx);
+
+	// Tag the present so the pacer can wait for it to reach the display
+	uint64_t presentId = m_FramePacer.next_present_id();
+	vk::PresentIdKHR presentIdInfo(1, &presentId);
+	if (presentId != 0)
+		presentInfo.pNext = &presentIdInfo;
+
+	bool outOfDate = false;
+	try
+	{
+		std::lock_guard lock(m_QueueMutex);
+		outOfDate = m_PresentQueue.presentKHR(presentInfo) == vk::Result::eSuboptimalKHR;
+	}
+	catch (const vk::OutOfDateKHRError&)
+	{
+		outOfDate = true;
+	}
+
+	// Recreate swapchain if out-of-date, suboptimal, resized or reconfigured
+	if (outOfDate || m_FramebufferResized || m_SwapchainOutdated)
+	{
+		m_FramebufferResized = false;
+		m_SwapchainOutdated = false;
+		recreate_swapchain();
+	}
+
+	m_CurrentFrame = (m_CurrentFrame + 1) % m_FramesInFlight;
+	m_FrameNumber++;
+}
+
+// Transitions a swapchain image to a color attachment and begins dynamic rendering into it,
+// clearing it to the given color.
+void VulkanAppBase::begin_rendering(vk::CommandBuffer commandBuffer, uint32_t imageIdx, const vk::ClearColorValue& clearColor, vk::RenderingFlags flags)
+{
+	assert(m_Config.dynamic_rendering && "Dynamic rendering is disabled in AppConfig!");
+
+	// The source stage matches the image-available semaphore wait, so the transition
+	// happens after presentation has released the image
+	vk::ImageMemoryBarrier2 toAttachment(
+		vk::PipelineStageFlagBits2::eColorAttachmentOutput, vk::AccessFlagBits2::eNone,
+		vk::PipelineStageFlagBits2::eColorAttachmentOutput, vk::AccessFlagBits2::eColorAttachmentWrite,
+		vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal,
+		VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+		m_Images[imageIdx],
+		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
+	);
+
+	vk::DependencyInfo dependencyInfo{};
+	dependencyInfo.setImageMemoryBarriers(toAttachment);
+	commandBuffer.pipelineBarrier2(dependencyInfo);
+
+	vk::RenderingAttachmentInfo colorAttachment{};
+	colorAttachment.imageView = m_ImageViews[imageIdx];
+	colorAttachment.imageLayout = vk::ImageLayout::eColorAttachmentOptimal;
+	colorAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+	colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+	colorAttachment.clearValue = vk::ClearValue(clearColor);
+
+	vk::RenderingInfo renderingInfo{};
+	renderingInfo.flags = flags;
+	renderingInfo.renderArea = vk::Rect2D({ 0, 0 }, m_SwapExtent);
+	renderingInfo.layerCount = 1;
+	renderingInfo.setColorAttachments(colorAttachment);
+
+	// Each GPU of a device group renders only its own strip of the frame
+	std::vector<vk::Rect2D> deviceAreas;
+	vk::DeviceGroupRenderPassBeginInfo deviceGroupInfo{};
+	if (m_DeviceGroupSize > 1)
+	{
+		deviceAreas = split_frame_areas();
+		deviceGroupInfo.deviceMask = device_mask();
+		deviceGroupInfo.setDeviceRenderAreas(deviceAreas);
+		renderingInfo.pNext = &deviceGroupInfo;
+	}
+
+	commandBuffer.beginRendering(renderingInfo);
+}
+
+// Ends dynamic rendering and transitions the swapchain image for presentation, or the
+// offscreen image for readback in headless mode.
+void VulkanAppBase::end_rendering(vk::CommandBuffer commandBuffer, uint32_t imageIdx)
+{
+	commandBuffer.endRendering();
+
+	// Headless images are copied to the readback buffer instead of presented
+	bool readback = m_Config.headless;
+
+	vk::ImageMemoryBarrier2 toPresent(
+		vk::PipelineStageFlagBits2::eColorAttachmentOutput, vk::AccessFlagBits2::eColorAttachmentWrite,
+		readback ? vk::PipelineStageFlagBits2::eCopy : vk::PipelineStageFlagBits2::eNone,
+		readback ? vk::AccessFlagBits2::eTransferRead : vk::AccessFlagBits2::eNone,
+		vk::ImageLayout::eColorAttachmentOptimal,
+		readback ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR,
+		VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+		m_Images[imageIdx],
+		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
+	);
+
+	vk::DependencyInfo dependencyInfo{};
+	dependencyInfo.setImageMemoryBarriers(toPresent);
+	commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+// Records items across the thread pool into secondary command buffers that inherit the
+// swapchain rendering state. Secondaries don't inherit dynamic state, so recordFn must set
+// viewport and scissor itself.
+void VulkanAppBase::record_parallel(vk::CommandBuffer commandBuffer, uint32_t itemCount, uint32_t itemsPerTask, const ParallelRecorder::RecordFunction& recordFn)
+{
+	vk::CommandBufferInheritanceRenderingInfo renderingInfo({}, 0, m_SwapFormat);
+
+	vk::CommandBufferInheritanceInfo inheritance{};
+	inheritance.pNext = &renderingInfo;
+	inheritance.pipelineStatistics = m_Profiler.active_statistics();
+
+	m_ParallelRecorder.record(commandBuffer, inheritance, itemCount, itemsPerTask, recordFn);
+}
+
+// Splits the frame into horizontal strips of near-equal height, one per GPU in the group.
+std::vector<vk::Rect2D> VulkanAppBase::split_frame_areas() const
+{
+	std::vector<vk::Rect2D> areas;
+	for (uint32_t i = 0; i < m_DeviceGroupSize; i++)
+	{
+		uint32_t top = m_SwapExtent.height * i / m_DeviceGroupSize;
+		uint32_t bottom = m_SwapExtent.height * (i + 1) / m_DeviceGroupSize;
+		areas.emplace_back(vk::Offset2D(0, static_cast<int32_t>(top)), vk::Extent2D(m_SwapExtent.width, bottom - top));
+	}
+	return areas;
+}
+
+// Lets the graph allocate its transient resources from the app's allocator.
+void VulkanAppBase::init_render_graph(RenderGraph& graph)
+{
+	graph.init(m_Device, m_Allocator);
+}
+
+// Imports the swapchain image. Like begin_rendering, the graph's first barrier waits on the
+// color attachment output stage the image-available semaphore is waited on.
+RenderGraphResource VulkanAppBase::import_swapchain_image(RenderGraph& graph)
+{
+	ResourceUsage acquired{ vk::PipelineStageFlagBits2::eColorAttachmentOutput, vk::AccessFlagBits2::eNone, vk::ImageLayout::eUndefined, {}, {} };
+	const ResourceUsage& released = m_Config.headless ? Access::TransferRead : Access::Present;
+
+	return graph.import_image("swapchain", m_Images[0], m_ImageViews[0], m_SwapFormat, m_SwapExtent, acquired, released);
+}
+
+// Points the imported swapchain image at the image acquired for this frame.
+void VulkanAppBase::bind_swapchain_image(RenderGraph& graph, RenderGraphResource swapchainImage, uint32_t imageIdx)
+{
+	graph.set_imported_image(swapchainImage, m_Images[imageIdx], m_ImageViews[imageIdx]);
+}
+
+// Submits compute work on the compute queue. The bindless set is bound first when enabled,
+// as the command buffer does not share the frame's bindings.
+uint64_t VulkanAppBase::submit_async_compute(const ComputeScheduler::RecordFunction& recordFn, uint64_t waitGraphicsValue, vk::PipelineStageFlags2 waitStage)
+{
+	return m_ComputeScheduler.submit([&](vk::CommandBuffer commandBuffer)
+	{
+		if (m_Config.enable_bindless)
+			m_Bindless.bind(commandBuffer, vk::PipelineBindPoint::eCompute);
+		recordFn(commandBuffer);
+	}, waitGraphicsValue, waitStage);
+}
+
+// Makes the frame being recorded wait for the compute submission before dstStage.
+void VulkanAppBase::wait_async_compute(uint64_t computeValue, vk::PipelineStageFlags2 dstStage)
+{
+	m_ComputeScheduler.wait_in_graphics(computeValue, dstStage);
+}
+
+// Returns the unique queue families eConcurrent resources shared with async compute must list.
+std::vector<uint32_t> VulkanAppBase::async_compute_families() const
+{
+	if (m_ComputeIdx == m_GraphicsIdx)
+		return { m_GraphicsIdx };
+	return { m_GraphicsIdx, m_ComputeIdx };
+}
+
+// Returns a pipeline builder wired to the shader library. With dynamic rendering, graphics
+// builders target the swapchain format, so no render pass has to be created or kept alive.
+PipelineBuilder VulkanAppBase::create_pipeline_builder(PipelineType pipelineType)
+{
+	PipelineBuilder builder(pipelineType, &m_ShaderLibrary);
+
+	if (pipelineType == PipelineType::Graphics && m_Config.dynamic_rendering)
+		builder.set_rendering_formats({ m_SwapFormat });
+
+	if (m_Config.enable_bindless)
+		builder.set_pipeline_layout(m_Bindless.pipeline_layout());
+
+	return builder;
+}
+
+// Defers the release past every frame recorded so far, including the one being recorded.
+void VulkanAppBase::release_bindless(BindlessType type, uint32_t index)
+{
+	m_Bindless.release(type, index, m_FrameNumber);
+}
+
+// Copies the frame's offscreen image into its readback buffer and makes the copy visible to
+// the host. end_rendering has already moved the image to eTransferSrcOptimal.
+void VulkanAppBase::record_readback(vk::CommandBuffer commandBuffer, uint32_t imageIdx, FrameContext& frame)
+{
+	// Each GPU of a device group copies the strip it rendered from its own instance of the
+	// image, so the host buffer receives the whole frame
+	std::vector<vk::Rect2D> areas = m_DeviceGroupSize > 1 ? split_frame_areas() : std::vector<vk::Rect2D>{ vk::Rect2D({ 0, 0 }, m_SwapExtent) };
+	for (uint32_t device = 0; device < areas.size(); device++)
+	{
+		const vk::Rect2D& area = areas[device];
+		vk::BufferImageCopy region(
+			static_cast<vk::DeviceSize>(area.offset.y) * m_SwapExtent.width * texel_size(m_SwapFormat), 0, 0,
+			vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1),
+			{ 0, area.offset.y, 0 },
+			vk::Extent3D(area.extent, 1)
+		);
+
+		if (m_DeviceGroupSize > 1)
+			commandBuffer.setDeviceMask(1u << device);
+		commandBuffer.copyImageToBuffer(m_Images[imageIdx], vk::ImageLayout::eTransferSrcOptimal, frame.readbackBuffer.buffer, region);
+	}
+
+	if (m_DeviceGroupSize > 1)
+		commandBuffer.setDeviceMask(device_mask());
+
+	vk::BufferMemoryBarrier2 toHost(
+		vk::PipelineStageFlagBits2::eCopy, vk::AccessFlagBits2::eTransferWrite,
+		vk::PipelineStageFlagBits2::eHost, vk::AccessFlagBits2::eHostRead,
+		VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+		frame.readbackBuffer.buffer, 0, VK_WHOLE_SIZE
+	);
 
-	// Create a semaphore and fence for each frame in flight.
-	for (int i = 0; i < m_FramesInFlight; i++)
+	vk::DependencyInfo dependencyInfo{};
+	dependencyInfo.setBufferMemoryBarriers(toHost);
+	commandBuffer.pipelineBarrier2(dependencyInfo);
+
+	frame.readbackFrame = m_FrameNumber;
+	frame.readbackPending = true;
+}
+
+// Waits for every frame in flight and hands their readbacks to on_readback, oldest first.
+void VulkanAppBase::flush_readbacks()
+{
+	for (uint32_t i = 0; i < m_FramesInFlight; i++)
 	{
-		// Semaphore signaled when an image is available for rendering.
-		m_ImageAvailableSemaphores[i] = m_Device.createSemaphore(semaphoreInfo);
-		// Semaphore signaled when rendering is finished and presentation can occur.
-		m_RenderFinishedSemaphores[i] = m_Device.createSemaphore(semaphoreInfo);
-		// Fence signaled when the GPU has finished processing commands for this frame.
-		m_InFlightFences[i] = m_Device.createFence(fenceInfo);
+		FrameContext& frame = m_Frames[(m_CurrentFrame + i) % m_FramesInFlight];
+		if (!frame.readbackPending)
+			continue;
+
+		auto fenceResult = m_Device.waitForFences(frame.inFlight, vk::True, UINT64_MAX);
+		if (fenceResult != vk::Result::eSuccess)
+			error("Fence operation failed!");
+
+		frame.readbackPending = false;
+		on_readback(frame.readbackFrame, frame.readbackBuffer.allocation.mapped, frame.readbackBuffer.allocation.size);
 	}
 }
 
@@ -374,28 +1314,42 @@ vk::ShaderModule VulkanAppBase::create_shader_module(const std::vector<char>& co
 	return m_Device.createShaderModule(moduleInfo);
 }
 
-// Finds a suitable memory type for a buffer or image.
+// Returns the shader module for a SPIR-V file from the shared shader library. The module is
+// owned by the library and must not be destroyed by the caller.
+vk::ShaderModule VulkanAppBase::load_shader(const std::string& fileName)
+{
+	return m_ShaderLibrary.load(fileName)->module;
+}
+
+// Finds the memory type with the required properties and the fewest unrequested ones, so
+// plain device-local requests don't land in the host-visible BAR window.
 uint32_t VulkanAppBase::find_memory_type(uint32_t typeFilter, vk::MemoryPropertyFlags properties)
 {
-	// Query info about available types of memory
-	vk::PhysicalDeviceMemoryProperties memProperties = m_PhysicalDevice.getMemoryProperties();
+	vk::MemoryPropertyFlags unwanted = (vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible
+		| vk::MemoryPropertyFlagBits::eHostCached) & ~properties;
 
-	// Iterate memory types and properties until a suitable match is found
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i)
-	{
-		bool isTypeSuitable = typeFilter & (1 << i);
-		bool hasRequiredProperties = (memProperties.memoryTypes[i].propertyFlags & properties) == properties;
+	uint32_t memoryType = m_Allocator.find_memory_type(typeFilter, properties, {}, unwanted);
+	if (memoryType == UINT32_MAX)
+		error("Unable to find suitable memory type!");
 
-		if (isTypeSuitable && hasRequiredProperties)
-			return i;
-	}
+	return memoryType;
+}
 
-	error("Unable to find suitable memory type!");
-	return 0;
+// Finds the best memory type for how the resource is accessed.
+uint32_t VulkanAppBase::find_memory_type(uint32_t typeFilter, MemoryUsage usage)
+{
+	if (usage == MemoryUsage::Static && !m_Config.direct_uploads)
+		usage = MemoryUsage::GpuOnly;
+
+	uint32_t memoryType = m_Allocator.find_memory_type(typeFilter, usage);
+	if (memoryType == UINT32_MAX)
+		error("Unable to find suitable memory type!");
+
+	return memoryType;
 }
 
-// Creates a Vulkan buffer and allocates memory for it.
-std::pair<vk::Buffer, vk::DeviceMemory> VulkanAppBase::create_buffer(
+// Creates a Vulkan buffer and binds it to a sub-allocation from the device memory allocator.
+AllocatedBuffer VulkanAppBase::create_buffer(
 	vk::DeviceSize size,
 	vk::BufferUsageFlags flags,
 	vk::MemoryPropertyFlags properties,
@@ -411,32 +1365,63 @@ std::pair<vk::Buffer, vk::DeviceMemory> VulkanAppBase::create_buffer(
 		queues              // List of queue family indices
 	);
 
-	vk::Buffer buffer = m_Device.createBuffer(bufferInfo);
+	AllocatedBuffer buffer;
+	buffer.buffer = m_Device.createBuffer(bufferInfo);
 
 	// Query buffer memory requirements
-	vk::MemoryRequirements memReqs = m_Device.getBufferMemoryRequirements(buffer);
+	vk::MemoryRequirements memReqs = m_Device.getBufferMemoryRequirements(buffer.buffer);
 
-	// Find suitable memory type and allocate
+	// Find suitable memory type and sub-allocate from one of its blocks
 	uint32_t memTypeIndex = find_memory_type(memReqs.memoryTypeBits, properties);
-	vk::MemoryAllocateInfo allocInfo(memReqs.size, memTypeIndex);
+	buffer.allocation = m_Allocator.allocate(memReqs, memTypeIndex, AllocationKind::Linear);
+
+	// Bind memory to buffer at the sub-allocation offset
+	m_Device.bindBufferMemory(buffer.buffer, buffer.allocation.memory, buffer.allocation.offset);
+
+	return buffer;
+}
 
-	vk::DeviceMemory mem = m_Device.allocateMemory(allocInfo);
+// Creates a buffer in the memory type best suited to its usage.
+AllocatedBuffer VulkanAppBase::create_buffer(
+	vk::DeviceSize size,
+	vk::BufferUsageFlags flags,
+	MemoryUsage usage,
+	vk::SharingMode sharingMode,
+	std::vector<uint32_t> queues
+)
+{
+	vk::BufferCreateInfo bufferInfo({}, size, flags, sharingMode, queues);
+
+	AllocatedBuffer buffer;
+	buffer.buffer = m_Device.createBuffer(bufferInfo);
 
-	// Bind memory to buffer
-	m_Device.bindBufferMemory(buffer, mem, 0);
+	vk::MemoryRequirements memReqs = m_Device.getBufferMemoryRequirements(buffer.buffer);
+	buffer.allocation = m_Allocator.allocate(memReqs, find_memory_type(memReqs.memoryTypeBits, usage), AllocationKind::Linear);
+	m_Device.bindBufferMemory(buffer.buffer, buffer.allocation.memory, buffer.allocation.offset);
+
+	return buffer;
+}
+
+// Destroys a buffer created with create_buffer and returns its memory to the allocator.
+void VulkanAppBase::destroy_buffer(AllocatedBuffer& buffer)
+{
+	{
+		std::lock_guard lock(m_StreamMutex);
+		m_StreamedBuffers.erase(static_cast<VkBuffer>(buffer.buffer));
+	}
 
-	return { buffer, mem };
+	m_Device.destroyBuffer(buffer.buffer);
+	m_Allocator.free(buffer.allocation);
+	buffer.buffer = nullptr;
 }
 
 // Copies data from one buffer to another using a command buffer.
 void VulkanAppBase::copy_buffer(vk::Buffer src, vk::Buffer dst, vk::DeviceSize size)
 {
-	// Allocate a temporary command buffer for the copy operation
-	vk::CommandBufferAllocateInfo allocInfo(
-		m_TransferCommandPool, vk::CommandBufferLevel::ePrimary, 1
-	);
-
-	vk::CommandBuffer commandBuffer = m_Device.allocateCommandBuffers(allocInfo)[0];
+	// Recycle the copy command buffer; copies are synchronous, so nothing from the transfer
+	// pool is still pending
+	m_TransferCommandAllocator.reset();
+	vk::CommandBuffer commandBuffer = m_TransferCommandAllocator.allocate();
 
 	// Begin recording the command buffer
 	vk::CommandBufferBeginInfo beginInfo({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
@@ -448,12 +1433,325 @@ void VulkanAppBase::copy_buffer(vk::Buffer src, vk::Buffer dst, vk::DeviceSize s
 
 	commandBuffer.end();
 
-	// Submit the command buffer and wait for completion
+	// Submit the command buffer and wait for this copy only, leaving the queue running
+	m_Device.resetFences(m_CopyFence);
+
 	vk::SubmitInfo submitInfo{};
 	submitInfo.setCommandBuffers(commandBuffer);
-	m_TransferQueue.submit(submitInfo);
-	m_TransferQueue.waitIdle();
+	{
+		std::lock_guard lock(m_QueueMutex);
+		m_TransferQueue.submit(submitInfo, m_CopyFence);
+	}
+
+	auto result = m_Device.waitForFences(m_CopyFence, vk::True, UINT64_MAX);
+	if (result != vk::Result::eSuccess)
+		error("Buffer copy fence wait failed!");
+}
+
+// Writes host data into the staging ring and queues a copy into dst.
+// The copy is submitted, together with all other pending uploads, by flush_uploads().
+// Destination buffers should be exclusive to the graphics queue family; their ownership is
+// transferred from the transfer queue automatically. Pass sync.transferOwnership = false
+// for eConcurrent buffers. Buffers uploaded again while frames may read them, or read by
+// async compute, must be eConcurrent, with sync.overwrite set for re-uploads.
+void VulkanAppBase::upload_buffer(vk::Buffer dst, const void* data, vk::DeviceSize size, vk::DeviceSize dstOffset, const UploadSync& sync)
+{
+	m_StagingRing.upload(dst, dstOffset, data, size, sync);
+}
+
+// Writes host data straight into dst when its memory is mapped and coherent, as Static
+// buffers are on UMA and resizable BAR devices, and falls back to the staging ring otherwise.
+// A direct write happens immediately, so dst must not be in use by the GPU.
+void VulkanAppBase::upload_buffer(AllocatedBuffer& dst, const void* data, vk::DeviceSize size, vk::DeviceSize dstOffset, const UploadSync& sync)
+{
+	if (m_Allocator.is_host_writable(dst.allocation))
+	{
+		std::memcpy(static_cast<uint8_t*>(dst.allocation.mapped) + dstOffset, data, size);
+		return;
+	}
+
+	m_StagingRing.upload(dst.buffer, dstOffset, data, size, sync);
+}
+
+// Submits all pending uploads to the transfer queue without blocking. Returns the timeline
+// value the upload signals; the next draw_frame waits on it on the GPU.
+uint64_t VulkanAppBase::flush_uploads()
+{
+	return m_StagingRing.flush();
+}
+
+// Returns true if the uploads flushed with the given timeline value have completed.
+bool VulkanAppBase::is_upload_complete(uint64_t uploadValue)
+{
+	return m_StagingRing.is_complete(uploadValue);
+}
+
+// Blocks the calling thread until the uploads flushed with the given timeline value complete.
+void VulkanAppBase::wait_for_upload(uint64_t uploadValue)
+{
+	m_StagingRing.wait(uploadValue);
+}
+
+// Builds a pipeline on the calling thread through the shared pipeline cache.
+vk::UniquePipeline VulkanAppBase::build_pipeline(const PipelineBuilder& builder)
+{
+	return builder.build(m_Device, &m_PipelineCache);
+}
+
+// Returns the registered pipeline for the builder's state, building it only on first request.
+// The pipeline is owned by the registry.
+vk::Pipeline VulkanAppBase::get_pipeline(const PipelineBuilder& builder)
+{
+	return m_PipelineRegistry.get_or_create(builder);
+}
+
+// Registers the shader with the watcher when hot reload is enabled.
+void VulkanAppBase::watch_shader(const std::string& spirvPath, const std::string& sourcePath, const std::vector<std::string>& compileArgs)
+{
+	if (m_Config.shader_hot_reload)
+		m_ShaderWatcher.watch(spirvPath, sourcePath, compileArgs);
+}
+
+// Compiles a batch of pipelines across the worker pool through the shared pipeline cache.
+// The builders must outlive the returned futures.
+std::vector<std::future<vk::UniquePipeline>> VulkanAppBase::build_pipelines(const std::vector<PipelineBuilder>& builders)
+{
+	return PipelineBuilder::build_batch(m_Device, builders, m_ThreadPool, &m_PipelineCache);
+}
+
+// Creates vertex and index buffers for the mesh and uploads it, directly when the buffers
+// are host-writable and through the staging ring otherwise.
+GpuMesh VulkanAppBase::upload_mesh(const MeshData& mesh)
+{
+	GpuMesh gpuMesh;
+	gpuMesh.indexType = mesh.indexType;
+	gpuMesh.vertexCount = mesh.vertexCount;
+	gpuMesh.indexCount = mesh.indexCount;
+
+	gpuMesh.vertexBuffer = create_buffer(
+		mesh.vertices.size(),
+		vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+		MemoryUsage::Static,
+		vk::SharingMode::eExclusive,
+		{ m_GraphicsIdx }
+	);
+	gpuMesh.indexBuffer = create_buffer(
+		mesh.indices.size(),
+		vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+		MemoryUsage::Static,
+		vk::SharingMode::eExclusive,
+		{ m_GraphicsIdx }
+	);
+
+	upload_buffer(gpuMesh.vertexBuffer, mesh.vertices.data(), mesh.vertices.size(), 0,
+		UploadSync{ vk::PipelineStageFlagBits2::eVertexAttributeInput, vk::AccessFlagBits2::eVertexAttributeRead });
+	upload_buffer(gpuMesh.indexBuffer, mesh.indices.data(), mesh.indices.size(), 0,
+		UploadSync{ vk::PipelineStageFlagBits2::eIndexInput, vk::AccessFlagBits2::eIndexRead });
+
+	return gpuMesh;
+}
+
+// Streams a mesh file without checking its vertex layout.
+std::future<StreamedMesh> VulkanAppBase::load_mesh_async(const std::string& path)
+{
+	return stream_mesh(path, {}, 0);
+}
+
+// Counts the load as active until it finishes, so destroy() can wait for it.
+std::future<StreamedMesh> VulkanAppBase::stream_mesh(const std::string& path, std::span<const VertexAttribute> attributes, uint32_t stride)
+{
+	{
+		std::lock_guard lock(m_StreamMutex);
+		m_ActiveStreams++;
+	}
 
-	// Free the temporary command buffer
-	m_Device.freeCommandBuffers(m_TransferCommandPool, commandBuffer);
-}
\ No newline at end of file
+	return m_ThreadPool.submit([this, path, attributes, stride]()
+	{
+		try
+		{
+			StreamedMesh streamed = load_mesh_file(path, attributes, stride);
+			end_stream();
+			return streamed;
+		}
+		catch (...)
+		{
+			end_stream();
+			throw;
+		}
+	});
+}
+
+// Marks a mesh load as finished and wakes destroy() if it is waiting.
+void VulkanAppBase::end_stream()
+{
+	std::lock_guard lock(m_StreamMutex);
+	m_ActiveStreams--;
+	m_StreamsIdle.notify_all();
+}
+
+// Maps the file, creates the mesh's buffers and uploads every chunk directly from the mapping.
+// The mapping is released once the last chunk has been copied. A zero stride skips the
+// layout check. Runs on a worker thread.
+StreamedMesh VulkanAppBase::load_mesh_file(const std::string& path, std::span<const VertexAttribute> attributes, uint32_t stride)
+{
+	MeshFile file;
+	file.open(path);
+
+	if (stride != 0 && !file.matches_layout(attributes, stride))
+	{
+		spdlog::error("Mesh file {} does not match the requested vertex format", path);
+		throw std::runtime_error("Mesh file vertex layout mismatch");
+	}
+
+	StreamedMesh streamed;
+	GpuMesh& mesh = streamed.mesh;
+	mesh.indexType = file.index_type();
+	mesh.vertexCount = file.header().vertexCount;
+	mesh.indexCount = file.header().indexCount;
+
+	// Nothing is queued for upload until both buffers exist, so a failed creation can free them at once
+	try
+	{
+		mesh.vertexBuffer = create_streamed_buffer(file.vertex_data_size(), vk::BufferUsageFlagBits::eVertexBuffer);
+		mesh.indexBuffer = create_streamed_buffer(file.index_data_size(), vk::BufferUsageFlagBits::eIndexBuffer);
+	}
+	catch (...)
+	{
+		if (mesh.vertexBuffer.buffer)
+			destroy_buffer(mesh.vertexBuffer);
+		throw;
+	}
+
+	for (const MeshFileChunk& chunk : file.chunks())
+	{
+		if (chunk.type == MeshChunkType::Vertices)
+		{
+			upload_buffer(mesh.vertexBuffer, file.chunk_data(chunk), chunk.size, chunk.dstOffset,
+				UploadSync{ vk::PipelineStageFlagBits2::eVertexAttributeInput, vk::AccessFlagBits2::eVertexAttributeRead });
+		}
+		else
+		{
+			upload_buffer(mesh.indexBuffer, file.chunk_data(chunk), chunk.size, chunk.dstOffset,
+				UploadSync{ vk::PipelineStageFlagBits2::eIndexInput, vk::AccessFlagBits2::eIndexRead });
+		}
+	}
+
+	streamed.lods.assign(file.lods().begin(), file.lods().end());
+	streamed.meshlets.assign(file.meshlets().begin(), file.meshlets().end());
+
+	spdlog::info("Streamed mesh {}: {} vertices, {} indices in {} chunks", path, mesh.vertexCount, mesh.indexCount, file.chunks().size());
+	return streamed;
+}
+
+// Creates a Static buffer for a streamed mesh and records it, so destroy() frees it even if
+// the load's future is dropped.
+AllocatedBuffer VulkanAppBase::create_streamed_buffer(vk::DeviceSize size, vk::BufferUsageFlags usage)
+{
+	AllocatedBuffer buffer = create_buffer(
+		size,
+		usage | vk::BufferUsageFlagBits::eTransferDst,
+		MemoryUsage::Static,
+		vk::SharingMode::eExclusive,
+		{ m_GraphicsIdx }
+	);
+
+	std::lock_guard lock(m_StreamMutex);
+	m_StreamedBuffers.emplace(static_cast<VkBuffer>(buffer.buffer), buffer);
+	return buffer;
+}
+
+// Destroys a mesh's buffers. The GPU must no longer be using them.
+void VulkanAppBase::destroy_mesh(GpuMesh& mesh)
+{
+	destroy_buffer(mesh.indexBuffer);
+	destroy_buffer(mesh.vertexBuffer);
+	mesh.vertexCount = 0;
+	mesh.indexCount = 0;
+}
+
+// Binds the mesh and records one indexed draw of all its triangles.
+void VulkanAppBase::draw_mesh(vk::CommandBuffer commandBuffer, const GpuMesh& mesh, uint32_t instanceCount)
+{
+	vk::DeviceSize offset = 0;
+	commandBuffer.bindVertexBuffers(0, mesh.vertexBuffer.buffer, offset);
+	commandBuffer.bindIndexBuffer(mesh.indexBuffer.buffer, 0, mesh.indexType);
+	commandBuffer.drawIndexed(mesh.indexCount, instanceCount, 0, 0, 0);
+}
+
+// Creates device-local command and count buffers for up to maxDraws indirect draws.
+IndirectDrawBuffer VulkanAppBase::create_indirect_draw_buffer(uint32_t maxDraws)
+{
+	if (!m_Config.indirect_draw)
+		error("Indirect draw buffers require AppConfig::indirect_draw!");
+
+	vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eIndirectBuffer
+		| vk::BufferUsageFlagBits::eStorageBuffer
+		| vk::BufferUsageFlagBits::eTransferDst;
+
+	// Commands are uploaded again while earlier frames may still read them, so the buffers are
+	// shared with the transfer family instead of changing owner on every upload
+	bool shared = m_TransferIdx != m_GraphicsIdx;
+	vk::SharingMode sharingMode = shared ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive;
+	std::vector<uint32_t> queues = { m_GraphicsIdx };
+	if (shared)
+		queues.push_back(m_TransferIdx);
+
+	IndirectDrawBuffer drawBuffer;
+	drawBuffer.maxDraws = maxDraws;
+	drawBuffer.commands = create_buffer(
+		static_cast<vk::DeviceSize>(maxDraws) * IndirectDrawBuffer::Stride,
+		usage,
+		vk::MemoryPropertyFlagBits::eDeviceLocal,
+		sharingMode,
+		queues
+	);
+	drawBuffer.count = create_buffer(
+		sizeof(uint32_t),
+		usage,
+		vk::MemoryPropertyFlagBits::eDeviceLocal,
+		sharingMode,
+		queues
+	);
+
+	return drawBuffer;
+}
+
+// Destroys both buffers of an indirect draw buffer. The GPU must no longer be using them.
+void VulkanAppBase::destroy_indirect_draw_buffer(IndirectDrawBuffer& drawBuffer)
+{
+	destroy_buffer(drawBuffer.count);
+	destroy_buffer(drawBuffer.commands);
+	drawBuffer.maxDraws = 0;
+}
+
+// Queues uploads of the draw commands and their count, made visible to indirect command reads.
+// The copies wait for submitted frames that may still read the previous commands.
+void VulkanAppBase::upload_indirect_draws(IndirectDrawBuffer& drawBuffer, const std::vector<vk::DrawIndexedIndirectCommand>& commands)
+{
+	if (commands.size() > drawBuffer.maxDraws)
+		error("Indirect draw buffer holds " + std::to_string(drawBuffer.maxDraws) + " draws, " + std::to_string(commands.size()) + " were uploaded");
+
+	UploadSync sync{
+		.dstStage = vk::PipelineStageFlagBits2::eDrawIndirect,
+		.dstAccess = vk::AccessFlagBits2::eIndirectCommandRead,
+		.transferOwnership = false,
+		.overwrite = true
+	};
+	uint32_t drawCount = static_cast<uint32_t>(commands.size());
+
+	if (drawCount > 0)
+		upload_buffer(drawBuffer.commands.buffer, commands.data(), drawCount * IndirectDrawBuffer::Stride, 0, sync);
+	upload_buffer(drawBuffer.count.buffer, &drawCount, sizeof(drawCount), 0, sync);
+}
+
+// Issues every draw in the buffer with a single drawIndexedIndirectCount. The index and
+// vertex buffers, and the pipeline, must already be bound.
+void VulkanAppBase::draw_indexed_indirect(vk::CommandBuffer commandBuffer, const IndirectDrawBuffer& drawBuffer)
+{
+	commandBuffer.drawIndexedIndirectCount(
+		drawBuffer.commands.buffer, 0,
+		drawBuffer.count.buffer, 0,
+		drawBuffer.maxDraws,
+		IndirectDrawBuffer::Stride
+	);
+}
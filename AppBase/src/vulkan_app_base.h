@@ -2,14 +2,23 @@
 #define VULKAN_APP_BASE_H
 
 #include <exception>
+#include <stdexcept>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <fstream>
 #include <unordered_set>
 #include <array>
 #include <utility>
 #include <string>
 #include <cassert>
+#include <cstring>
+#include <chrono>
+#include <future>
+#include <span>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
 
 #include <vulkan/vulkan.hpp>
 #include <spdlog/spdlog.h>
@@ -18,6 +27,26 @@
 #include <glm/glm.hpp>
 
 #include "VkBootstrap.h"
+#include "gpu_allocator.h"
+#include "staging_ring.h"
+#include "pipeline_cache.h"
+#include "shader_library.h"
+#include "pipeline_builder.h"
+#include "pipeline_registry.h"
+#include "thread_pool.h"
+#include "deletion_queue.h"
+#include "command_allocator.h"
+#include "frame_context.h"
+#include "parallel_recorder.h"
+#include "gpu_profiler.h"
+#include "frame_pacer.h"
+#include "indirect_draw.h"
+#include "mesh_optimizer.h"
+#include "mesh_file.h"
+#include "bindless_descriptors.h"
+#include "render_graph.h"
+#include "compute_scheduler.h"
+#include "shader_watcher.h"
 
 // Configuration structure for the application
 struct AppConfig
@@ -26,7 +55,11 @@ struct AppConfig
 	uint32_t application_version = VK_MAKE_VERSION(1, 0, 0);
 	std::string engine_name = "Vulkan Application Base";
 	uint32_t engine_version = VK_MAKE_VERSION(1, 0, 0);
+	uint32_t api_version = VK_API_VERSION_1_3;
 	bool enable_validation_layers = true;
+	bool headless = false;				// No window or swapchain; render into an offscreen image ring
+	vk::Format headless_format = vk::Format::eR8G8B8A8Unorm;	// Offscreen image format, an uncompressed color format
+	bool headless_readback = true;		// Copy each finished offscreen image back to host memory
 	int window_width = 1280;
 	int window_height = 720;
 	std::vector<const char*> instance_extensions;
@@ -36,6 +69,53 @@ struct AppConfig
 		VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME
 	};
 	vk::PhysicalDeviceFeatures device_features;
+	vk::PhysicalDeviceVulkan12Features device_features_12;
+	vk::PhysicalDeviceVulkan13Features device_features_13;
+	vk::DeviceSize memory_block_size = 64ull * 1024 * 1024;
+	vk::DeviceSize staging_ring_size = 32ull * 1024 * 1024;
+	bool direct_uploads = true;			// Write MemoryUsage::Static buffers in place on UMA and resizable BAR devices
+	std::string pipeline_cache_path = "pipeline_cache.bin";	// Empty disables cache persistence
+	bool dynamic_rendering = true;		// Render without render pass or framebuffer objects
+	uint32_t frames_in_flight = 2;		// Frames the CPU may record ahead of the GPU
+	vk::DeviceSize frame_allocator_size = 4ull * 1024 * 1024;	// Bytes of per-frame dynamic data per frame in flight
+	uint32_t frame_descriptor_sets = 256;	// Descriptor sets each frame's descriptor pool can allocate
+	std::vector<vk::DescriptorPoolSize> frame_descriptor_pool_sizes =
+	{
+		{ vk::DescriptorType::eUniformBuffer, 256 },
+		{ vk::DescriptorType::eStorageBuffer, 256 },
+		{ vk::DescriptorType::eCombinedImageSampler, 256 }
+	};
+	vk::PresentModeKHR present_mode = vk::PresentModeKHR::eMailbox;	// Falls back to FIFO if unsupported
+	FramePacingConfig frame_pacing;
+	bool enable_gpu_profiler = true;
+	GpuProfilerConfig gpu_profiler;
+	bool enable_bindless = false;		// Global descriptor set with descriptor indexing, see BindlessDescriptors
+	BindlessConfig bindless;
+	bool indirect_draw = false;			// Require multiDrawIndirect and drawIndirectCount for IndirectDrawBuffer
+	bool async_compute = true;			// Submit compute work to a separate compute queue family when available
+	bool pipeline_libraries = false;	// Fast-link graphics pipelines from cached libraries; requires VK_EXT_graphics_pipeline_library
+	uint32_t device_index = 0;			// Index into the suitable GPUs ranked by score_physical_device; create one context per index to use every GPU
+	bool device_group = false;			// Headless only: span the GPU's device group, each GPU rendering a horizontal strip of every frame
+	bool shader_hot_reload = false;		// Recompile and reload watched shaders while running, see watch_shader
+	ShaderWatcherConfig shader_watcher;
+};
+
+// Vertex and index buffers of a mesh uploaded with upload_mesh.
+struct GpuMesh
+{
+	AllocatedBuffer vertexBuffer;
+	AllocatedBuffer indexBuffer;
+	vk::IndexType indexType = vk::IndexType::eUint32;
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+};
+
+// A mesh streamed from a mesh file, with the file's LOD and meshlet tables.
+struct StreamedMesh
+{
+	GpuMesh mesh;
+	std::vector<MeshFileLod> lods;
+	std::vector<MeshFileMeshlet> meshlets;
 };
 
 struct SwapchainConfig
@@ -64,10 +144,14 @@ protected:
 	GLFWwindow* m_Window = nullptr;
 
 	// Frames in flight
-	const int m_FramesInFlight = 2;
+	uint32_t m_FramesInFlight = 2;
+	uint32_t m_CurrentFrame = 0;
+	uint64_t m_FrameNumber = 0;		// Total frames submitted, used to retire deferred deletions
 
 	// Check if framebuffer is resized
 	bool m_FramebufferResized = false;
+	// Set when the swapchain must be rebuilt with a changed configuration
+	bool m_SwapchainOutdated = false;
 
 	// Core Vulkan objects
 	vk::Instance m_Instance;
@@ -75,17 +159,77 @@ protected:
 	vk::SurfaceKHR m_Surface;
 	vk::PhysicalDevice m_PhysicalDevice;
 	vk::Device m_Device;
-	vk::Queue m_GraphicsQueue, m_PresentQueue, m_TransferQueue;
-	uint32_t m_GraphicsIdx = 0, m_PresentIdx = 0, m_TransferIdx = 0;
+	vk::DispatchLoaderDynamic m_Dispatch;		// Extension entry points not covered by static dispatch
+	uint32_t m_SuitableDeviceCount = 0;		// GPUs meeting the requirements, valid device_index values
+	uint32_t m_DeviceGroupSize = 1;			// GPUs in the logical device, more than one with device_group
+	vk::Queue m_GraphicsQueue, m_PresentQueue, m_TransferQueue, m_ComputeQueue;
+	uint32_t m_GraphicsIdx = 0, m_PresentIdx = 0, m_TransferIdx = 0, m_ComputeIdx = 0;
 	vk::SwapchainKHR m_Swapchain;
 	vk::Extent2D m_SwapExtent;
 	vk::Format m_SwapFormat{};
-	std::vector<vk::Image> m_Images;
+	std::vector<vk::Image> m_Images;				// Swapchain images, or the offscreen ring in headless mode
 	std::vector<vk::ImageView> m_ImageViews;
+	std::vector<Allocation> m_OffscreenAllocations;
 	vk::RenderPass m_RenderPass;
-	vk::CommandPool m_GraphicsCommandPool, m_TransferCommandPool;
-	std::vector<vk::Semaphore> m_ImageAvailableSemaphores, m_RenderFinishedSemaphores;
-	std::vector<vk::Fence> m_InFlightFences;
+	vk::CommandPool m_GraphicsCommandPool;
+	CommandAllocator m_TransferCommandAllocator;
+	vk::Fence m_CopyFence;
+
+	// Per-frame sync objects, command buffers and descriptor pools, one per frame in flight
+	std::vector<FrameContext> m_Frames;
+	// Persistently mapped buffer split into one frame allocator range per frame in flight
+	AllocatedBuffer m_FrameDataBuffer;
+
+	// Device memory sub-allocator used by create_buffer
+	GpuAllocator m_Allocator;
+
+	// Persistently mapped staging ring used by upload_buffer, drained asynchronously on the transfer queue
+	StagingRing m_StagingRing;
+
+	// Pipeline cache shared by PipelineBuilder::build, persisted across launches
+	PipelineCache m_PipelineCache;
+
+	// Deduplicated pipelines keyed on builder state
+	PipelineRegistry m_PipelineRegistry;
+
+	// SPIR-V binaries and shader modules shared across pipeline builders
+	ShaderLibrary m_ShaderLibrary;
+
+	// Hot reload of watched shaders into the library and registry
+	ShaderWatcher m_ShaderWatcher;
+
+	// Per-thread, per-frame command pools for recording secondary command buffers in parallel
+	ParallelRecorder m_ParallelRecorder;
+
+	// Latency limiting and frame rate capping around acquire
+	FramePacer m_FramePacer;
+
+	// GPU timestamp profiler, usable through GpuProfileScope inside record_command_buffer
+	GpuProfiler m_Profiler;
+	std::chrono::steady_clock::time_point m_LastFrameStart;
+
+	// Compute queue submissions ordered against graphics frames with timeline semaphores
+	ComputeScheduler m_ComputeScheduler;
+
+	// Global descriptor set, bound to set 0 at the start of every frame's command buffer
+	BindlessDescriptors m_Bindless;
+
+	// Resources destroyed once the frames that used them have completed
+	DeletionQueue m_DeletionQueue;
+
+	// Held around every queue submit and present. The transfer and compute queues may be the
+	// graphics queue, and the staging ring submits from worker threads when it fills up
+	std::mutex m_QueueMutex;
+
+	// Mesh loads still running on the thread pool, and the buffers of streamed meshes that
+	// have not been destroyed yet; destroy() waits for the loads and frees the buffers
+	std::mutex m_StreamMutex;
+	std::condition_variable m_StreamsIdle;
+	uint32_t m_ActiveStreams = 0;
+	std::unordered_map<VkBuffer, AllocatedBuffer> m_StreamedBuffers;
+
+	// Worker threads for background jobs such as batched pipeline compilation
+	ThreadPool m_ThreadPool;
 
 protected:
 	virtual void init();
@@ -94,20 +238,125 @@ protected:
 	// Core Vulkan lifecycle functions
 	virtual void create_instance();
 	virtual void create_device();
+	// Rank a suitable GPU; higher is better. The default prefers discrete GPUs, then more VRAM,
+	// then dedicated compute and transfer queue families.
+	virtual uint64_t score_physical_device(vk::PhysicalDevice physicalDevice) const;
 	virtual void create_window_and_surface();
 	virtual void create_swapchain();
 	virtual void create_swapchain(const SwapchainConfig& swapConfig);
 	virtual void recreate_swapchain();
 	virtual void destroy_swapchain();
+	virtual void create_offscreen_images();
+	// Headless counterpart of recreate_swapchain, e.g. after changing window_width/height
+	void recreate_offscreen_images();
+	// Switch present mode at runtime; the swapchain is rebuilt at the end of the current frame.
+	void set_present_mode(vk::PresentModeKHR presentMode);
+	std::vector<vk::PresentModeKHR> get_supported_present_modes() const;
 	virtual void create_command_pools();
-	virtual void create_sync_objects();
+	virtual void create_frame_contexts();
+	virtual void destroy_frame_contexts();
+	virtual void create_staging_ring();
+	void create_readback_buffer(FrameContext& frame);
+
+	// Frame rendering
+	FrameContext& current_frame() { return m_Frames[m_CurrentFrame]; }
+	// Per-frame bump allocator for dynamic data, valid while recording the current frame
+	LinearAllocator& frame_allocator() { return current_frame().frameAllocator; }
+	virtual void draw_frame();
+	// Records a frame's commands. The command buffer is already in the recording state.
+	virtual void record_command_buffer(vk::CommandBuffer commandBuffer, uint32_t imageIdx) = 0;
+	// Headless mode: receives a finished frame's pixels (tightly packed rows of m_SwapExtent)
+	// a few frames after it was submitted. The data is only valid during the call.
+	virtual void on_readback(uint64_t /*frameNumber*/, const void* /*pixels*/, vk::DeviceSize /*size*/) {}
+	// Headless mode: wait for every submitted frame and deliver its pending readback.
+	void flush_readbacks();
+	void record_readback(vk::CommandBuffer commandBuffer, uint32_t imageIdx, FrameContext& frame);
 	
+	// Dynamic rendering into a swapchain image. begin_rendering transitions the image to a
+	// color attachment and end_rendering transitions it for presentation.
+	void begin_rendering(vk::CommandBuffer commandBuffer, uint32_t imageIdx, const vk::ClearColorValue& clearColor = {}, vk::RenderingFlags flags = {});
+	void end_rendering(vk::CommandBuffer commandBuffer, uint32_t imageIdx);
+	// Records items in parallel into secondary command buffers executed from commandBuffer.
+	// Must be called inside begin_rendering with eContentsSecondaryCommandBuffers.
+	void record_parallel(vk::CommandBuffer commandBuffer, uint32_t itemCount, uint32_t itemsPerTask, const ParallelRecorder::RecordFunction& recordFn);
+	// Render graphs place their transient resources in the app's allocator. The swapchain image
+	// is imported once, left ready for presentation (or readback in headless mode), and rebound
+	// to the acquired image before each execution.
+	void init_render_graph(RenderGraph& graph);
+	RenderGraphResource import_swapchain_image(RenderGraph& graph);
+	void bind_swapchain_image(RenderGraph& graph, RenderGraphResource swapchainImage, uint32_t imageIdx);
+	// Device groups: every command runs on all GPUs unless restricted, and begin_rendering
+	// gives each GPU the strip of the frame it renders.
+	uint32_t device_mask() const { return (1u << m_DeviceGroupSize) - 1; }
+	std::vector<vk::Rect2D> split_frame_areas() const;
+	// Builders share the shader library, target the swapchain format, and use the bindless
+	// pipeline layout when enabled.
+	PipelineBuilder create_pipeline_builder(PipelineType pipelineType);
+	// Release a bindless slot once the frames that may still index it have completed.
+	void release_bindless(BindlessType type, uint32_t index);
+
+	// Async compute. Work recorded by recordFn runs on the compute queue, after the graphics
+	// timeline reaches waitGraphicsValue (frame N's submission signals N + 1), and the returned
+	// value is passed to wait_async_compute by the graphics frame consuming its results.
+	// Resources used by both must be shared across async_compute_families(). Uploads are not
+	// acquired by the compute family: staged buffers it reads must also be shared with the
+	// transfer family and uploaded with transferOwnership = false.
+	uint64_t submit_async_compute(const ComputeScheduler::RecordFunction& recordFn, uint64_t waitGraphicsValue = 0, vk::PipelineStageFlags2 waitStage = vk::PipelineStageFlagBits2::eComputeShader);
+	void wait_async_compute(uint64_t computeValue, vk::PipelineStageFlags2 dstStage = vk::PipelineStageFlagBits2::eAllCommands);
+	// Graphics timeline value signaled by the most recently submitted frame
+	uint64_t graphics_timeline_value() const { return m_FrameNumber; }
+	std::vector<uint32_t> async_compute_families() const;
+
 	// Utility
 	static std::vector<char> read_file(const std::string& fileName);
 	virtual vk::ShaderModule create_shader_module(const std::vector<char>& code);
+	vk::ShaderModule load_shader(const std::string& fileName);
 	virtual uint32_t find_memory_type(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
-	std::pair<vk::Buffer, vk::DeviceMemory> create_buffer(vk::DeviceSize size, vk::BufferUsageFlags flags, vk::MemoryPropertyFlags properties, vk::SharingMode sharingMode, std::vector<uint32_t> queues);
+	uint32_t find_memory_type(uint32_t typeFilter, MemoryUsage usage);
+	AllocatedBuffer create_buffer(vk::DeviceSize size, vk::BufferUsageFlags flags, vk::MemoryPropertyFlags properties, vk::SharingMode sharingMode, std::vector<uint32_t> queues);
+	AllocatedBuffer create_buffer(vk::DeviceSize size, vk::BufferUsageFlags flags, MemoryUsage usage, vk::SharingMode sharingMode, std::vector<uint32_t> queues);
+	void destroy_buffer(AllocatedBuffer& buffer);
 	void copy_buffer(vk::Buffer src, vk::Buffer dst, vk::DeviceSize size);
+	void upload_buffer(vk::Buffer dst, const void* data, vk::DeviceSize size, vk::DeviceSize dstOffset = 0, const UploadSync& sync = {});
+	void upload_buffer(AllocatedBuffer& dst, const void* data, vk::DeviceSize size, vk::DeviceSize dstOffset = 0, const UploadSync& sync = {});
+	uint64_t flush_uploads();
+	bool is_upload_complete(uint64_t uploadValue);
+	void wait_for_upload(uint64_t uploadValue);
+	vk::UniquePipeline build_pipeline(const PipelineBuilder& builder);
+	// With pipeline_libraries, a new graphics pipeline is fast-linked and replaced by its
+	// optimized link at a later frame boundary; request it every frame to pick that up.
+	vk::Pipeline get_pipeline(const PipelineBuilder& builder);
+	// With shader_hot_reload, recompile sourcePath into spirvPath when it changes, and rebuild
+	// registry pipelines using spirvPath whenever the binary changes. No-op otherwise.
+	void watch_shader(const std::string& spirvPath, const std::string& sourcePath = {}, const std::vector<std::string>& compileArgs = {});
+	std::vector<std::future<vk::UniquePipeline>> build_pipelines(const std::vector<PipelineBuilder>& builders);
+
+	// Meshes. Build the MeshData with optimize_mesh; staged uploads take effect after the next flush_uploads.
+	GpuMesh upload_mesh(const MeshData& mesh);
+	void destroy_mesh(GpuMesh& mesh);
+	// Bind the mesh's vertex buffer to binding 0 and its index buffer, then draw it.
+	void draw_mesh(vk::CommandBuffer commandBuffer, const GpuMesh& mesh, uint32_t instanceCount = 1);
+	// Stream a mesh file on a worker thread. The file is memory-mapped and each chunk is copied
+	// from the mapping into the staging ring, or straight into the buffers when they are
+	// host-writable. The typed overload fails unless the file's layout matches the VertexFormat.
+	// Uploads take effect after the first flush_uploads once the future is ready. Meshes still
+	// alive at shutdown, including those of dropped futures, are destroyed with the app.
+	std::future<StreamedMesh> load_mesh_async(const std::string& path);
+	template<VertexFormatType Vertex>
+	std::future<StreamedMesh> load_mesh_async(const std::string& path)
+	{
+		static constexpr auto attributes = Vertex::attributes();
+		return stream_mesh(path, attributes, sizeof(Vertex));
+	}
+
+	// Indirect drawing. A whole batch of indexed draws is submitted with one
+	// drawIndexedIndirectCount call reading its commands and count from device memory.
+	// Requires AppConfig::indirect_draw.
+	IndirectDrawBuffer create_indirect_draw_buffer(uint32_t maxDraws);
+	void destroy_indirect_draw_buffer(IndirectDrawBuffer& drawBuffer);
+	// Upload commands and their count through the staging ring. Takes effect after the next flush_uploads.
+	void upload_indirect_draws(IndirectDrawBuffer& drawBuffer, const std::vector<vk::DrawIndexedIndirectCommand>& commands);
+	void draw_indexed_indirect(vk::CommandBuffer commandBuffer, const IndirectDrawBuffer& drawBuffer);
 
 	inline void error(std::string message)
 	{
@@ -118,6 +367,12 @@ protected:
 private:
 	vkb::Instance m_VkbInstance;
 
+private:
+	std::future<StreamedMesh> stream_mesh(const std::string& path, std::span<const VertexAttribute> attributes, uint32_t stride);
+	void end_stream();
+	StreamedMesh load_mesh_file(const std::string& path, std::span<const VertexAttribute> attributes, uint32_t stride);
+	AllocatedBuffer create_streamed_buffer(vk::DeviceSize size, vk::BufferUsageFlags usage);
+
 private:
 	static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 	{
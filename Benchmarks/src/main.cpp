@@ -0,0 +1,498 @@
+#include <vector>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+#include <cstdio>
+
+#include <vulkan/vulkan.hpp>
+#include <spdlog/spdlog.h>
+#include <glm/glm.hpp>
+
+#include "vulkan_app_base.h"
+
+// Vertex layout matching src/shader/shader.vert
+using Vertex = Vertex2DColor;
+
+namespace
+{
+	// Quotes a string for JSON, escaping quotes, backslashes and control characters.
+	std::string json_string(const std::string& value)
+	{
+		std::string quoted = "\"";
+		for (char c : value)
+		{
+			switch (c)
+			{
+			case '"': quoted += "\\\""; break;
+			case '\\': quoted += "\\\\"; break;
+			case '\n': quoted += "\\n"; break;
+			case '\r': quoted += "\\r"; break;
+			case '\t': quoted += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					char escaped[7];
+					std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+					quoted += escaped;
+				}
+				else
+				{
+					quoted += c;
+				}
+			}
+		}
+		return quoted + "\"";
+	}
+}
+
+// Timing samples of one benchmark, in milliseconds.
+struct BenchmarkResult
+{
+	std::string name;
+	std::vector<double> samples;
+	std::vector<std::pair<std::string, double>> metrics;	// Extra values such as throughput
+
+	double mean() const { return samples.empty() ? 0.0 : std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size(); }
+	double min() const { return samples.empty() ? 0.0 : *std::min_element(samples.begin(), samples.end()); }
+	double max() const { return samples.empty() ? 0.0 : *std::max_element(samples.begin(), samples.end()); }
+
+	double median() const
+	{
+		if (samples.empty())
+			return 0.0;
+
+		std::vector<double> sorted = samples;
+		std::sort(sorted.begin(), sorted.end());
+		return sorted[sorted.size() / 2];
+	}
+};
+
+// Runs timed benchmarks of the AppBase hot paths and writes the results as JSON.
+class Benchmarks : public VulkanAppBase
+{
+public:
+	Benchmarks(const std::string& outputPath, bool headless)
+		: m_OutputPath(outputPath)
+	{
+		m_Config.application_name = "AppBase Benchmarks";
+		m_Config.headless = headless;
+		m_Config.headless_readback = false;
+		m_Config.enable_validation_layers = false;
+		m_Config.present_mode = vk::PresentModeKHR::eImmediate;	// Don't measure vsync
+		m_Config.pipeline_cache_path.clear();						// Every run starts cold
+		m_Config.indirect_draw = true;								// For the indirect draw benchmark
+	}
+
+	void run() override
+	{
+		init();
+
+		bench_buffer_creation();
+		bench_upload_throughput();
+		bench_copy_buffer();
+		bench_pipeline_build();
+
+		if (!m_Config.headless)
+			bench_swapchain_recreation();
+
+		create_draw_resources();
+		for (uint32_t drawCount : { 1u, 100u, 1000u, 10000u, 100000u })
+		{
+			bench_draw_submission(drawCount, DrawMode::Direct);
+			bench_draw_submission(drawCount, DrawMode::Parallel);
+			bench_draw_submission(drawCount, DrawMode::Indirect);
+		}
+		destroy_draw_resources();
+
+		write_results();
+	}
+
+private:
+	// How the benchmarked draws are recorded
+	enum class DrawMode
+	{
+		Direct,		// One draw call per draw on the recording thread
+		Parallel,	// Draw calls split across secondary command buffers on the thread pool
+		Indirect,	// A single drawIndexedIndirectCount for the whole batch
+	};
+
+	static constexpr uint32_t MaxDraws = 100000;
+
+	std::string m_OutputPath;
+	std::vector<BenchmarkResult> m_Results;
+
+	// Draw submission state
+	vk::UniquePipeline m_Pipeline;
+	AllocatedBuffer m_VertexBuffer;
+	AllocatedBuffer m_IndexBuffer;
+	IndirectDrawBuffer m_IndirectDraws;
+	uint32_t m_DrawCount = 0;
+	DrawMode m_DrawMode = DrawMode::Direct;
+	double m_RecordMs = 0.0;
+
+private:
+	// Times fn once per iteration.
+	static BenchmarkResult time(const std::string& name, uint32_t iterations, const std::function<void()>& fn)
+	{
+		BenchmarkResult result{ name };
+		result.samples.reserve(iterations);
+
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			fn();
+			result.samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		return result;
+	}
+
+	// Sharing for buffers written on the transfer queue and read on the graphics queue
+	// without an ownership transfer. Memory is either property flags or a MemoryUsage.
+	template<typename Memory>
+	AllocatedBuffer create_shared_buffer(vk::DeviceSize size, vk::BufferUsageFlags usage, Memory memory)
+	{
+		if (m_GraphicsIdx == m_TransferIdx)
+			return create_buffer(size, usage, memory, vk::SharingMode::eExclusive, { m_GraphicsIdx });
+
+		return create_buffer(size, usage, memory, vk::SharingMode::eConcurrent, { m_GraphicsIdx, m_TransferIdx });
+	}
+
+	// Measures create_buffer/destroy_buffer for many small device-local buffers.
+	void bench_buffer_creation()
+	{
+		constexpr uint32_t BufferCount = 4096;
+		std::vector<AllocatedBuffer> buffers(BufferCount);
+
+		BenchmarkResult create = time("buffer_create", BufferCount, [&, i = 0u]() mutable
+		{
+			buffers[i++] = create_buffer(64 * 1024, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+				vk::MemoryPropertyFlagBits::eDeviceLocal, vk::SharingMode::eExclusive, { m_GraphicsIdx });
+		});
+
+		m_Allocator.log_stats();
+
+		BenchmarkResult destroy = time("buffer_destroy", BufferCount, [&, i = 0u]() mutable
+		{
+			destroy_buffer(buffers[i++]);
+		});
+
+		m_Results.push_back(std::move(create));
+		m_Results.push_back(std::move(destroy));
+	}
+
+	// Measures staging ring upload throughput, from the first upload until the GPU copy completes.
+	void bench_upload_throughput()
+	{
+		constexpr vk::DeviceSize ChunkSize = 1024 * 1024;
+		constexpr vk::DeviceSize TotalSize = 256 * ChunkSize;
+
+		AllocatedBuffer dst = create_shared_buffer(TotalSize, vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal);
+		std::vector<uint8_t> data(ChunkSize, 0xAB);
+		UploadSync sync{ .transferOwnership = false };
+
+		BenchmarkResult result = time("upload_staging_ring", 8, [&]()
+		{
+			for (vk::DeviceSize offset = 0; offset < TotalSize; offset += ChunkSize)
+				upload_buffer(dst.buffer, data.data(), ChunkSize, offset, sync);
+
+			wait_for_upload(flush_uploads());
+		});
+
+		result.metrics.emplace_back("bytes", static_cast<double>(TotalSize));
+		result.metrics.emplace_back("gib_per_s", TotalSize / (1024.0 * 1024.0 * 1024.0) / (result.median() / 1000.0));
+		m_Results.push_back(std::move(result));
+		destroy_buffer(dst);
+
+		// On UMA and resizable BAR devices Static buffers are written in place
+		AllocatedBuffer staticDst = create_shared_buffer(TotalSize, vk::BufferUsageFlagBits::eTransferDst, MemoryUsage::Static);
+		if (m_Allocator.is_host_writable(staticDst.allocation))
+		{
+			BenchmarkResult direct = time("upload_direct", 8, [&]()
+			{
+				for (vk::DeviceSize offset = 0; offset < TotalSize; offset += ChunkSize)
+					upload_buffer(staticDst, data.data(), ChunkSize, offset, sync);
+			});
+
+			direct.metrics.emplace_back("bytes", static_cast<double>(TotalSize));
+			direct.metrics.emplace_back("gib_per_s", TotalSize / (1024.0 * 1024.0 * 1024.0) / (direct.median() / 1000.0));
+			m_Results.push_back(std::move(direct));
+		}
+		destroy_buffer(staticDst);
+	}
+
+	// Measures synchronous copy_buffer from a host-visible buffer.
+	void bench_copy_buffer()
+	{
+		constexpr vk::DeviceSize CopySize = 64ull * 1024 * 1024;
+
+		AllocatedBuffer src = create_shared_buffer(CopySize, vk::BufferUsageFlagBits::eTransferSrc,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+		AllocatedBuffer dst = create_shared_buffer(CopySize, vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+		BenchmarkResult result = time("copy_buffer", 16, [&]()
+		{
+			copy_buffer(src.buffer, dst.buffer, CopySize);
+		});
+
+		result.metrics.emplace_back("bytes", static_cast<double>(CopySize));
+		result.metrics.emplace_back("gib_per_s", CopySize / (1024.0 * 1024.0 * 1024.0) / (result.median() / 1000.0));
+		m_Results.push_back(std::move(result));
+
+		destroy_buffer(dst);
+		destroy_buffer(src);
+	}
+
+	// Describes the triangle pipeline used by the pipeline and draw benchmarks.
+	PipelineBuilder make_pipeline_builder()
+	{
+		vk::PipelineColorBlendAttachmentState blendAttachment{};
+		blendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG
+			| vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+
+		PipelineBuilder builder = create_pipeline_builder(PipelineType::Graphics);
+		builder.add_shader_stage("src/shader/vert.spv", vk::ShaderStageFlagBits::eVertex)
+			.add_shader_stage("src/shader/frag.spv", vk::ShaderStageFlagBits::eFragment)
+			.add_viewport(0.0f, 0.0f, static_cast<float>(m_SwapExtent.width), static_cast<float>(m_SwapExtent.height), 0.0f, 1.0f)
+			.add_scissor(0, 0, m_SwapExtent.width, m_SwapExtent.height)
+			.add_dynamic_state(vk::DynamicState::eViewport)
+			.add_dynamic_state(vk::DynamicState::eScissor)
+			.set_cull_mode(vk::CullModeFlagBits::eNone)
+			.add_color_blend_attachment(blendAttachment)
+			.set_vertex_format<Vertex>();
+
+		return builder;
+	}
+
+	// Measures PipelineBuilder::build without a pipeline cache and through a warm one. Driver
+	// internal caches may still make the uncached builds faster than a true cold start.
+	void bench_pipeline_build()
+	{
+		PipelineBuilder builder = make_pipeline_builder();
+
+		m_Results.push_back(time("pipeline_build_uncached", 16, [&]()
+		{
+			vk::UniquePipeline pipeline = builder.build(m_Device);
+		}));
+
+		// Warm the cache so every timed build is a hit
+		builder.build(m_Device, &m_PipelineCache);
+
+		m_Results.push_back(time("pipeline_build_cached", 16, [&]()
+		{
+			vk::UniquePipeline pipeline = builder.build(m_Device, &m_PipelineCache);
+		}));
+	}
+
+	// Measures swapchain recreation, including the deferred destruction of retired swapchains.
+	void bench_swapchain_recreation()
+	{
+		BenchmarkResult result = time("swapchain_recreate", 16, [&]()
+		{
+			recreate_swapchain();
+		});
+
+		m_Device.waitIdle();
+		m_DeletionQueue.flush_all();
+
+		m_Results.push_back(std::move(result));
+	}
+
+	// Uploads the triangle and its indices and builds the draw pipeline.
+	void create_draw_resources()
+	{
+		// The leading {} initializes the empty VertexFormat base
+		const std::vector<Vertex> vertices = {
+			{ {}, { 0.0f, -0.01f }, { 1.0f, 0.0f, 0.0f } },
+			{ {}, { 0.01f, 0.01f }, { 0.0f, 1.0f, 0.0f } },
+			{ {}, { -0.01f, 0.01f }, { 0.0f, 0.0f, 1.0f } }
+		};
+		vk::DeviceSize size = sizeof(Vertex) * vertices.size();
+
+		m_VertexBuffer = create_shared_buffer(size, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::MemoryPropertyFlagBits::eDeviceLocal);
+		upload_buffer(m_VertexBuffer.buffer, vertices.data(), size, 0, UploadSync{ .transferOwnership = false });
+
+		const std::vector<uint16_t> indices = { 0, 1, 2 };
+		m_IndexBuffer = create_shared_buffer(sizeof(uint16_t) * indices.size(), vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+			vk::MemoryPropertyFlagBits::eDeviceLocal);
+		upload_buffer(m_IndexBuffer.buffer, indices.data(), sizeof(uint16_t) * indices.size(), 0, UploadSync{ .transferOwnership = false });
+
+		m_IndirectDraws = create_indirect_draw_buffer(MaxDraws);
+		wait_for_upload(flush_uploads());
+
+		m_Pipeline = build_pipeline(make_pipeline_builder());
+	}
+
+	// Releases the draw pipeline and buffers.
+	void destroy_draw_resources()
+	{
+		m_Device.waitIdle();
+		m_Pipeline.reset();
+		destroy_indirect_draw_buffer(m_IndirectDraws);
+		destroy_buffer(m_IndexBuffer);
+		destroy_buffer(m_VertexBuffer);
+	}
+
+	// Measures frames of drawCount draws recorded with the given mode.
+	void bench_draw_submission(uint32_t drawCount, DrawMode mode)
+	{
+		constexpr uint32_t WarmupFrames = 16, Frames = 256;
+
+		m_DrawCount = drawCount;
+		m_DrawMode = mode;
+
+		// The indirect commands are uploaded once and consumed by the first warm-up frame
+		if (mode == DrawMode::Indirect)
+		{
+			std::vector<vk::DrawIndexedIndirectCommand> commands(drawCount, vk::DrawIndexedIndirectCommand(3, 1, 0, 0, 0));
+			upload_indirect_draws(m_IndirectDraws, commands);
+			flush_uploads();
+		}
+
+		for (uint32_t i = 0; i < WarmupFrames; i++)
+			draw_frame();
+
+		m_RecordMs = 0.0;
+		const char* prefix = mode == DrawMode::Parallel ? "draw_submit_parallel_" : mode == DrawMode::Indirect ? "draw_submit_indirect_" : "draw_submit_";
+		BenchmarkResult result = time(prefix + std::to_string(drawCount), Frames, [&]()
+		{
+			draw_frame();
+		});
+		m_Device.waitIdle();
+
+		double totalMs = std::accumulate(result.samples.begin(), result.samples.end(), 0.0);
+		result.metrics.emplace_back("draws", static_cast<double>(drawCount));
+		result.metrics.emplace_back("draws_per_s", drawCount * static_cast<double>(Frames) / (totalMs / 1000.0));
+		result.metrics.emplace_back("record_ms", m_RecordMs / Frames);
+		m_Results.push_back(std::move(result));
+
+		if (!m_Config.headless)
+			glfwPollEvents();
+	}
+
+	// Records state and a range of draws into a command buffer.
+	void record_draws(vk::CommandBuffer commandBuffer, uint32_t first, uint32_t last)
+	{
+		vk::Viewport viewport(0.0f, 0.0f, static_cast<float>(m_SwapExtent.width), static_cast<float>(m_SwapExtent.height), 0.0f, 1.0f);
+		vk::Rect2D scissor({ 0, 0 }, m_SwapExtent);
+		vk::DeviceSize offset = 0;
+
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_Pipeline.get());
+		commandBuffer.setViewport(0, viewport);
+		commandBuffer.setScissor(0, scissor);
+		commandBuffer.bindVertexBuffers(0, m_VertexBuffer.buffer, offset);
+
+		for (uint32_t i = first; i < last; i++)
+			commandBuffer.draw(3, 1, 0, 0);
+	}
+
+	void record_command_buffer(vk::CommandBuffer commandBuffer, uint32_t imageIdx) override
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		if (m_DrawMode == DrawMode::Parallel)
+		{
+			begin_rendering(commandBuffer, imageIdx, {}, vk::RenderingFlagBits::eContentsSecondaryCommandBuffers);
+			record_parallel(commandBuffer, m_DrawCount, 2048, [this](vk::CommandBuffer secondary, uint32_t first, uint32_t last)
+			{
+				record_draws(secondary, first, last);
+			});
+		}
+		else if (m_DrawMode == DrawMode::Indirect)
+		{
+			begin_rendering(commandBuffer, imageIdx);
+			record_draws(commandBuffer, 0, 0);	// Pipeline and vertex state only
+			commandBuffer.bindIndexBuffer(m_IndexBuffer.buffer, 0, vk::IndexType::eUint16);
+			draw_indexed_indirect(commandBuffer, m_IndirectDraws);
+		}
+		else
+		{
+			begin_rendering(commandBuffer, imageIdx);
+			record_draws(commandBuffer, 0, m_DrawCount);
+		}
+
+		end_rendering(commandBuffer, imageIdx);
+
+		m_RecordMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Writes the device description and all results as JSON.
+	void write_results()
+	{
+		vk::PhysicalDeviceProperties properties = m_PhysicalDevice.getProperties();
+
+		std::ostringstream json;
+		json << "{\n";
+		json << "  \"device\": {\n";
+		json << "    \"name\": " << json_string(properties.deviceName.data()) << ",\n";
+		json << "    \"vendor_id\": " << properties.vendorID << ",\n";
+		json << "    \"device_id\": " << properties.deviceID << ",\n";
+		json << "    \"driver_version\": " << properties.driverVersion << ",\n";
+		json << "    \"api_version\": \"" << VK_API_VERSION_MAJOR(properties.apiVersion) << "." << VK_API_VERSION_MINOR(properties.apiVersion)
+			<< "." << VK_API_VERSION_PATCH(properties.apiVersion) << "\"\n";
+		json << "  },\n";
+		json << "  \"headless\": " << (m_Config.headless ? "true" : "false") << ",\n";
+		json << "  \"results\": [\n";
+
+		for (size_t i = 0; i < m_Results.size(); i++)
+		{
+			const BenchmarkResult& result = m_Results[i];
+
+			json << "    { \"name\": " << json_string(result.name) << ", \"iterations\": " << result.samples.size()
+				<< ", \"mean_ms\": " << result.mean() << ", \"median_ms\": " << result.median()
+				<< ", \"min_ms\": " << result.min() << ", \"max_ms\": " << result.max();
+
+			for (const auto& [metric, value] : result.metrics)
+				json << ", " << json_string(metric) << ": " << value;
+
+			json << " }" << (i + 1 < m_Results.size() ? "," : "") << "\n";
+
+			spdlog::info("{:<32} median {:>10.4f} ms  min {:>10.4f} ms  max {:>10.4f} ms", result.name, result.median(), result.min(), result.max());
+		}
+
+		json << "  ]\n}\n";
+
+		std::ofstream file(m_OutputPath, std::ofstream::trunc);
+		if (!file.is_open())
+			error("Failed to write benchmark results to " + m_OutputPath);
+
+		file << json.str();
+		spdlog::info("Wrote {} benchmark results to {}", m_Results.size(), m_OutputPath);
+	}
+};
+
+// Usage: Benchmarks [--headless] [--output <file>]
+int main(int argc, char** argv)
+{
+	std::string outputPath = "benchmark_results.json";
+	bool headless = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+
+		if (arg == "--headless")
+			headless = true;
+		else if (arg == "--output" && i + 1 < argc)
+			outputPath = argv[++i];
+	}
+
+	Benchmarks app(outputPath, headless);
+
+	try
+	{
+		app.run();
+	}
+	catch (const std::exception& e)
+	{
+		spdlog::error("Benchmark failed: {}", e.what());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
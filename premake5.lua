@@ -15,4 +15,5 @@ group "Projects"
     include "02_Clear"
     include "03_TriangleUnbuffered"
     include "04_TriangleBuffered"
-    include "05_IndexBuffer"
\ No newline at end of file
+    include "05_IndexBuffer"
+    include "Benchmarks"
\ No newline at end of file